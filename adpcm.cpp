@@ -0,0 +1,123 @@
+#include "adpcm.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace adpcm {
+
+namespace {
+
+const int kStepSizes[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+	107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+	5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+	27086, 29794, 32767};
+
+const int kIndexAdjust[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+// Every (step index, code) pair resolved ahead of time, so decoding a
+// sample is two table loads, an add and a clamp, with no branches.
+struct Tables {
+	std::int32_t delta[89][16];
+	std::uint8_t next[89][16];
+
+	Tables() {
+		for (int index = 0; index < 89; index++) {
+			for (int code = 0; code < 16; code++) {
+				int step = kStepSizes[index];
+				int d = step >> 3;
+				if (code & 4) d += step;
+				if (code & 2) d += step >> 1;
+				if (code & 1) d += step >> 2;
+				delta[index][code] = (code & 8) ? -d : d;
+				next[index][code] = (std::uint8_t)std::min(88, std::max(0, index + kIndexAdjust[code & 7]));
+			}
+		}
+	}
+};
+
+const Tables& tables() {
+	static const Tables t;
+	return t;
+}
+
+inline int clamp16(int v) {
+	return std::min(32767, std::max(-32768, v));
+}
+
+} // namespace
+
+void encode(const std::int16_t* in, size_t frames, int channels, std::vector<std::uint8_t>& out) {
+	const Tables& t = tables();
+	const size_t blocks = block_count(frames);
+	out.assign(blocks * block_bytes(channels), 0);
+	for (int c = 0; c < channels; c++) {
+		int index = 0; // carried across blocks, so each block starts with a fitting step
+		for (size_t b = 0; b < blocks; b++) {
+			size_t first = b * kBlockFrames;
+			size_t count = std::min((size_t)kBlockFrames, frames - first);
+			std::uint8_t* p = &out[b * block_bytes(channels) + (size_t)c * kChannelBytes];
+			int pred = in[first * channels + c];
+			p[0] = (std::uint8_t)(pred & 0xFF);
+			p[1] = (std::uint8_t)((pred >> 8) & 0xFF);
+			p[2] = (std::uint8_t)index;
+			std::uint8_t* codes = p + 4;
+			for (size_t i = 1; i < count; i++) {
+				// Same arithmetic as the decoder's table, so the encoder
+				// tracks exactly what will be decoded.
+				int diff = in[(first + i) * channels + c] - pred;
+				int code = 0;
+				if (diff < 0) {
+					code = 8;
+					diff = -diff;
+				}
+				int step = kStepSizes[index];
+				if (diff >= step) {
+					code |= 4;
+					diff -= step;
+				}
+				if (diff >= step >> 1) {
+					code |= 2;
+					diff -= step >> 1;
+				}
+				if (diff >= step >> 2) code |= 1;
+				pred = clamp16(pred + t.delta[index][code]);
+				index = t.next[index][code];
+				codes[(i - 1) >> 1] |= (std::uint8_t)(code << (((i - 1) & 1) * 4));
+			}
+		}
+	}
+}
+
+void decode_block(const std::uint8_t* block, int channels, int frames, std::int16_t* out) {
+	const Tables& t = tables();
+	for (int c = 0; c < channels; c++) {
+		const std::uint8_t* p = block + (size_t)c * kChannelBytes;
+		int pred = first_sample(block, c);
+		int index = std::min<int>(p[2], 88);
+		const std::uint8_t* codes = p + 4;
+		std::int16_t* dst = out + c;
+		dst[0] = (std::int16_t)pred;
+		dst += channels;
+
+		// Two samples per code byte.
+		int pairs = (frames - 1) >> 1;
+		for (int k = 0; k < pairs; k++) {
+			int byte = codes[k];
+			pred = clamp16(pred + t.delta[index][byte & 15]);
+			index = t.next[index][byte & 15];
+			dst[0] = (std::int16_t)pred;
+			pred = clamp16(pred + t.delta[index][byte >> 4]);
+			index = t.next[index][byte >> 4];
+			dst[channels] = (std::int16_t)pred;
+			dst += 2 * channels;
+		}
+		if ((frames - 1) & 1) {
+			int code = codes[pairs] & 15;
+			dst[0] = (std::int16_t)clamp16(pred + t.delta[index][code]);
+		}
+	}
+}
+
+} // namespace adpcm
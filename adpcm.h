@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// IMA-ADPCM, for keeping sounds in memory at about a quarter of their
+// 16-bit size.
+//
+// A clip is a run of fixed-size blocks of kBlockFrames frames; the last
+// one is padded. Each block holds, for each channel in turn, a 4-byte
+// header (the block's first sample, as 16-bit little-endian, and the step
+// index) followed by kBlockFrames - 1 four-bit codes, low nibble first.
+// Blocks are independent, so playback can start at any block, and the
+// first frame of the next block is in its header without decoding.
+namespace adpcm {
+
+const int kBlockFrames = 1025;
+const int kChannelBytes = 4 + (kBlockFrames - 1) / 2;
+
+inline size_t block_bytes(int channels) {
+	return (size_t)channels * kChannelBytes;
+}
+
+inline size_t block_count(size_t frames) {
+	return (frames + kBlockFrames - 1) / kBlockFrames;
+}
+
+// Encode interleaved 16-bit frames; out is resized to whole blocks.
+void encode(const std::int16_t* in, size_t frames, int channels, std::vector<std::uint8_t>& out);
+
+// Decode the first `frames` frames (at most kBlockFrames) of one block
+// into out, interleaved.
+void decode_block(const std::uint8_t* block, int channels, int frames, std::int16_t* out);
+
+// The first sample of a block's channel, read from its header.
+inline std::int16_t first_sample(const std::uint8_t* block, int channel) {
+	const std::uint8_t* p = block + (size_t)channel * kChannelBytes;
+	return (std::int16_t)(p[0] | (p[1] << 8));
+}
+
+} // namespace adpcm
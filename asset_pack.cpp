@@ -0,0 +1,292 @@
+#include "asset_pack.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace assets {
+
+namespace {
+
+const std::uint64_t kHashPrime = 1099511628211ull;
+
+struct Mapping {
+    const std::uint8_t* base = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE view = nullptr;
+#endif
+};
+
+Mapping g_map;
+std::string g_path;
+std::unordered_map<std::string, Asset> g_index;
+
+// Names are looked up as written in texPath[] and sound paths: forward
+// slashes, no leading "./".
+std::string normalize(const std::string& path) {
+    std::string name = path;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    while (name.compare(0, 2, "./") == 0) name.erase(0, 2);
+    return name;
+}
+
+bool map_file(const std::string& path, Mapping& map) {
+#ifdef _WIN32
+    map.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (map.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(map.file, &size) || size.QuadPart == 0) {
+        CloseHandle(map.file);
+        map.file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    map.view = CreateFileMappingA(map.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* base = map.view ? MapViewOfFile(map.view, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (map.view) CloseHandle(map.view);
+        CloseHandle(map.file);
+        map = Mapping();
+        return false;
+    }
+    map.base = static_cast<const std::uint8_t*>(base);
+    map.size = (std::size_t)size.QuadPart;
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    // MAP_SHARED and read-only: every process mapping the pack uses the
+    // same page-cache pages.
+    void* base = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+    map.base = static_cast<const std::uint8_t*>(base);
+    map.size = (std::size_t)st.st_size;
+    return true;
+#endif
+}
+
+void unmap_file(Mapping& map) {
+    if (!map.base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(map.base);
+    CloseHandle(map.view);
+    CloseHandle(map.file);
+#else
+    munmap(const_cast<std::uint8_t*>(map.base), map.size);
+#endif
+    map = Mapping();
+}
+
+// Check every record against the file size before anything uses it.
+bool read_index(const Mapping& map, bool checkSources) {
+    if (map.size < sizeof(PackHeader)) return false;
+    PackHeader header;
+    std::memcpy(&header, map.base, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) return false;
+    if (header.count > (map.size - sizeof(PackHeader)) / sizeof(PackEntry)) return false;
+
+    const std::uint8_t* records = map.base + sizeof(PackHeader);
+    g_index.reserve(header.count);
+    int stale = 0;
+    for (std::uint32_t i = 0; i < header.count; i++) {
+        PackEntry entry;
+        std::memcpy(&entry, records + (std::size_t)i * sizeof(PackEntry), sizeof(entry));
+        if (entry.nameOffset > map.size || entry.nameLength > map.size - entry.nameOffset) return false;
+        if (entry.offset > map.size || entry.size > map.size - entry.offset) return false;
+        std::string name(reinterpret_cast<const char*>(map.base) + entry.nameOffset, entry.nameLength);
+        Source current;
+        if (checkSources && stat_source(name, current) &&
+            (current.size != entry.sourceSize || current.time != entry.sourceTime)) {
+            stale++;
+            continue;
+        }
+        Asset asset;
+        asset.data = map.base + entry.offset;
+        asset.size = (std::size_t)entry.size;
+        asset.offset = entry.offset;
+        asset.format = (Format)entry.format;
+        asset.hash = entry.hash;
+        asset.source.hash = entry.sourceHash;
+        asset.source.size = entry.sourceSize;
+        asset.source.time = entry.sourceTime;
+        g_index[name] = asset;
+    }
+    if (stale)
+        std::cerr << "[assets] " << stale << " assets changed since the pack was built and are read from their "
+                  << "files; rerun compile_assets\n";
+    return true;
+}
+
+} // namespace
+
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    std::uint64_t hash = seed;
+    std::size_t words = size / 8;
+    for (std::size_t i = 0; i < words; i++) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i * 8, 8);
+        hash ^= word;
+        hash *= kHashPrime;
+    }
+    for (std::size_t i = words * 8; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+Format format_for(const std::string& path) {
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (ext == "bmp") return Format::Bmp;
+    if (ext == "jpg" || ext == "jpeg") return Format::Jpeg;
+    if (ext == "png") return Format::Png;
+    if (ext == "wav") return Format::Wav;
+    return Format::Raw;
+}
+
+bool stat_source(const std::string& path, Source& source) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+#endif
+    source.size = (std::uint64_t)st.st_size;
+    source.time = (std::int64_t)st.st_mtime;
+    return true;
+}
+
+bool open(const std::string& path, bool checkSources) {
+    PROFILE_ZONE("assets::open");
+    close();
+    if (!map_file(path, g_map)) return false;
+    if (!read_index(g_map, checkSources)) {
+        std::cerr << "[assets] Invalid pack, using loose files: " << path << "\n";
+        close();
+        return false;
+    }
+    g_path = path;
+    return true;
+}
+
+void close() {
+    g_index.clear();
+    g_path.clear();
+    unmap_file(g_map);
+}
+
+bool is_open() {
+    return g_map.base != nullptr;
+}
+
+const std::string& pack_path() {
+    return g_path;
+}
+
+const Asset* find(const std::string& path) {
+    if (g_index.empty()) return nullptr;
+    auto found = g_index.find(normalize(path));
+    return found != g_index.end() ? &found->second : nullptr;
+}
+
+std::vector<std::pair<std::string, const Asset*>> list() {
+    std::vector<std::pair<std::string, const Asset*>> assets;
+    for (const auto& entry : g_index) assets.emplace_back(entry.first, &entry.second);
+    std::sort(assets.begin(), assets.end());
+    return assets;
+}
+
+bool write_pack(const std::string& packPath, const std::vector<PackItem>& items, std::uint64_t* bytesWritten) {
+    std::vector<PackEntry> entries(items.size());
+    std::vector<std::string> names(items.size());
+    std::uint64_t offset = sizeof(PackHeader) + items.size() * sizeof(PackEntry);
+    for (std::size_t i = 0; i < items.size(); i++) {
+        names[i] = normalize(items[i].name);
+        entries[i].nameOffset = (std::uint32_t)offset;
+        entries[i].nameLength = (std::uint32_t)names[i].size();
+        offset += names[i].size();
+    }
+
+    std::string tmp = packPath + ".tmp";
+    std::FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) return false;
+    PackHeader header{kMagic, kVersion, (std::uint32_t)items.size(), 0};
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    // Entries are rewritten once the payload offsets are known.
+    ok = ok && (entries.empty() || std::fwrite(entries.data(), sizeof(PackEntry), entries.size(), out) == entries.size());
+    for (const std::string& name : names) ok = ok && std::fwrite(name.data(), 1, name.size(), out) == name.size();
+
+    std::unordered_multimap<std::uint64_t, std::size_t> written; // payload hash -> item
+    std::uint64_t payloadBytes = 0;
+    const std::uint8_t padding[kAlign] = {};
+    for (std::size_t i = 0; i < items.size() && ok; i++) {
+        const std::vector<std::uint8_t>& data = items[i].data;
+        PackEntry& entry = entries[i];
+        entry.size = data.size();
+        entry.hash = hash_bytes(data.data(), data.size());
+        entry.sourceHash = items[i].source.hash;
+        entry.sourceSize = items[i].source.size;
+        entry.sourceTime = items[i].source.time;
+        entry.format = (std::uint32_t)items[i].format;
+
+        bool shared = false;
+        auto range = written.equal_range(entry.hash);
+        for (auto it = range.first; it != range.second && !shared; ++it) {
+            if (items[it->second].data == data) {
+                entry.offset = entries[it->second].offset;
+                shared = true;
+            }
+        }
+        if (shared) continue;
+
+        std::size_t pad = (std::size_t)((kAlign - offset % kAlign) % kAlign);
+        ok = std::fwrite(padding, 1, pad, out) == pad;
+        offset += pad;
+        entry.offset = offset;
+        ok = ok && (data.empty() || std::fwrite(data.data(), 1, data.size(), out) == data.size());
+        offset += data.size();
+        payloadBytes += data.size();
+        written.emplace(entry.hash, i);
+    }
+    ok = ok && std::fseek(out, (long)sizeof(PackHeader), SEEK_SET) == 0;
+    ok = ok && (entries.empty() || std::fwrite(entries.data(), sizeof(PackEntry), entries.size(), out) == entries.size());
+    ok = std::fclose(out) == 0 && ok;
+
+    // A simulator that has the old pack mapped keeps reading it: on POSIX
+    // systems removing the file only unlinks it.
+    std::remove(packPath.c_str());
+    if (!ok || std::rename(tmp.c_str(), packPath.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    if (bytesWritten) *bytesWritten = payloadBytes;
+    return true;
+}
+
+} // namespace assets
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Asset pack: textures and sounds in one file, memory-mapped read-only.
+//
+// At startup the whole of data/ is one open() and one mmap(); loaders get a
+// pointer into the mapping and parse assets in place, without reading or
+// copying them. The mapping is shared, so simulator instances on one host
+// share the page cache for it. Assets missing from the pack (or every asset,
+// when there is no pack) are read from their loose files as before.
+//
+// Packs are built by tools/compile_assets, which stores assets converted
+// to runtime formats. The index doubles as the build manifest: each entry
+// records the size, time and hash of the source file it was made from.
+// When asked to, open() compares the size and time with the source, where
+// it exists, and leaves out entries whose source has changed since, so an
+// edited asset is read from its file until the pack is rebuilt. That is a
+// stat() per asset, so it is for development: by default only the pack is
+// touched.
+//
+// File layout (little-endian): PackHeader, PackHeader::count PackEntry
+// records, the names they point to, then the asset payloads, each starting
+// on a kAlign boundary. Entries with identical payloads share one copy.
+
+namespace assets {
+
+const std::uint32_t kMagic = 0x4B505344; // "DSPK"
+const std::uint32_t kVersion = 2;
+const std::uint32_t kAlign = 64;
+const char* const kDefaultPack = "data/assets.pack";
+
+enum class Format : std::uint32_t {
+    Raw = 0,
+    Bmp = 1,
+    Jpeg = 2,
+    Png = 3,
+    Wav = 4,
+    Texture = 5, // mip chain, texture.h
+};
+
+#pragma pack(push, 1)
+struct PackHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t reserved;
+};
+
+struct PackEntry {
+    std::uint64_t offset;     // payload, from the start of the file
+    std::uint64_t size;
+    std::uint64_t hash;       // hash_bytes() of the payload
+    std::uint64_t sourceHash; // hash_bytes() of the source file
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;  // modification time of the source, seconds since the epoch
+    std::uint32_t nameOffset; // from the start of the file
+    std::uint32_t nameLength;
+    std::uint32_t format;     // Format
+    std::uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PackEntry) == 64, "PackEntry layout is part of the file format");
+
+// What the manifest records of a source file.
+struct Source {
+    std::uint64_t hash = 0;
+    std::uint64_t size = 0;
+    std::int64_t time = 0;
+};
+
+// An asset inside the mapped pack; valid until close().
+struct Asset {
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::uint64_t offset = 0; // of data in the pack file
+    Format format = Format::Raw;
+    std::uint64_t hash = 0;
+    Source source;
+};
+
+// An asset to write into a pack.
+struct PackItem {
+    std::string name;
+    Format format = Format::Raw;
+    std::vector<std::uint8_t> data;
+    Source source;
+};
+
+// FNV-1a over 64-bit little-endian words, then the remaining bytes. Hashing
+// a file in pieces gives the same result as long as every piece but the
+// last is a multiple of 8 bytes: pass the previous result as seed.
+const std::uint64_t kHashSeed = 14695981039346656037ull;
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed = kHashSeed);
+
+Format format_for(const std::string& path);
+
+// Size and modification time of a file (hash is left alone); false if it
+// does not exist.
+bool stat_source(const std::string& path, Source& source);
+
+// Map a pack. False (and loose files are used) if it is missing or invalid.
+// With checkSources, entries whose source file differs from the manifest
+// are left out.
+bool open(const std::string& path = kDefaultPack, bool checkSources = false);
+void close();
+bool is_open();
+const std::string& pack_path();
+
+// The asset stored under `path` (as listed in texPath[], e.g.
+// "data/wall.bmp"), or nullptr.
+const Asset* find(const std::string& path);
+
+// Every asset in the pack, by name.
+std::vector<std::pair<std::string, const Asset*>> list();
+
+// Write a pack, replacing any file at packPath. Payloads that are
+// byte-identical are stored once. bytesWritten, if given, receives the
+// size of the payload data after deduplication.
+bool write_pack(const std::string& packPath, const std::vector<PackItem>& items, std::uint64_t* bytesWritten = nullptr);
+
+} // namespace assets
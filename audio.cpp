@@ -1,43 +1,173 @@
 #include "audio.h"
-
+#include "adpcm.h"
+#include "asset_pack.h"
+#include "pcm_convert.h"
+#include "spsc_ring.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 #ifdef USE_OPENAL
 #include <AL/al.h>
 #include <AL/alc.h>
+#else
+#include "mixer.h"
+#include "reverb.h"
 #endif
 
 namespace audio {
 
 namespace {
 
-struct WavData {
-	std::vector<std::uint8_t> pcm;
-	int channels = 0;
-	int sampleRate = 0;
-	int bitsPerSample = 0;
-};
+using pcm::WavInfo;
+using pcm::block_align;
 
 static bool g_inited = false;
 
+static std::unordered_set<std::string> g_missingSounds;
+static bool g_compress = false; // keep resident sounds as ADPCM; set before init()
+// Published for memory_stats(), which may be called from any thread.
+static std::atomic<std::size_t> g_residentBytes{0};
+static std::atomic<std::size_t> g_pcmBytes{0};
+static std::atomic<int> g_residentSounds{0};
+static Vec3 g_listenerPos{0, 0, 0}; // as last applied on the audio thread
+
 #ifdef USE_OPENAL
 static ALCdevice* g_device = nullptr;
 static ALCcontext* g_context = nullptr;
-static std::unordered_map<std::string, ALuint> g_bufferCache;
-static std::unordered_set<std::string> g_missingSounds;
-static std::vector<ALuint> g_sources;
-static Vec3 g_listenerPos{0, 0, 0};
+static int g_deviceRate = 44100; // the device's ALC_FREQUENCY, read when it opens
+
+// Clips with more sample data than this are streamed from disk through a
+// few rotating buffers instead of being decoded into one AL buffer, so the
+// memory they hold stays bounded however long they are.
+static const std::uint32_t kStreamThreshold = 1024 * 1024;
+static const int kStreamBuffers = 4;
+static const std::uint32_t kStreamChunkBytes = 32 * 1024; // file bytes per buffer refill
+// Compressed sounds stream from memory, this many ADPCM blocks (about
+// 85 ms at 48 kHz) per buffer refill.
+static const int kAdpcmStreamBlocks = 4;
+#else
+// Without OpenAL, sounds are decoded to 16-bit and mixed in software, in
+// real time, into a WAV file (set_output_file) or a null sink.
+static const int kOutputRate = 48000;
+static int g_deviceRate = kOutputRate; // sounds are converted to this rate
+static const int kMixBlock = 480; // 10 ms
+static std::string g_outputPath;
+static mixer::WavWriter g_output;
+static std::vector<float> g_mixBuffer;
+static long long g_framesMixed = 0;
+// Room reverberation (set_room), fed a mono send of the mix.
+static const float kReverbWet = 0.3f;
+static const float kReverbMaxSeconds = 2.0f;
+static bool g_roomSet = false;
+static reverb::Room g_room;
+static std::unique_ptr<reverb::Convolver> g_reverb;
+static std::vector<float> g_reverbSend;
+#endif
+
+// A sound file, loaded on first use and cached by path.
+struct Sound {
+	std::string path;
+	std::string file;      // where the samples are read from: the converted cache file, or the WAV
+	WavInfo info;          // format and location of the samples in file
+#ifdef USE_OPENAL
+	ALuint buffer = 0;     // resident 16-bit samples; 0 when the sound streams
+	std::vector<std::uint8_t> adpcm; // resident compressed samples, streamed from memory
+#else
+	mixer::Clip clip;
+#endif
+	float duration = 0.0f; // seconds
+};
+
+static std::unordered_map<std::string, Sound> g_sounds;
+
+#ifdef USE_OPENAL
+// Streaming state of one AL source.
+struct Stream {
+	bool active = false;
+	bool loop = false;
+	std::ifstream file;
+	const Sound* sound = nullptr;
+	ALenum format = 0;
+	std::uint32_t remaining = 0; // file bytes not yet queued
+	std::uint32_t block = 0;     // next ADPCM block, for a compressed sound
+	std::uint32_t skip = 0;      // frames to drop from the start of that block
+	ALuint buffers[kStreamBuffers] = {};
+	std::vector<std::uint8_t> raw; // refill scratch, reused
+	std::vector<std::int16_t> pcm;
+};
+#endif
+
+// Every sound that is playing is a Voice, but only the kMaxSources most
+// important audible voices hold a source (an AL source, or a voice of the
+// software mixer). The others are virtual: their
+// playback clock keeps running, and they resume from it once they win a
+// source back. Voices quieter than kAudibleGain, or further away than
+// kMaxDistance, never hold a source.
+static const int kMaxSources = 16;
+static const int kMaxVoices = 64;
+static const float kAudibleGain = 0.01f; // -40 dB
+static const float kRefDistance = 2.0f;
+static const float kMaxDistance = 50.0f;
+static const float kRolloff = 1.0f;
+// Voices that hold a source rank as this much louder, so two similar
+// sounds do not trade a source back and forth.
+static const float kKeepBias = 1.25f;
+
+struct Voice {
+	bool active = false;
+	const Sound* sound = nullptr;
+	Channel channel = Channel::ACTION;
+	std::uint32_t emitter = 0; // 0 for one-shots
+	int priority = 0;
+	bool relative = false;     // at the listener (UI sounds)
+	bool loop = false;
+	bool moved = false;        // position or gain changed since last applied
+	bool fresh = true;         // started since the last update
+	Vec3 position{0, 0, 0};
+	float gain = 1.0f;
+	double time = 0.0;         // playback position, seconds
+	int source = -1;           // index into g_sources, -1 while virtual
+	float audibility = 0.0f;
+};
+
+struct Source {
+	int voice = -1; // -1 when free
+#ifdef USE_OPENAL
+	ALuint id = 0;
+	Stream stream;
+#else
+	int channel = -1; // mixer voice
+#endif
+};
 
-static ALuint g_uiSource = 0;
-static ALuint g_stepSource = 0;
-static ALuint g_actionSource = 0;
+static Source g_sources[kMaxSources];
+static Voice g_voices[kMaxVoices];
+#ifndef USE_OPENAL
+static mixer::Mixer g_mixer(kOutputRate, kMaxSources);
+#endif
 
 static float len(Vec3 v) {
 	return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
@@ -49,237 +179,714 @@ static Vec3 normalize(Vec3 v) {
 	return {v.x / l, v.y / l, v.z / l};
 }
 
-static bool read_u32_le(std::istream& in, std::uint32_t& out) {
-	std::uint8_t b[4]{};
-	if (!in.read(reinterpret_cast<char*>(b), 4)) return false;
-	out = (std::uint32_t)b[0] | ((std::uint32_t)b[1] << 8) | ((std::uint32_t)b[2] << 16) | ((std::uint32_t)b[3] << 24);
+// Sounds are converted once: the 16-bit samples, resampled to the device
+// rate, are saved in kCacheDir under a name made of a hash of the sound's
+// path and the rate, and the header records a hash of the source file.
+// Later launches hash the source, find a matching file and read the
+// samples as they are, without parsing or converting the WAV. An edited
+// sound's file no longer matches and is overwritten, so the cache holds one
+// file per sound and rate and never needs pruning.
+static const char* const kCacheDir = "data/cache";
+static const std::uint32_t kCacheMagic = 0x43505344; // "DSPC"
+static const std::uint32_t kCacheVersion = 1;
+
+// Followed by frames * channels signed 16-bit samples.
+struct CacheHeader {
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint64_t sourceHash;
+	std::uint32_t channels;
+	std::uint32_t sampleRate;
+	std::uint32_t frames;
+	std::uint32_t reserved;
+};
+
+// Hash of the file's contents, as assets::hash_bytes computes it for the
+// source hash in the pack's index, so a loose WAV and its packed copy share
+// one cache entry.
+static bool hash_file(const std::string& path, std::uint64_t& hash) {
+	PROFILE_ZONE("audio::hash");
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	hash = assets::kHashSeed;
+	std::vector<char> chunk(64 * 1024); // a multiple of 8, as hash_bytes needs to hash in pieces
+	for (;;) {
+		in.read(chunk.data(), (std::streamsize)chunk.size());
+		size_t got = (size_t)in.gcount();
+		if (got == 0) break;
+		hash = assets::hash_bytes(chunk.data(), got, hash);
+	}
 	return true;
 }
 
-static bool read_u16_le(std::istream& in, std::uint16_t& out) {
-	std::uint8_t b[2]{};
-	if (!in.read(reinterpret_cast<char*>(b), 2)) return false;
-	out = (std::uint16_t)b[0] | ((std::uint16_t)b[1] << 8);
-	return true;
+static std::string cache_path(const std::string& soundPath) {
+	std::uint64_t hash = assets::hash_bytes(soundPath.data(), soundPath.size());
+	char name[48];
+	std::snprintf(name, sizeof(name), "/%016llx-%d.pcm", (unsigned long long)hash, g_deviceRate);
+	return kCacheDir + std::string(name);
 }
 
-static bool load_wav_file(const std::string& path, WavData& wav) {
-	std::ifstream in(path, std::ios::binary);
+// Where the samples of a cache file are, in the terms streams and loading use.
+static WavInfo cache_info(int channels, std::uint32_t frames) {
+	WavInfo info;
+	info.channels = channels;
+	info.sampleRate = g_deviceRate;
+	info.bitsPerSample = 16;
+	info.audioFormat = 1;
+	info.dataOffset = (std::uint32_t)sizeof(CacheHeader);
+	info.dataSize = frames * (std::uint32_t)channels * 2;
+	return info;
+}
+
+static bool read_cache(const std::string& path, std::uint64_t hash, WavInfo& info) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
 	if (!in) return false;
+	std::streamoff size = in.tellg();
+	CacheHeader header{};
+	in.seekg(0, std::ios::beg);
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	if (header.magic != kCacheMagic || header.version != kCacheVersion || header.sourceHash != hash) return false;
+	if ((int)header.sampleRate != g_deviceRate || header.channels < 1 || header.channels > 2) return false;
+	info = cache_info((int)header.channels, header.frames);
+	return size >= (std::streamoff)info.dataOffset + (std::streamoff)info.dataSize;
+}
 
-	char riff[4]{};
-	if (!in.read(riff, 4)) return false;
-	if (std::string(riff, 4) != "RIFF") return false;
-
-	std::uint32_t riffSize = 0;
-	if (!read_u32_le(in, riffSize)) return false;
-	(void)riffSize;
-
-	char wave[4]{};
-	if (!in.read(wave, 4)) return false;
-	if (std::string(wave, 4) != "WAVE") return false;
-
-	bool haveFmt = false;
-	bool haveData = false;
-	std::uint16_t audioFormat = 0;
-	std::vector<std::uint8_t> rawData;
-
-	while (in && !(haveFmt && haveData)) {
-		char chunkId[4]{};
-		if (!in.read(chunkId, 4)) break;
-		std::uint32_t chunkSize = 0;
-		if (!read_u32_le(in, chunkSize)) break;
-
-		std::string id(chunkId, 4);
-		if (id == "fmt ") {
-			std::uint16_t numChannels = 0;
-			std::uint32_t sampleRate = 0;
-			std::uint32_t byteRate = 0;
-			std::uint16_t blockAlign = 0;
-			std::uint16_t bitsPerSample = 0;
-
-			if (!read_u16_le(in, audioFormat)) return false;
-			if (!read_u16_le(in, numChannels)) return false;
-			if (!read_u32_le(in, sampleRate)) return false;
-			if (!read_u32_le(in, byteRate)) return false;
-			if (!read_u16_le(in, blockAlign)) return false;
-			if (!read_u16_le(in, bitsPerSample)) return false;
-			(void)byteRate;
-			(void)blockAlign;
-
-			// Skip any remaining fmt bytes
-			std::uint32_t remaining = chunkSize > 16 ? (chunkSize - 16) : 0;
-			if (remaining) in.seekg(remaining, std::ios::cur);
-
-			wav.channels = (int)numChannels;
-			wav.sampleRate = (int)sampleRate;
-			wav.bitsPerSample = (int)bitsPerSample;
-			haveFmt = true;
-		} else if (id == "data") {
-			rawData.resize(chunkSize);
-			if (!in.read(reinterpret_cast<char*>(rawData.data()), chunkSize)) return false;
-			haveData = true;
-		} else {
-			in.seekg(chunkSize, std::ios::cur);
+// Written under a temporary name and renamed, so a cache file is either
+// complete or absent.
+static bool write_cache(const std::string& path, std::uint64_t hash, int channels, const std::vector<std::int16_t>& samples) {
+	PROFILE_ZONE("audio::write_cache");
+#ifdef _WIN32
+	_mkdir(kCacheDir);
+#else
+	mkdir(kCacheDir, 0755);
+#endif
+	std::string tmp = path + ".tmp";
+	std::FILE* file = std::fopen(tmp.c_str(), "wb");
+	if (!file) return false;
+	CacheHeader header{kCacheMagic, kCacheVersion, hash, (std::uint32_t)channels, (std::uint32_t)g_deviceRate,
+		(std::uint32_t)(samples.size() / channels), 0};
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && std::fwrite(samples.data(), 2, samples.size(), file) == samples.size();
+	ok = std::fclose(file) == 0 && ok;
+	std::remove(path.c_str());
+	if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+		std::remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Whether a sound's samples are held in memory, or streamed from its file.
+static bool resident(const WavInfo& info) {
+#ifdef USE_OPENAL
+	return info.dataSize <= kStreamThreshold;
+#else
+	(void)info;
+	return true;
+#endif
+}
+
+// Read a resident sound's 16-bit samples from its cache file.
+static bool read_samples(const Sound& sound, std::vector<std::int16_t>& samples) {
+	PROFILE_ZONE("audio::load");
+	std::ifstream in(sound.file, std::ios::binary);
+	samples.resize(sound.info.dataSize / 2);
+	return in && in.seekg(sound.info.dataOffset, std::ios::beg) &&
+		in.read(reinterpret_cast<char*>(samples.data()), sound.info.dataSize);
+}
+
+// Parse and convert a WAV file, and save the result to the cache. On
+// success sound describes where its samples are and, if it is resident,
+// samples holds them. A WAV in the asset pack is converted where it is
+// mapped; a loose one is read first. Should the cache not be writable, a
+// resident sound plays from memory and one that streams reads the WAV
+// itself, from its file or from the pack.
+static bool convert_sound(Sound& sound, const assets::Asset* packed, std::uint64_t hash, const std::string& cached,
+	std::vector<std::int16_t>& samples) {
+	PROFILE_ZONE("audio::convert");
+	std::vector<std::uint8_t> file;
+	if (!packed) {
+		std::ifstream in(sound.path, std::ios::binary | std::ios::ate);
+		if (!in) return false;
+		file.resize((size_t)in.tellg());
+		if (!in.seekg(0, std::ios::beg) || !in.read(reinterpret_cast<char*>(file.data()), (std::streamsize)file.size()))
+			return false;
+	}
+	WavInfo wav;
+	if (!pcm::convert_wav(packed ? packed->data : file.data(), packed ? packed->size : file.size(), g_deviceRate, wav, samples))
+		return false;
+	file = std::vector<std::uint8_t>();
+	std::uint32_t frames = (std::uint32_t)(samples.size() / wav.channels);
+
+	sound.info = cache_info(wav.channels, frames);
+	if (write_cache(cached, hash, wav.channels, samples)) {
+		sound.file = cached;
+	} else {
+		std::cerr << "[audio] Cannot write " << cached << "\n";
+		if (!resident(sound.info)) {
+			if (packed) {
+				if (packed->offset + wav.dataOffset + wav.dataSize > UINT32_MAX) return false;
+				wav.dataOffset += (std::uint32_t)packed->offset;
+				sound.file = assets::pack_path();
+			} else {
+				sound.file = sound.path;
+			}
+			sound.info = wav;
 		}
+	}
+	if (!resident(sound.info)) samples = std::vector<std::int16_t>();
+	return true;
+}
 
-		// Chunks are word-aligned
-		if (chunkSize % 2 == 1) in.seekg(1, std::ios::cur);
+// A packed WAV that is already 16-bit at the device rate, as
+// tools/compile_assets writes them, needs no conversion and no cache file:
+// its samples are copied from the mapping, or streamed from the pack file.
+static bool use_packed(Sound& sound, const assets::Asset& packed, std::vector<std::int16_t>& samples) {
+	WavInfo wav;
+	if (!pcm::parse_wav(packed.data, packed.size, wav)) return false;
+	if (wav.audioFormat != 1 || wav.bitsPerSample != 16 || wav.sampleRate != g_deviceRate) return false;
+	if (packed.offset + wav.dataOffset + wav.dataSize > UINT32_MAX) return false;
+	wav.dataSize -= wav.dataSize % block_align(wav);
+	if (resident(wav)) {
+		const std::int16_t* first = reinterpret_cast<const std::int16_t*>(packed.data + wav.dataOffset);
+		samples.resize(wav.dataSize / 2);
+		std::memcpy(samples.data(), first, wav.dataSize);
 	}
+	wav.dataOffset += (std::uint32_t)packed.offset;
+	sound.file = assets::pack_path();
+	sound.info = wav;
+	return true;
+}
 
-	if (!haveFmt || !haveData) return false;
-	if (!((wav.channels == 1) || (wav.channels == 2))) return false;
-	if (!((audioFormat == 1) || (audioFormat == 3))) return false; // 1=PCM, 3=IEEE float
-	if (!((wav.bitsPerSample == 8) || (wav.bitsPerSample == 16) || (wav.bitsPerSample == 24) || (wav.bitsPerSample == 32))) return false;
+#ifdef USE_OPENAL
+static ALenum to_al_format(int channels) {
+	return channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+}
 
-	// Convert uncommon formats to 16-bit PCM for reliable OpenAL upload.
-	if (wav.bitsPerSample == 8) {
-		wav.pcm = std::move(rawData);
-		return true;
-	}
+static ALuint upload_samples(const Sound& sound, const std::vector<std::int16_t>& samples) {
+	ALuint buffer = 0;
+	alGenBuffers(1, &buffer);
+	alBufferData(buffer, to_al_format(sound.info.channels), samples.data(),
+		(ALsizei)(samples.size() * 2), (ALsizei)sound.info.sampleRate);
 
-	if (wav.bitsPerSample == 16 && audioFormat == 1) {
-		wav.pcm = std::move(rawData);
-		return true;
+	ALenum err = alGetError();
+	if (err != AL_NO_ERROR) {
+		std::cerr << "[audio] OpenAL error loading buffer: " << sound.path << "\n";
+		if (buffer) alDeleteBuffers(1, &buffer);
+		return 0;
 	}
+	return buffer;
+}
+#endif
 
-	// Convert to signed 16-bit little-endian.
-	std::vector<std::uint8_t> out;
-	out.reserve((rawData.size() / (wav.bitsPerSample / 8)) * 2);
+static void compress(const std::vector<std::int16_t>& samples, int channels, std::vector<std::uint8_t>& out) {
+	PROFILE_ZONE("audio::compress");
+	adpcm::encode(samples.data(), samples.size() / channels, channels, out);
+}
 
-	auto push_i16_le = [&](std::int16_t s) {
-		out.push_back((std::uint8_t)(s & 0xFF));
-		out.push_back((std::uint8_t)((s >> 8) & 0xFF));
-	};
+// Bytes of sample data a resident sound holds, compressed or not.
+static size_t resident_bytes(const Sound& sound) {
+#ifdef USE_OPENAL
+	return sound.buffer ? sound.info.dataSize : sound.adpcm.size();
+#else
+	return sound.clip.compressed() ? sound.clip.adpcm.size() : sound.clip.samples.size() * 2;
+#endif
+}
+
+static void forget_sounds() {
+	g_sounds.clear();
+	g_missingSounds.clear();
+	g_residentBytes = 0;
+	g_pcmBytes = 0;
+	g_residentSounds = 0;
+}
 
-	if (audioFormat == 3 && wav.bitsPerSample == 32) {
-		// IEEE float32 [-1,1] -> int16
-		for (size_t i = 0; i + 3 < rawData.size(); i += 4) {
-			float f = 0.0f;
-			std::memcpy(&f, rawData.data() + i, 4);
-			if (f > 1.0f) f = 1.0f;
-			if (f < -1.0f) f = -1.0f;
-			int v = (int)std::lround(f * 32767.0f);
-			if (v > 32767) v = 32767;
-			if (v < -32768) v = -32768;
-			push_i16_le((std::int16_t)v);
+// Load a sound, or find it in g_sounds. The first call for a path hashes the
+// WAV (unless it is packed: the pack's index has its source hash) and converts it
+// in memory, or reads it from the cache; with OpenAL, clips of up to
+// kStreamThreshold converted bytes are kept in memory and longer ones are
+// streamed from the cache file when played. The software mixer keeps every
+// clip in memory. Sounds in memory are ADPCM-compressed if
+// set_compression(true) was called. A WAV in the asset pack is not read at
+// all when its converted samples are cached, and is used as it is when it
+// is already in the device's format.
+static const Sound* get_sound(const std::string& soundPath) {
+	if (g_missingSounds.find(soundPath) != g_missingSounds.end())
+		return nullptr;
+	auto found = g_sounds.find(soundPath);
+	if (found != g_sounds.end()) return &found->second;
+
+	Sound sound;
+	sound.path = soundPath;
+	std::uint64_t hash = 0;
+	std::vector<std::int16_t> samples;
+	const assets::Asset* packed = assets::find(soundPath);
+	bool ok = true;
+	if (packed) hash = packed->source.hash; // stored in the pack's index: nothing to read
+	else ok = hash_file(soundPath, hash);
+	if (ok && !(packed && use_packed(sound, *packed, samples))) {
+		std::string cached = cache_path(soundPath);
+		if (read_cache(cached, hash, sound.info)) {
+			sound.file = cached;
+			ok = !resident(sound.info) || read_samples(sound, samples);
+		} else {
+			ok = convert_sound(sound, packed, hash, cached, samples);
 		}
-		wav.pcm = std::move(out);
-		wav.bitsPerSample = 16;
-		return true;
-	}
-
-	if (audioFormat == 1 && wav.bitsPerSample == 24) {
-		// Signed 24-bit PCM -> int16 (drop lowest 8 bits)
-		for (size_t i = 0; i + 2 < rawData.size(); i += 3) {
-			int v = (int)rawData[i] | ((int)rawData[i + 1] << 8) | ((int)rawData[i + 2] << 16);
-			// sign extend 24-bit
-			if (v & 0x800000) v |= ~0xFFFFFF;
-			v >>= 8;
-			if (v > 32767) v = 32767;
-			if (v < -32768) v = -32768;
-			push_i16_le((std::int16_t)v);
+	}
+#ifdef USE_OPENAL
+	if (ok && resident(sound.info)) {
+		if (g_compress) {
+			compress(samples, sound.info.channels, sound.adpcm);
+		} else {
+			sound.buffer = upload_samples(sound, samples);
+			ok = sound.buffer != 0;
 		}
-		wav.pcm = std::move(out);
-		wav.bitsPerSample = 16;
-		return true;
-	}
-
-	if (audioFormat == 1 && wav.bitsPerSample == 32) {
-		// Signed 32-bit PCM -> int16 (drop lowest 16 bits)
-		for (size_t i = 0; i + 3 < rawData.size(); i += 4) {
-			std::int32_t v = (std::int32_t)((std::uint32_t)rawData[i] |
-				((std::uint32_t)rawData[i + 1] << 8) |
-				((std::uint32_t)rawData[i + 2] << 16) |
-				((std::uint32_t)rawData[i + 3] << 24));
-			v >>= 16;
-			if (v > 32767) v = 32767;
-			if (v < -32768) v = -32768;
-			push_i16_le((std::int16_t)v);
+	}
+#else
+	if (ok) {
+		sound.clip.channels = sound.info.channels;
+		sound.clip.sampleRate = sound.info.sampleRate;
+		if (g_compress) {
+			compress(samples, sound.info.channels, sound.clip.adpcm);
+			sound.clip.adpcmFrames = (int)(samples.size() / sound.info.channels);
+		} else {
+			sound.clip.samples.swap(samples);
 		}
-		wav.pcm = std::move(out);
-		wav.bitsPerSample = 16;
-		return true;
 	}
+#endif
+	if (!ok) {
+		std::cerr << "[audio] Failed to load WAV: " << soundPath << "\n";
+		g_missingSounds.insert(soundPath);
+		return nullptr;
+	}
+	if (resident(sound.info)) {
+		g_residentBytes += resident_bytes(sound);
+		g_pcmBytes += sound.info.dataSize;
+		g_residentSounds++;
+	}
+	sound.duration = (float)sound.info.dataSize / ((float)sound.info.sampleRate * block_align(sound.info));
+	return &g_sounds.emplace(soundPath, std::move(sound)).first->second;
+}
 
-	return false;
+#ifdef USE_OPENAL
+
+// Decode the next few blocks of a compressed sound into buf.
+static bool fill_adpcm_buffer(Stream& stream, ALuint buf) {
+	const Sound& sound = *stream.sound;
+	const int channels = sound.info.channels;
+	const std::uint32_t frames = sound.info.dataSize / block_align(sound.info);
+	const std::uint32_t blocks = (std::uint32_t)adpcm::block_count(frames);
+	const size_t blockBytes = adpcm::block_bytes(channels);
+	stream.pcm.resize((size_t)kAdpcmStreamBlocks * adpcm::kBlockFrames * channels);
+
+	std::uint32_t produced = 0;
+	for (int b = 0; b < kAdpcmStreamBlocks; b++) {
+		if (stream.block == blocks) {
+			if (!stream.loop) break;
+			stream.block = 0;
+		}
+		std::uint32_t first = stream.block * adpcm::kBlockFrames;
+		std::uint32_t n = std::min<std::uint32_t>(adpcm::kBlockFrames, frames - first);
+		std::int16_t* dst = stream.pcm.data() + (size_t)produced * channels;
+		adpcm::decode_block(&sound.adpcm[stream.block * blockBytes], channels, (int)n, dst);
+		if (stream.skip) {
+			std::memmove(dst, dst + (size_t)stream.skip * channels, (size_t)(n - stream.skip) * channels * 2);
+			n -= stream.skip;
+			stream.skip = 0;
+		}
+		produced += n;
+		stream.block++;
+	}
+	if (produced == 0) return false;
+	alBufferData(buf, stream.format, stream.pcm.data(), (ALsizei)(produced * channels * 2), (ALsizei)sound.info.sampleRate);
+	return true;
 }
 
-static ALenum to_al_format(const WavData& wav) {
-	if (wav.channels == 1 && wav.bitsPerSample == 8) return AL_FORMAT_MONO8;
-	if (wav.channels == 1 && wav.bitsPerSample == 16) return AL_FORMAT_MONO16;
-	if (wav.channels == 2 && wav.bitsPerSample == 8) return AL_FORMAT_STEREO8;
-	if (wav.channels == 2 && wav.bitsPerSample == 16) return AL_FORMAT_STEREO16;
-	return 0;
+// Read, convert and upload the next chunk of a stream into buf; a looping
+// stream wraps to the start of the clip. False once the clip is exhausted.
+static bool fill_stream_buffer(Stream& stream, ALuint buf) {
+	if (!stream.sound->adpcm.empty()) return fill_adpcm_buffer(stream, buf);
+	const WavInfo& info = stream.sound->info;
+	if (stream.remaining == 0 && stream.loop) {
+		stream.file.clear();
+		stream.file.seekg(info.dataOffset, std::ios::beg);
+		stream.remaining = info.dataSize;
+	}
+	if (stream.remaining == 0) return false;
+	std::uint32_t align = (std::uint32_t)block_align(info);
+	std::uint32_t bytes = kStreamChunkBytes - kStreamChunkBytes % align;
+	if (bytes > stream.remaining) bytes = stream.remaining;
+
+	// 16-bit data, which is what cache files hold, is read straight into
+	// place; anything else goes through raw and is converted.
+	stream.pcm.resize(bytes / (info.bitsPerSample / 8));
+	bool direct = info.bitsPerSample == 16;
+	if (!direct) stream.raw.resize(bytes);
+	char* dst = direct ? reinterpret_cast<char*>(stream.pcm.data()) : reinterpret_cast<char*>(stream.raw.data());
+	if (!stream.file.read(dst, bytes)) {
+		stream.remaining = 0;
+		return false;
+	}
+	stream.remaining -= bytes;
+
+	if (!direct) pcm::to_s16(stream.raw.data(), bytes, info, stream.pcm.data());
+	alBufferData(buf, stream.format, stream.pcm.data(), (ALsizei)(stream.pcm.size() * 2), (ALsizei)info.sampleRate);
+	return true;
 }
 
-static ALuint get_buffer(const std::string& soundPath) {
-	if (g_missingSounds.find(soundPath) != g_missingSounds.end())
-		return 0;
+static void end_stream(Stream& stream) {
+	if (!stream.active) return;
+	stream.active = false;
+	stream.file.close();
+	stream.remaining = 0;
+	stream.sound = nullptr;
+}
 
-	auto it = g_bufferCache.find(soundPath);
-	if (it != g_bufferCache.end()) return it->second;
+// Open a stream at `time` seconds into the clip and queue its first buffers
+// on src. Compressed sounds are decoded from memory; the others are read
+// from their file.
+static bool start_stream(Stream& stream, ALuint src, const Sound& sound, double time, bool loop) {
+	PROFILE_ZONE("audio::start_stream");
+	const WavInfo& info = sound.info;
+	std::uint32_t align = (std::uint32_t)block_align(info);
+	std::uint32_t frame = (std::uint32_t)(time * info.sampleRate);
+	if (frame >= info.dataSize / align) frame = 0;
+
+	if (sound.adpcm.empty()) {
+		stream.file.clear();
+		stream.file.open(sound.file, std::ios::binary);
+		if (!stream.file || !stream.file.seekg(info.dataOffset + frame * align, std::ios::beg)) {
+			stream.file.close();
+			return false;
+		}
+		stream.remaining = info.dataSize - frame * align;
+	} else {
+		stream.block = frame / adpcm::kBlockFrames;
+		stream.skip = frame % adpcm::kBlockFrames;
+	}
+	stream.sound = &sound;
+	stream.loop = loop;
+	stream.format = to_al_format(info.channels);
+	if (!stream.buffers[0]) alGenBuffers(kStreamBuffers, stream.buffers);
+
+	int queued = 0;
+	while (queued < kStreamBuffers && fill_stream_buffer(stream, stream.buffers[queued])) queued++;
+	if (queued == 0) {
+		stream.file.close();
+		return false;
+	}
+	alSourceQueueBuffers(src, queued, stream.buffers);
+	stream.active = true;
+	return true;
+}
 
-	WavData wav;
-	if (!load_wav_file(soundPath, wav)) {
-		std::cerr << "[audio] Failed to load WAV: " << soundPath << "\n";
-		g_missingSounds.insert(soundPath);
-		return 0;
+// Recycle played buffers of a stream. False once it has played to the end.
+static bool service_stream(Source& source) {
+	Stream& stream = source.stream;
+	if (!stream.active) return false;
+	ALuint src = source.id;
+
+	ALint processed = 0;
+	alGetSourcei(src, AL_BUFFERS_PROCESSED, &processed);
+	while (processed-- > 0) {
+		ALuint buf = 0;
+		alSourceUnqueueBuffers(src, 1, &buf);
+		if (fill_stream_buffer(stream, buf)) alSourceQueueBuffers(src, 1, &buf);
 	}
 
-	ALenum format = to_al_format(wav);
-	if (format == 0) {
-		std::cerr << "[audio] Unsupported WAV format: " << soundPath << "\n";
-		g_missingSounds.insert(soundPath);
-		return 0;
+	ALint state = 0;
+	ALint queued = 0;
+	alGetSourcei(src, AL_SOURCE_STATE, &state);
+	alGetSourcei(src, AL_BUFFERS_QUEUED, &queued);
+	if (state == AL_STOPPED) {
+		if (queued > 0) {
+			alSourcePlay(src); // ran dry before the refill: resume
+		} else {
+			end_stream(stream); // played to the end
+			return false;
+		}
 	}
+	return true;
+}
 
-	ALuint buffer = 0;
-	alGenBuffers(1, &buffer);
-	alBufferData(buffer, format, wav.pcm.data(), (ALsizei)wav.pcm.size(), (ALsizei)wav.sampleRate);
+static void apply_voice_params(const Voice& voice, int s) {
+	ALuint src = g_sources[s].id;
+	alSourcef(src, AL_GAIN, voice.gain);
+	if (voice.relative) {
+		alSource3f(src, AL_POSITION, 0.0f, 0.0f, 0.0f);
+	} else {
+		alSource3f(src, AL_POSITION, voice.position.x, voice.position.y, voice.position.z);
+	}
+}
 
-	ALenum err = alGetError();
-	if (err != AL_NO_ERROR) {
-		std::cerr << "[audio] OpenAL error loading buffer: " << soundPath << "\n";
-		if (buffer) alDeleteBuffers(1, &buffer);
-		g_missingSounds.insert(soundPath);
-		return 0;
+// Give a virtual voice a free source and start it from its playback clock.
+static bool realize(int v, int s) {
+	Voice& voice = g_voices[v];
+	Source& source = g_sources[s];
+	const Sound& sound = *voice.sound;
+	ALuint src = source.id;
+
+	alSourcei(src, AL_BUFFER, (ALint)sound.buffer); // 0 also clears a stream's queue
+	alSourcef(src, AL_PITCH, 1.0f);
+	alSource3f(src, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+	alSourcei(src, AL_SOURCE_RELATIVE, voice.relative ? AL_TRUE : AL_FALSE);
+	alSourcef(src, AL_REFERENCE_DISTANCE, kRefDistance);
+	alSourcef(src, AL_MAX_DISTANCE, kMaxDistance);
+	alSourcef(src, AL_ROLLOFF_FACTOR, kRolloff);
+	apply_voice_params(voice, s);
+
+	if (sound.buffer) {
+		alSourcei(src, AL_LOOPING, voice.loop ? AL_TRUE : AL_FALSE);
+		if (voice.time > 0.0) alSourcef(src, AL_SEC_OFFSET, (ALfloat)voice.time);
+	} else {
+		alSourcei(src, AL_LOOPING, AL_FALSE);
+		if (!start_stream(source.stream, src, sound, voice.time, voice.loop)) return false;
 	}
+	alSourcePlay(src);
+	source.voice = v;
+	voice.source = s;
+	voice.moved = false;
+	return true;
+}
 
-	g_bufferCache.emplace(soundPath, buffer);
-	return buffer;
+// Take the source back from a voice; it carries on as a virtual voice.
+static void virtualize(Voice& voice) {
+	if (voice.source < 0) return;
+	Source& source = g_sources[voice.source];
+	alSourceStop(source.id);
+	alSourcei(source.id, AL_BUFFER, 0);
+	end_stream(source.stream);
+	source.voice = -1;
+	voice.source = -1;
+}
+
+static bool source_playing(Source& source) {
+	if (source.stream.active) return service_stream(source);
+	ALint state = 0;
+	alGetSourcei(source.id, AL_SOURCE_STATE, &state);
+	return state != AL_STOPPED;
+}
+#else
+static void apply_voice_params(const Voice& voice, int s) {
+	int channel = g_sources[s].channel;
+	const float position[3] = {voice.position.x, voice.position.y, voice.position.z};
+	g_mixer.set_gain(channel, voice.gain);
+	g_mixer.set_position(channel, position, voice.relative);
+}
+
+static bool realize(int v, int s) {
+	Voice& voice = g_voices[v];
+	Source& source = g_sources[s];
+	const mixer::Clip& clip = voice.sound->clip;
+	int channel = g_mixer.play(&clip, voice.time * clip.sampleRate, voice.loop);
+	if (channel < 0) return false;
+	source.channel = channel;
+	source.voice = v;
+	voice.source = s;
+	apply_voice_params(voice, s);
+	voice.moved = false;
+	return true;
+}
+
+static void virtualize(Voice& voice) {
+	if (voice.source < 0) return;
+	Source& source = g_sources[voice.source];
+	g_mixer.stop(source.channel);
+	source.channel = -1;
+	source.voice = -1;
+	voice.source = -1;
 }
 
-static ALuint acquire_source() {
-	for (ALuint src : g_sources) {
-		ALint state = 0;
-		alGetSourcei(src, AL_SOURCE_STATE, &state);
-		if (state != AL_PLAYING) return src;
+static bool source_playing(Source& source) {
+	return g_mixer.playing(source.channel);
+}
+#endif
+
+// Whether the voice is attenuated and panned; OpenAL does neither for
+// stereo clips or listener-relative sources, and the mixer follows it.
+static bool spatial(const Voice& voice) {
+	return !voice.relative && voice.sound->info.channels == 1;
+}
+
+// Estimated gain at the listener, with the same distance model as the
+// sources (AL_INVERSE_DISTANCE_CLAMPED).
+static float audibility(const Voice& voice) {
+	if (!spatial(voice)) return voice.gain;
+	Vec3 d{voice.position.x - g_listenerPos.x, voice.position.y - g_listenerPos.y, voice.position.z - g_listenerPos.z};
+	float dist = len(d);
+	if (dist > kMaxDistance) return 0.0f;
+	if (dist < kRefDistance) dist = kRefDistance;
+	return voice.gain * kRefDistance / (kRefDistance + kRolloff * (dist - kRefDistance));
+}
+
+static void retire(Voice& voice) {
+	virtualize(voice);
+	voice.active = false;
+	voice.sound = nullptr;
+	voice.emitter = 0;
+}
+
+static Voice* find_emitter(std::uint32_t emitter) {
+	for (Voice& voice : g_voices)
+		if (voice.active && voice.emitter == emitter) return &voice;
+	return nullptr;
+}
+
+// Claim a voice slot for a new sound. When all are taken, the least
+// important voice makes way if it ranks below the new one, comparing gains
+// at the listener as update_voices() does.
+static Voice* start_voice(const char* soundPath, int priority, float gain, Vec3 position, bool relative) {
+	const Sound* sound = get_sound(soundPath);
+	if (!sound) return nullptr;
+
+	Voice started;
+	started.active = true;
+	started.sound = sound;
+	started.priority = priority;
+	started.gain = gain;
+	started.position = position;
+	started.relative = relative;
+	started.audibility = audibility(started);
+
+	Voice* slot = nullptr;
+	for (Voice& voice : g_voices) {
+		if (!voice.active) {
+			slot = &voice;
+			break;
+		}
+		if (!slot || voice.priority < slot->priority ||
+			(voice.priority == slot->priority && voice.audibility < slot->audibility))
+			slot = &voice;
+	}
+	if (slot->active) {
+		if (slot->priority > priority || (slot->priority == priority && slot->audibility >= started.audibility))
+			return nullptr;
+		retire(*slot);
+	}
+
+	*slot = started;
+	return slot;
+}
+
+// Advance every voice by dt seconds, then hand the sources to the highest
+// priority, loudest audible voices.
+static void update_voices(double dt) {
+	PROFILE_ZONE("audio::voices");
+	int ranked[kMaxVoices];
+	int count = 0;
+	for (int v = 0; v < kMaxVoices; v++) {
+		Voice& voice = g_voices[v];
+		if (!voice.active) continue;
+
+		if (!voice.fresh) voice.time += dt; // new voices start at the beginning
+		voice.fresh = false;
+		if (voice.source >= 0) {
+			if (!source_playing(g_sources[voice.source])) {
+				retire(voice);
+				continue;
+			}
+		}
+		if (voice.time >= voice.sound->duration) {
+			if (voice.loop) {
+				voice.time = std::fmod(voice.time, (double)voice.sound->duration);
+			} else if (voice.source < 0) {
+				retire(voice);
+				continue;
+			} else {
+				voice.time = voice.sound->duration; // OpenAL says when it ends
+			}
+		}
+
+		voice.audibility = audibility(voice);
+		if (voice.audibility < kAudibleGain) {
+			virtualize(voice);
+			continue;
+		}
+		ranked[count++] = v;
+	}
+
+	auto score = [](const Voice& voice) {
+		return voice.source >= 0 ? voice.audibility * kKeepBias : voice.audibility;
+	};
+	std::sort(ranked, ranked + count, [&](int a, int b) {
+		const Voice& va = g_voices[a];
+		const Voice& vb = g_voices[b];
+		if (va.priority != vb.priority) return va.priority > vb.priority;
+		return score(va) > score(vb);
+	});
+
+	int real = count < kMaxSources ? count : kMaxSources;
+	for (int i = real; i < count; i++) virtualize(g_voices[ranked[i]]);
+	int next = 0;
+	for (int i = 0; i < real; i++) {
+		Voice& voice = g_voices[ranked[i]];
+		if (voice.source >= 0) {
+			if (voice.moved) apply_voice_params(voice, voice.source);
+			voice.moved = false;
+			continue;
+		}
+		while (next < kMaxSources && g_sources[next].voice >= 0) next++;
+		if (next == kMaxSources) break;
+		if (!realize(ranked[i], next)) retire(voice);
 	}
+}
 
-	ALuint src = 0;
-	alGenSources(1, &src);
-	if (!src) return 0;
-	g_sources.push_back(src);
-	return src;
+// The audio thread owns the backend: it opens the AL device and runs every
+// AL call (or runs the software mixer), loads sounds and refills streams.
+// The public functions only push a Command into a lock-free queue, so the
+// game loop never waits on the driver, on file I/O or on a lock. Like GLUT, the public functions must be called from
+// one thread (the main thread).
+
+struct Command {
+	enum Type { Preload, Play3D, PlayUI, PlayStep, Stop, StopAll, Listener, AddEmitter, MoveEmitter, RemoveEmitter };
+	Type type = StopAll;
+	Channel channel = Channel::ACTION;
+	int priority = kPriorityNormal;
+	std::uint32_t emitter = 0;
+	float gain = 1.0f;
+	Vec3 position{0, 0, 0};
+	Vec3 forward{0, 0, -1};
+	Vec3 up{0, 1, 0};
+	char path[128] = {};
+};
+
+static SpscRing<Command, 512> g_commands; // pushed by the main thread only
+static std::thread g_audioThread;
+static std::atomic<bool> g_audioRun{false};
+static std::mutex g_wakeMutex;
+static std::condition_variable g_wake;
+
+// Caller side: the last listener pose sent to the audio thread.
+static bool g_poseSent = false;
+static Vec3 g_sentPos{0, 0, 0};
+static Vec3 g_sentForward{0, 0, -1};
+static Vec3 g_sentUp{0, 1, 0};
+// A listener update is only sent once the pose moves further than this, or
+// turns by more than about 0.8 degrees.
+static const float kListenerMoveEpsilon = 0.01f;
+static const float kListenerTurnCos = 0.9999f;
+
+static bool send(const Command& cmd) {
+	if (!g_commands.push(cmd)) return false; // full: drop rather than block
+	g_wake.notify_one();
+	return true;
 }
 
-static ALuint channel_source(Channel channel) {
-	switch (channel) {
-	case Channel::UI: return g_uiSource;
-	case Channel::STEP: return g_stepSource;
-	case Channel::ACTION: return g_actionSource;
-	default: return g_actionSource;
+static bool set_path(Command& cmd, const std::string& soundPath) {
+	if (soundPath.size() >= sizeof(cmd.path)) {
+		std::cerr << "[audio] Sound path too long: " << soundPath << "\n";
+		return false;
 	}
+	std::memcpy(cmd.path, soundPath.c_str(), soundPath.size() + 1);
+	return true;
 }
-#endif
 
-} // namespace
+static float dot(Vec3 a, Vec3 b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
 
-bool init() {
 #ifdef USE_OPENAL
-	if (g_inited) return true;
-
+static bool open_device() {
 	g_device = alcOpenDevice(nullptr);
 	if (!g_device) {
 		std::cerr << "[audio] alcOpenDevice failed\n";
@@ -300,152 +907,393 @@ bool init() {
 		g_device = nullptr;
 		return false;
 	}
+	ALCint freq = 0;
+	alcGetIntegerv(g_device, ALC_FREQUENCY, 1, &freq);
+	if (freq > 0) g_deviceRate = freq;
 
 	// Reasonable defaults for 3D.
 	alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
 	alListenerf(AL_GAIN, 1.0f);
 
-	// Dedicated channels so common sounds don't overlap.
-	alGenSources(1, &g_uiSource);
-	alGenSources(1, &g_stepSource);
-	alGenSources(1, &g_actionSource);
-	g_sources.push_back(g_uiSource);
-	g_sources.push_back(g_stepSource);
-	g_sources.push_back(g_actionSource);
-
-	g_inited = true;
+	// The voice pool's sources, allocated once.
+	for (Source& source : g_sources) {
+		alGenSources(1, &source.id);
+		if (alGetError() != AL_NO_ERROR) {
+			std::cerr << "[audio] alGenSources failed\n";
+			source.id = 0;
+			break;
+		}
+	}
 	return true;
-#else
-	return false;
-#endif
 }
 
-void shutdown() {
-#ifdef USE_OPENAL
-	if (!g_inited) return;
+static void close_device() {
+	for (Voice& voice : g_voices) retire(voice);
 
-	for (ALuint src : g_sources) {
-		alSourceStop(src);
-		alDeleteSources(1, &src);
+	for (Source& source : g_sources) {
+		if (source.id) alDeleteSources(1, &source.id);
+		source.id = 0;
+		Stream& stream = source.stream;
+		if (stream.buffers[0]) alDeleteBuffers(kStreamBuffers, stream.buffers);
+		for (ALuint& buf : stream.buffers) buf = 0;
 	}
-	g_sources.clear();
-	g_uiSource = 0;
-	g_stepSource = 0;
-	g_actionSource = 0;
 
-	for (auto& kv : g_bufferCache) {
-		ALuint buf = kv.second;
+	for (auto& kv : g_sounds) {
+		ALuint buf = kv.second.buffer;
 		if (buf) alDeleteBuffers(1, &buf);
 	}
-	g_bufferCache.clear();
-	g_missingSounds.clear();
+	forget_sounds();
 
 	alcMakeContextCurrent(nullptr);
 	if (g_context) alcDestroyContext(g_context);
 	if (g_device) alcCloseDevice(g_device);
 	g_context = nullptr;
 	g_device = nullptr;
-	g_inited = false;
+}
+
+static void do_listener(const Command& cmd) {
+	g_listenerPos = cmd.position;
+	Vec3 f = normalize(cmd.forward);
+	Vec3 u = normalize(cmd.up);
+
+	alListener3f(AL_POSITION, cmd.position.x, cmd.position.y, cmd.position.z);
+	float ori[6] = {f.x, f.y, f.z, u.x, u.y, u.z};
+	alListenerfv(AL_ORIENTATION, ori);
+}
+#else
+static bool open_device() {
+	g_mixer.set_distance_model(kRefDistance, kMaxDistance, kRolloff);
+	g_mixBuffer.assign(kMixBlock * 2, 0.0f);
+	g_framesMixed = 0;
+	if (!g_outputPath.empty() && !g_output.open(g_outputPath, kOutputRate))
+		std::cerr << "[audio] Cannot write " << g_outputPath << ", mixing to a null sink\n";
+	if (g_roomSet) {
+		PROFILE_ZONE("audio::room_response");
+		std::vector<float> left, right;
+		reverb::impulse_response(g_room, kOutputRate, kReverbMaxSeconds, left, right);
+		g_reverb.reset(new reverb::Convolver(left, right));
+		g_reverbSend.assign(kMixBlock, 0.0f);
+	}
+	return true;
+}
+
+static void close_device() {
+	for (Voice& voice : g_voices) retire(voice);
+	forget_sounds();
+	g_reverb.reset();
+	g_output.close();
+}
+
+static void do_listener(const Command& cmd) {
+	g_listenerPos = cmd.position;
+	Vec3 f = normalize(cmd.forward);
+	Vec3 u = normalize(cmd.up);
+	const float position[3] = {cmd.position.x, cmd.position.y, cmd.position.z};
+	const float forward[3] = {f.x, f.y, f.z};
+	const float up[3] = {u.x, u.y, u.z};
+	g_mixer.set_listener(position, forward, up);
+}
+
+// Mix whole blocks up to `elapsed` seconds of output, so the sink advances
+// in real time. After a stall of more than 250 ms the gap is skipped rather
+// than mixed in one burst.
+static void apply_reverb() {
+	PROFILE_ZONE("audio::reverb");
+	for (int i = 0; i < kMixBlock; i++) g_reverbSend[i] = 0.5f * (g_mixBuffer[2 * i] + g_mixBuffer[2 * i + 1]);
+	g_reverb->process(g_reverbSend.data(), g_mixBuffer.data(), kMixBlock, kReverbWet);
+}
+
+static void render_output(double elapsed) {
+	PROFILE_ZONE("audio::mix");
+	long long due = (long long)(elapsed * kOutputRate);
+	if (due - g_framesMixed > kOutputRate / 4) g_framesMixed = due - kOutputRate / 4;
+	while (g_framesMixed + kMixBlock <= due) {
+		g_mixer.mix(g_mixBuffer.data(), kMixBlock);
+		if (g_reverb) apply_reverb();
+		g_output.write(g_mixBuffer.data(), kMixBlock);
+		g_framesMixed += kMixBlock;
+	}
+}
 #endif
+
+// One-shots on the ACTION channel replace each other (assembling cancels
+// the disassembly sound); other channels overlap freely.
+static void do_play(const Command& cmd, Vec3 position, bool relative) {
+	PROFILE_ZONE("audio::play");
+	if (cmd.channel == Channel::ACTION) {
+		for (Voice& voice : g_voices)
+			if (voice.active && !voice.emitter && voice.channel == Channel::ACTION) retire(voice);
+	}
+	Voice* voice = start_voice(cmd.path, cmd.priority, cmd.gain, position, relative);
+	if (!voice) return;
+	voice->channel = cmd.channel;
 }
 
-void preload_defaults() {
-#ifdef USE_OPENAL
-	if (!g_inited) return;
-	(void)get_buffer("data/sfx/ui_click.wav");
-	(void)get_buffer("data/sfx/enter.wav");
-	(void)get_buffer("data/sfx/disassemble.wav");
-	(void)get_buffer("data/sfx/assemble.wav");
-	(void)get_buffer("data/sfx/step.wav");
+static void run_command(const Command& cmd) {
+	switch (cmd.type) {
+	case Command::Preload: (void)get_sound(cmd.path); break;
+	case Command::Play3D: do_play(cmd, cmd.position, false); break;
+	case Command::PlayUI: do_play(cmd, Vec3{0, 0, 0}, true); break;
+	case Command::PlayStep: do_play(cmd, g_listenerPos, false); break;
+	case Command::Stop:
+		for (Voice& voice : g_voices)
+			if (voice.active && !voice.emitter && voice.channel == cmd.channel) retire(voice);
+		break;
+	case Command::StopAll:
+		for (Voice& voice : g_voices)
+			if (voice.active && !voice.emitter) retire(voice);
+		break;
+	case Command::Listener: do_listener(cmd); break;
+	case Command::AddEmitter: {
+		Voice* voice = start_voice(cmd.path, cmd.priority, cmd.gain, cmd.position, false);
+		if (!voice) break;
+		voice->emitter = cmd.emitter;
+		voice->loop = true;
+		break;
+	}
+	case Command::MoveEmitter:
+		if (Voice* voice = find_emitter(cmd.emitter)) {
+			voice->position = cmd.position;
+			voice->moved = true;
+		}
+		break;
+	case Command::RemoveEmitter:
+		if (Voice* voice = find_emitter(cmd.emitter)) retire(*voice);
+		break;
+	}
+}
+
+// Execute everything queued so far. Consecutive listener updates collapse
+// into the last one; it is applied before the next command that follows it,
+// so a sound is still positioned against the pose it was requested with.
+static void run_commands() {
+	PROFILE_ZONE("audio::commands");
+	Command cmd;
+	Command pose;
+	bool havePose = false;
+	while (g_commands.pop(cmd)) {
+		if (cmd.type == Command::Listener) {
+			pose = cmd;
+			havePose = true;
+			continue;
+		}
+		if (havePose) {
+			do_listener(pose);
+			havePose = false;
+		}
+		run_command(cmd);
+	}
+	if (havePose) do_listener(pose);
+}
+
+static void audio_thread(std::promise<bool>* opened) {
+	profiler::set_thread_name("audio");
+	bool ok = open_device();
+	opened->set_value(ok);
+	if (!ok) return;
+
+	auto start = std::chrono::steady_clock::now();
+	auto last = start;
+	while (g_audioRun.load(std::memory_order_acquire)) {
+		run_commands();
+		auto now = std::chrono::steady_clock::now();
+		update_voices(std::chrono::duration<double>(now - last).count());
+		last = now;
+#ifndef USE_OPENAL
+		render_output(std::chrono::duration<double>(now - start).count());
 #endif
+		// Woken early by send(); the timeout paces voice updates, stream
+		// refills and mixing.
+		std::unique_lock<std::mutex> lock(g_wakeMutex);
+		g_wake.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	// Commands still queued at shutdown are dropped.
+	Command cmd;
+	while (g_commands.pop(cmd)) {}
+	close_device();
 }
 
-void update_listener(Vec3 position, Vec3 forward, Vec3 up) {
-#ifdef USE_OPENAL
-	if (!g_inited) return;
+} // namespace
 
-	g_listenerPos = position;
-	Vec3 f = normalize(forward);
-	Vec3 u = normalize(up);
+bool init() {
+	PROFILE_ZONE("audio::init");
+	if (g_inited) return true;
 
-	alListener3f(AL_POSITION, position.x, position.y, position.z);
-	float ori[6] = {f.x, f.y, f.z, u.x, u.y, u.z};
-	alListenerfv(AL_ORIENTATION, ori);
+	// Wait for the audio thread to open the device, so failure is reported
+	// here as before.
+	std::promise<bool> opened;
+	std::future<bool> result = opened.get_future();
+	g_audioRun.store(true, std::memory_order_release);
+	g_audioThread = std::thread(audio_thread, &opened);
+	if (!result.get()) {
+		g_audioRun.store(false, std::memory_order_release);
+		g_audioThread.join();
+		return false;
+	}
+
+	g_poseSent = false;
+	g_inited = true;
+	return true;
+}
+
+void set_output_file(const std::string& path) {
+#ifdef USE_OPENAL
+	(void)path;
+#else
+	if (!g_inited) g_outputPath = path;
 #endif
 }
 
-void play3d(const std::string& soundPath, Vec3 position, float gain, Channel channel) {
+void set_room(Vec3 min, Vec3 max, float absorption) {
 #ifdef USE_OPENAL
-	if (!g_inited) return;
+	(void)min;
+	(void)max;
+	(void)absorption;
+#else
+	if (g_inited) return;
+	g_room.width = std::fabs(max.x - min.x);
+	g_room.height = std::fabs(max.y - min.y);
+	g_room.depth = std::fabs(max.z - min.z);
+	g_room.absorption = absorption;
+	g_roomSet = true;
+#endif
+}
 
-	ALuint buffer = get_buffer(soundPath);
-	if (!buffer) return;
+void set_compression(bool enabled) {
+	if (!g_inited) g_compress = enabled;
+}
 
-	ALuint src = channel_source(channel);
-	if (!src) return;
+MemoryStats memory_stats() {
+	MemoryStats stats;
+	stats.residentBytes = g_residentBytes.load(std::memory_order_relaxed);
+	stats.pcmBytes = g_pcmBytes.load(std::memory_order_relaxed);
+	stats.sounds = g_residentSounds.load(std::memory_order_relaxed);
+	return stats;
+}
 
-	alSourceStop(src);
-	alSourcei(src, AL_BUFFER, (ALint)buffer);
-	alSource3f(src, AL_POSITION, position.x, position.y, position.z);
-	alSource3f(src, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-	alSourcef(src, AL_GAIN, gain);
-	alSourcef(src, AL_PITCH, 1.0f);
-	alSourcei(src, AL_LOOPING, AL_FALSE);
+void shutdown() {
+	PROFILE_ZONE("audio::shutdown");
+	if (!g_inited) return;
 
-	// Make sure it's treated as positional.
-	alSourcei(src, AL_SOURCE_RELATIVE, AL_FALSE);
-	alSourcef(src, AL_REFERENCE_DISTANCE, 2.0f);
-	alSourcef(src, AL_MAX_DISTANCE, 50.0f);
-	alSourcef(src, AL_ROLLOFF_FACTOR, 1.0f);
+	g_audioRun.store(false, std::memory_order_release);
+	g_wake.notify_one();
+	if (g_audioThread.joinable()) g_audioThread.join();
+	g_inited = false;
+}
 
-	alSourcePlay(src);
-#endif
+void preload_defaults() {
+	PROFILE_ZONE("audio::preload_defaults");
+	if (!g_inited) return;
+	// Loose WAVs are hashed in full, and converted on a cache miss; with
+	// OpenAL, large clips then stream from the cache file when played.
+	const char* defaults[] = {"data/sfx/ui_click.wav", "data/sfx/enter.wav", "data/sfx/disassemble.wav",
+		"data/sfx/assemble.wav", "data/sfx/step.wav"};
+	for (const char* path : defaults) {
+		Command cmd;
+		cmd.type = Command::Preload;
+		if (set_path(cmd, path)) send(cmd);
+	}
 }
 
-void play_ui(const std::string& soundPath, float gain) {
-#ifdef USE_OPENAL
+void update_listener(Vec3 position, Vec3 forward, Vec3 up) {
+	PROFILE_ZONE("audio::update_listener");
 	if (!g_inited) return;
-	ALuint buffer = get_buffer(soundPath);
-	if (!buffer) return;
-	ALuint src = channel_source(Channel::UI);
-	if (!src) return;
-
-	alSourceStop(src);
-	alSourcei(src, AL_BUFFER, (ALint)buffer);
-	alSourcef(src, AL_GAIN, gain);
-	alSourcef(src, AL_PITCH, 1.0f);
-	alSourcei(src, AL_LOOPING, AL_FALSE);
 
-	// UI sounds: not spatial (relative to listener).
-	alSourcei(src, AL_SOURCE_RELATIVE, AL_TRUE);
-	alSource3f(src, AL_POSITION, 0.0f, 0.0f, 0.0f);
-	alSource3f(src, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+	Vec3 f = normalize(forward);
+	Vec3 u = normalize(up);
+	if (g_poseSent) {
+		Vec3 d{position.x - g_sentPos.x, position.y - g_sentPos.y, position.z - g_sentPos.z};
+		bool moved = len(d) > kListenerMoveEpsilon;
+		bool turned = dot(f, g_sentForward) < kListenerTurnCos || dot(u, g_sentUp) < kListenerTurnCos;
+		if (!moved && !turned) return;
+	}
 
-	alSourcePlay(src);
-#endif
+	Command cmd;
+	cmd.type = Command::Listener;
+	cmd.position = position;
+	cmd.forward = f;
+	cmd.up = u;
+	if (!send(cmd)) return; // retried next frame
+	g_poseSent = true;
+	g_sentPos = position;
+	g_sentForward = f;
+	g_sentUp = u;
+}
+
+void play3d(const std::string& soundPath, Vec3 position, float gain, Channel channel, int priority) {
+	if (!g_inited) return;
+	Command cmd;
+	cmd.type = Command::Play3D;
+	cmd.channel = channel;
+	cmd.priority = priority;
+	cmd.gain = gain;
+	cmd.position = position;
+	if (set_path(cmd, soundPath)) send(cmd);
+}
+
+void play_ui(const std::string& soundPath, float gain) {
+	if (!g_inited) return;
+	Command cmd;
+	cmd.type = Command::PlayUI;
+	cmd.channel = Channel::UI;
+	cmd.priority = kPriorityHigh;
+	cmd.gain = gain;
+	if (set_path(cmd, soundPath)) send(cmd);
 }
 
 void play_step(const std::string& soundPath, float gain) {
-#ifdef USE_OPENAL
-	play3d(soundPath, g_listenerPos, gain, Channel::STEP);
-#endif
+	if (!g_inited) return;
+	// Positioned at the listener as the audio thread last saw it.
+	Command cmd;
+	cmd.type = Command::PlayStep;
+	cmd.channel = Channel::STEP;
+	cmd.gain = gain;
+	if (set_path(cmd, soundPath)) send(cmd);
 }
 
 void stop(Channel channel) {
-#ifdef USE_OPENAL
 	if (!g_inited) return;
-	ALuint src = channel_source(channel);
-	if (src) alSourceStop(src);
-#endif
+	Command cmd;
+	cmd.type = Command::Stop;
+	cmd.channel = channel;
+	send(cmd);
 }
 
 void stop_all() {
-#ifdef USE_OPENAL
 	if (!g_inited) return;
-	for (ALuint src : g_sources) {
-		if (src) alSourceStop(src);
-	}
-#endif
+	Command cmd;
+	cmd.type = Command::StopAll;
+	send(cmd);
+}
+
+Emitter add_emitter(const std::string& soundPath, Vec3 position, float gain, int priority) {
+	if (!g_inited) return 0;
+	static Emitter nextEmitter = 0;
+	Command cmd;
+	cmd.type = Command::AddEmitter;
+	cmd.emitter = ++nextEmitter;
+	cmd.priority = priority;
+	cmd.gain = gain;
+	cmd.position = position;
+	if (!set_path(cmd, soundPath) || !send(cmd)) return 0;
+	return cmd.emitter;
+}
+
+void move_emitter(Emitter emitter, Vec3 position) {
+	if (!g_inited || !emitter) return;
+	Command cmd;
+	cmd.type = Command::MoveEmitter;
+	cmd.emitter = emitter;
+	cmd.position = position;
+	send(cmd);
+}
+
+void remove_emitter(Emitter emitter) {
+	if (!g_inited || !emitter) return;
+	Command cmd;
+	cmd.type = Command::RemoveEmitter;
+	cmd.emitter = emitter;
+	send(cmd);
 }
 
 } // namespace audio
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace audio {
@@ -16,20 +18,61 @@ enum class Channel {
 	ACTION,
 };
 
-// When USE_OPENAL is not defined (default), all functions become no-ops
-// so the project builds without extra dependencies.
+// Sounds play through OpenAL when the project is built with USE_OPENAL.
+// Otherwise (the default, so the project builds without extra
+// dependencies) they are mixed in software (mixer.h) into a WAV file or a
+// null sink, so the same code runs on machines without a sound device.
+//
+// A background audio thread does the work: apart from init() and
+// shutdown() these functions only queue a command and return. Call them
+// from the main thread.
 
 bool init();
 void shutdown();
 
+// Software mixer only: write the mix to a 16-bit stereo WAV file instead of
+// discarding it. Call before init().
+void set_output_file(const std::string& path);
+
+// Software mixer only: add the reverberation of a box-shaped room (its
+// corners, in metres) to the mix, convolved on the audio thread with
+// about 5 ms of latency. absorption is the average absorption of the
+// surfaces, 0..1. Off unless called; call before init().
+void set_room(Vec3 min, Vec3 max, float absorption = 0.3f);
+
+// Keep loaded sounds in memory as IMA-ADPCM, at about a quarter of their
+// 16-bit size, and decode them just in time as they play. The coding is
+// lossy, and with OpenAL every compressed sound plays through a streaming
+// refill instead of one static buffer, so it is off by default: use it
+// where sound memory matters more. Call before init().
+void set_compression(bool enabled);
+
+// Sample data held in memory by loaded sounds (sounds streamed from disk
+// hold none). Can be called from any thread.
+struct MemoryStats {
+	std::size_t residentBytes = 0; // as held, compressed or not
+	std::size_t pcmBytes = 0;      // the same sounds as 16-bit PCM
+	int sounds = 0;
+};
+MemoryStats memory_stats();
+
 // Preload commonly used sfx (safe to call even if init() failed).
 void preload_defaults();
 
 // Update 3D listener (camera) each frame.
 void update_listener(Vec3 position, Vec3 forward, Vec3 up);
 
-// Play a one-shot sound at a world position.
-void play3d(const std::string& soundPath, Vec3 position, float gain = 1.0f, Channel channel = Channel::ACTION);
+// When more sounds play than there are hardware voices, the highest
+// priority (then the loudest) are heard; the rest keep their place in the
+// clip silently and resume when a voice frees up.
+const int kPriorityLow = 0;
+const int kPriorityNormal = 50;
+const int kPriorityHigh = 100;
+
+// Play a one-shot sound at a world position. A new ACTION sound replaces
+// the previous one; UI and STEP sounds overlap.
+void play3d(const std::string& soundPath, Vec3 position, float gain = 1.0f, Channel channel = Channel::ACTION,
+	int priority = kPriorityNormal);
 
 // Convenience: play at listener position (non-spatial UI click).
 void play_ui(const std::string& soundPath, float gain = 1.0f);
@@ -37,8 +80,15 @@ void play_ui(const std::string& soundPath, float gain = 1.0f);
 // Convenience: step/movement sound (throttled by caller).
 void play_step(const std::string& soundPath, float gain = 1.0f);
 
-// Stop playback on a channel.
+// Stop the one-shots playing on a channel (emitters keep playing).
 void stop(Channel channel);
 void stop_all();
 
+// Looping sound attached to a scene object (a fan, a PSU...). Far away or
+// quiet emitters cost no hardware voice. Returns 0 when audio is off.
+typedef std::uint32_t Emitter;
+Emitter add_emitter(const std::string& soundPath, Vec3 position, float gain = 1.0f, int priority = kPriorityLow);
+void move_emitter(Emitter emitter, Vec3 position);
+void remove_emitter(Emitter emitter);
+
 } // namespace audio
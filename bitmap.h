@@ -2,10 +2,15 @@
 #define BITMAP
 
 #include <GL/glut.h>
+#include "glcount.h"
+#include "text.h"
 
-void* times10 = GLUT_BITMAP_TIMES_ROMAN_10;
-void* helv18 = GLUT_BITMAP_HELVETICA_18;
-void* helv12 = GLUT_BITMAP_HELVETICA_12;
+const text::Font times10 = text::Font::TimesRoman10;
+const text::Font helv18 = text::Font::Helvetica18;
+const text::Font helv12 = text::Font::Helvetica12;
+
+// The front page is drawn 3.5 units up (see the glTranslatef calls below).
+const float pageOffsetY = 3.5f;
 
 float prog;
 
@@ -13,39 +18,31 @@ void renderBitmapString(
 	float x,
 	float y,
 	float z,
-	void* font,
-	char* string) {
+	text::Font font,
+	const char* string,
+	text::Color color = {1.0f, 1.0f, 1.0f, 1.0f}) {
 
-	char* c;
-	glRasterPos3f(x, y, z);
-	for (c = string; *c != '\0'; c++) {
-		glutBitmapCharacter(font, *c);
-	}
+	text::draw_world(font, string, x, y + pageOffsetY, z, color);
 }
 
 void front_page()
 {
-	glPushMatrix();
-	glColor3f(1.0, 1.0, 1.0);
-	glTranslatef(0., 3.5, 0.);
-	renderBitmapString(-1.2f, 3.0f, -0.1f, (void*)helv18, (char*)"RV College Of Engineering");
-	renderBitmapString(-1.35f, 2.6f, -0.1f, (void*)helv18, (char*)"Computer Science Department");
-	renderBitmapString(-0.6f, 2.3f, -0.1f, (void*)helv12, (char*)"A MINI PROJECT ON");
-	renderBitmapString(-2.85f, 2.0f, -0.1f, (void*)helv18, (char*)"GRAPHICAL SIMULATION OF DESKTOP AND ITS COMPONENTS");
-
-	renderBitmapString(-1.5f, 1.5f, -0.1f, (void*)times10, (char*)"BY:");
-	renderBitmapString(-2.4f, 1.3f, -0.1f, (void*)helv12, (char*)"VIBHAV SIMHA");
-	renderBitmapString(-2.4f, 1.1f, -0.1f, (void*)helv12, (char*)"AARYAN P");
-	renderBitmapString(-2.4f, 0.9f, -0.1f, (void*)helv12, (char*)"SAMVIT SANAT GERSAPPA");
+	renderBitmapString(-1.2f, 3.0f, -0.1f, helv18, "RV College Of Engineering");
+	renderBitmapString(-1.35f, 2.6f, -0.1f, helv18, "Computer Science Department");
+	renderBitmapString(-0.6f, 2.3f, -0.1f, helv12, "A MINI PROJECT ON");
+	renderBitmapString(-2.85f, 2.0f, -0.1f, helv18, "GRAPHICAL SIMULATION OF DESKTOP AND ITS COMPONENTS");
 
-	glPopMatrix();
+	renderBitmapString(-1.5f, 1.5f, -0.1f, times10, "BY:");
+	renderBitmapString(-2.4f, 1.3f, -0.1f, helv12, "VIBHAV SIMHA");
+	renderBitmapString(-2.4f, 1.1f, -0.1f, helv12, "AARYAN P");
+	renderBitmapString(-2.4f, 0.9f, -0.1f, helv12, "SAMVIT SANAT GERSAPPA");
 }
 
 void progress_wheel(void)
 {
 	double i;
 	glPushMatrix();
-	glTranslatef(0., 3.5, 0.);
+	glTranslatef(0., pageOffsetY, 0.);
 	if (prog > 6.284f)
 		prog = 0.0f;
 	prog += 0.015f;
@@ -57,9 +54,10 @@ void progress_wheel(void)
 	}
 	glEnd();
 
-	renderBitmapString(-0.24f, 0.0f, -0.1f, (void*)helv12, (char*)"Loading...");
+	// Same color as the last point of the wheel.
+	renderBitmapString(-0.24f, 0.0f, -0.1f, helv12, "Loading...", {GLfloat((i - 0.08) / 6.284f), 0.0f, 0.0f, 1.0f});
 	glColor3f(1.0, 1.0, 1.0);
-	renderBitmapString(-0.68f, -0.4f, -0.2f, (void*)helv12, (char*)"Press ENTER to continue...");
+	renderBitmapString(-0.68f, -0.4f, -0.2f, helv12, "Press ENTER to continue...");
 
 	glPopMatrix();
 }
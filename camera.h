@@ -0,0 +1,162 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <GL/glut.h>
+#include <cmath>
+
+// Owns the view and projection matrices so the rest of the frame (picking,
+// projecting labels) can use them without reading GL state back.
+// Matrices are column-major, exactly as gluLookAt / gluPerspective build them.
+class Camera {
+private:
+    float viewMatrix[16];
+    float projectionMatrix[16];
+    int viewport[4] = {0, 0, 1, 1};
+    float eye[3] = {0.0f, 0.0f, 0.0f};
+    // Camera basis in world space (right, up, back) for building rays.
+    float right[3] = {1.0f, 0.0f, 0.0f};
+    float up[3] = {0.0f, 1.0f, 0.0f};
+    float back[3] = {0.0f, 0.0f, 1.0f};
+    float fovY = 80.0f;
+    float aspect = 1.0f;
+    float zNear = 0.7f;
+    float zFar = 100.0f;
+
+    static void identity(float* m) {
+        for (int i = 0; i < 16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+
+    static void normalize(float* v) {
+        float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (len <= 1e-12f) return;
+        v[0] /= len;
+        v[1] /= len;
+        v[2] /= len;
+    }
+
+    static void cross(const float* a, const float* b, float* out) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+public:
+    Camera() {
+        identity(viewMatrix);
+        identity(projectionMatrix);
+    }
+
+    void setViewport(int x, int y, int w, int h) {
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = w > 0 ? w : 1;
+        viewport[3] = h > 0 ? h : 1;
+    }
+
+    // Same matrix as gluPerspective(fovYDeg, aspectRatio, nearZ, farZ).
+    void setPerspective(float fovYDeg, float aspectRatio, float nearZ, float farZ) {
+        fovY = fovYDeg;
+        aspect = aspectRatio;
+        zNear = nearZ;
+        zFar = farZ;
+
+        float f = 1.0f / std::tan(fovYDeg * 0.5f * 3.14159265358979323846f / 180.0f);
+        identity(projectionMatrix);
+        projectionMatrix[0] = f / aspectRatio;
+        projectionMatrix[5] = f;
+        projectionMatrix[10] = (farZ + nearZ) / (nearZ - farZ);
+        projectionMatrix[11] = -1.0f;
+        projectionMatrix[14] = (2.0f * farZ * nearZ) / (nearZ - farZ);
+        projectionMatrix[15] = 0.0f;
+    }
+
+    // Same matrix as gluLookAt(eye, center, up).
+    void lookAt(float eyeX, float eyeY, float eyeZ, float centerX, float centerY, float centerZ,
+                float upX, float upY, float upZ) {
+        eye[0] = eyeX;
+        eye[1] = eyeY;
+        eye[2] = eyeZ;
+
+        float forward[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
+        normalize(forward);
+        float upHint[3] = {upX, upY, upZ};
+        cross(forward, upHint, right);
+        normalize(right);
+        cross(right, forward, up);
+        back[0] = -forward[0];
+        back[1] = -forward[1];
+        back[2] = -forward[2];
+
+        identity(viewMatrix);
+        viewMatrix[0] = right[0];
+        viewMatrix[4] = right[1];
+        viewMatrix[8] = right[2];
+        viewMatrix[1] = up[0];
+        viewMatrix[5] = up[1];
+        viewMatrix[9] = up[2];
+        viewMatrix[2] = back[0];
+        viewMatrix[6] = back[1];
+        viewMatrix[10] = back[2];
+        viewMatrix[12] = -(right[0] * eyeX + right[1] * eyeY + right[2] * eyeZ);
+        viewMatrix[13] = -(up[0] * eyeX + up[1] * eyeY + up[2] * eyeZ);
+        viewMatrix[14] = -(back[0] * eyeX + back[1] * eyeY + back[2] * eyeZ);
+    }
+
+    const float* view() const { return viewMatrix; }
+    const float* projection() const { return projectionMatrix; }
+    const float* position() const { return eye; }
+    // World-space camera basis; back points away from the view direction.
+    const float* rightAxis() const { return right; }
+    const float* upAxis() const { return up; }
+    const float* backAxis() const { return back; }
+    float nearPlane() const { return zNear; }
+    int viewportWidth() const { return viewport[2]; }
+    int viewportHeight() const { return viewport[3]; }
+    float fieldOfViewY() const { return fovY; }
+
+    // Window position (origin bottom-left) and view depth of a world point,
+    // like gluProject. False when the point is behind the near plane.
+    bool project(const float* p, float* window, float* depth) const {
+        const float* v = viewMatrix;
+        float e[3];
+        for (int r = 0; r < 3; r++) e[r] = v[r] * p[0] + v[4 + r] * p[1] + v[8 + r] * p[2] + v[12 + r];
+        if (-e[2] < zNear) return false;
+        const float* m = projectionMatrix;
+        float cx = m[0] * e[0] + m[4] * e[1] + m[8] * e[2] + m[12];
+        float cy = m[1] * e[0] + m[5] * e[1] + m[9] * e[2] + m[13];
+        float cw = m[3] * e[0] + m[7] * e[1] + m[11] * e[2] + m[15];
+        window[0] = viewport[0] + (cx / cw + 1.0f) * 0.5f * viewport[2];
+        window[1] = viewport[1] + (cy / cw + 1.0f) * 0.5f * viewport[3];
+        *depth = -e[2];
+        return true;
+    }
+
+    void loadProjection() const {
+        glMatrixMode(GL_PROJECTION);
+        glLoadMatrixf(projectionMatrix);
+        glMatrixMode(GL_MODELVIEW);
+    }
+
+    void loadView() const {
+        glLoadMatrixf(viewMatrix);
+    }
+
+    // Ray through a window pixel (GLUT mouse coordinates, origin top-left).
+    // The origin lies on the near plane, like unprojecting at depth 0.
+    void pickRay(int mouseX, int mouseY, float* origin, float* dir) const {
+        float ndcX = 2.0f * (mouseX - viewport[0]) / viewport[2] - 1.0f;
+        float ndcY = 1.0f - 2.0f * (mouseY - viewport[1]) / viewport[3];
+        float tanHalf = std::tan(fovY * 0.5f * 3.14159265358979323846f / 180.0f);
+        float vx = ndcX * tanHalf * aspect;
+        float vy = ndcY * tanHalf;
+
+        // View-space direction (vx, vy, -1) rotated into world space.
+        for (int i = 0; i < 3; i++) {
+            dir[i] = right[i] * vx + up[i] * vy - back[i];
+            origin[i] = eye[i] + dir[i] * zNear;
+        }
+        normalize(dir);
+    }
+};
+
+#endif
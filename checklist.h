@@ -4,38 +4,49 @@
 #include <GL/glut.h>
 #include <vector>
 #include <string>
+#include "glcount.h"
 #include "parameter.h" 
+#include "profiler.h"
+#include "text.h"
 
 struct ChecklistItem {
     std::string text;
     int triggerIndex; // The objIndex that corresponds to this task
+    text::Label done;    // "[x] text"
+    text::Label pending; // "[ ] text"
 };
 
 class ChecklistSystem {
 private:
     std::vector<ChecklistItem> items;
-
-    void renderBitmapString(float x, float y, void *font, const char *string) {
-        const char *c;
-        glRasterPos2f(x, y);
-        for (c = string; *c != '\0'; c++) {
-            glutBitmapCharacter(font, *c);
-        }
+    text::Label title{"ASSEMBLY CHECKLIST", text::Font::Helvetica18};
+    text::Label arrow{">", text::Font::Helvetica12};
+    // The whole panel, rebuilt only when objIndex or the window height change.
+    text::Layer layer;
+    int cachedObjIndex = -1;
+    int cachedHeight = -1;
+
+    void addItem(const std::string &task, int triggerIndex) {
+        items.push_back({task, triggerIndex,
+                         text::Label("[x] " + task, text::Font::Helvetica18),
+                         text::Label("[ ] " + task, text::Font::Helvetica18)});
     }
 
 public:
     ChecklistSystem() {
-        items.push_back({"Remove Side Panel", REMOVE_SIDE_PANEL}); // 0
-        items.push_back({"Disconnect RAM Sticks", REMOVE_RAM_STICK});     // 2
-        items.push_back({"Unlock CPU Fan", REMOVE_FAN});           // 4
-        items.push_back({"Remove Processor", REMOVE_PROCESSOR});   // 6
-        items.push_back({"Unplug Power Supply", REMOVE_PSU});      // 8
-        items.push_back({"Remove Hard Disk", REMOVE_HDD});         // 10
-        items.push_back({"Detach GPU", REMOVE_GPU});               // 12
-        items.push_back({"Remove Motherboard", REMOVE_MOTHERBOARD});// 14
+        addItem("Remove Side Panel", REMOVE_SIDE_PANEL); // 0
+        addItem("Disconnect RAM Sticks", REMOVE_RAM_STICK);     // 2
+        addItem("Unlock CPU Fan", REMOVE_FAN);           // 4
+        addItem("Remove Processor", REMOVE_PROCESSOR);   // 6
+        addItem("Unplug Power Supply", REMOVE_PSU);      // 8
+        addItem("Remove Hard Disk", REMOVE_HDD);         // 10
+        addItem("Detach GPU", REMOVE_GPU);               // 12
+        addItem("Remove Motherboard", REMOVE_MOTHERBOARD);// 14
     }
 
-    void draw(int currentObjIndex, int windowWidth, int windowHeight) {
+    // Rebuild the cached panel; only called when its inputs change.
+    void rebuild(int currentObjIndex, int windowHeight) {
+        PROFILE_ZONE("ChecklistSystem::rebuild");
         // Find the index of the first incomplete task to highlight it
         int nextTaskIndex = -1;
         for (size_t i = 0; i < items.size(); ++i) {
@@ -46,39 +57,21 @@ public:
         }
         // If everything is done (or logic fails), nothing is "next", but that's fine.
 
-        glDisable(GL_LIGHTING);
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_DEPTH_TEST); // Ensure text draws on top
-
-        glMatrixMode(GL_PROJECTION);
-        glPushMatrix();
-        glLoadIdentity();
-        gluOrtho2D(0, windowWidth, 0, windowHeight);
-        glMatrixMode(GL_MODELVIEW);
-        glPushMatrix();
-        glLoadIdentity();
+        layer.clear();
 
         float startX = 30.0f;
-        float startY = windowHeight - 120.0f; // Moved down to clear FPS overlay
+        float startY = windowHeight - 150.0f; // Moved down to clear FPS overlay
         float lineHeight = 30.0f;
+        float bottom = startY - (items.size() * lineHeight) - 10;
 
         // Title Box Background
-        glColor4f(0.1f, 0.1f, 0.1f, 0.8f);
-        glRectf(startX - 10, startY + 25, startX + 300, startY - (items.size() * lineHeight) - 10);
-        
+        layer.rect(startX - 10, bottom, startX + 300, startY + 25, {0.1f, 0.1f, 0.1f, 0.8f});
+
         // Border
-        glLineWidth(2.0f);
-        glColor3f(0.0f, 0.8f, 1.0f); // Cyan
-        glBegin(GL_LINE_LOOP);
-            glVertex2f(startX - 10, startY + 25);
-            glVertex2f(startX + 300, startY + 25);
-            glVertex2f(startX + 300, startY - (items.size() * lineHeight) - 10);
-            glVertex2f(startX - 10, startY - (items.size() * lineHeight) - 10);
-        glEnd();
+        layer.outline(startX - 10, bottom, startX + 300, startY + 25, 2.0f, {0.0f, 0.8f, 1.0f, 1.0f}); // Cyan
 
         // Title
-        glColor3f(1.0f, 0.84f, 0.0f); // Gold
-        renderBitmapString(startX, startY, GLUT_BITMAP_HELVETICA_18, "ASSEMBLY CHECKLIST");
+        layer.label(title, startX, startY, {1.0f, 0.84f, 0.0f, 1.0f}); // Gold
 
         float currentY = startY - 35.0f;
 
@@ -86,29 +79,30 @@ public:
             bool isCompleted = currentObjIndex >= items[i].triggerIndex;
             bool isNext = (i == nextTaskIndex);
 
-            std::string prefix;
             if (isCompleted) {
-                glColor3f(0.2f, 1.0f, 0.2f); // Bright Green
-                prefix = "[x] ";
+                layer.label(items[i].done, startX, currentY, {0.2f, 1.0f, 0.2f, 1.0f}); // Bright Green
             } else if (isNext) {
-                glColor3f(1.0f, 1.0f, 1.0f); // White/Highlight
-                prefix = "[ ] ";
+                text::Color white = {1.0f, 1.0f, 1.0f, 1.0f}; // White/Highlight
                 // Draw a small arrow or indicator for the current task
-                renderBitmapString(startX - 15, currentY, GLUT_BITMAP_HELVETICA_12, ">");
+                layer.label(arrow, startX - 15, currentY, white);
+                layer.label(items[i].pending, startX, currentY, white);
             } else {
-                glColor3f(0.5f, 0.5f, 0.5f); // Grey
-                prefix = "[ ] ";
+                layer.label(items[i].pending, startX, currentY, {0.5f, 0.5f, 0.5f, 1.0f}); // Grey
             }
 
-            renderBitmapString(startX, currentY, GLUT_BITMAP_HELVETICA_18, (prefix + items[i].text).c_str());
             currentY -= lineHeight;
         }
 
-        glPopMatrix();
-        glMatrixMode(GL_PROJECTION);
-        glPopMatrix();
-        glMatrixMode(GL_MODELVIEW);
-        
+        cachedObjIndex = currentObjIndex;
+        cachedHeight = windowHeight;
+    }
+
+    void draw(int currentObjIndex, int windowHeight) {
+        PROFILE_ZONE("ChecklistSystem::draw");
+        if (layer.empty() || currentObjIndex != cachedObjIndex || windowHeight != cachedHeight)
+            rebuild(currentObjIndex, windowHeight);
+        layer.draw();
+
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_LIGHTING); // Restore lighting
     }
@@ -2,6 +2,7 @@
 #define CPU_CABLE
 
 #include <GL/glut.h>
+#include "profiler.h"
 
 class cable {
 		bool visible = true;
@@ -40,6 +41,7 @@ void cable::draw_cpu_power() {
 }
 
 void cable::render() {
+	PROFILE_ZONE("cable::render");
 	if (enterPressed && objIndex == REMOVE_HDD)
 		visible = assemble ? true : false;
 	if (!visible) return;
@@ -3,6 +3,7 @@
 
 #include <GL/glut.h>
 #include "cpu_fan.h"
+#include "profiler.h"
 
 class cpu_case {
 		/// Parameters
@@ -31,6 +32,7 @@ public:	void render();
 };
 
 void cpu_case::render() {
+	PROFILE_ZONE("cpu_case::render");
 	
 	glPushMatrix();
 
@@ -51,6 +53,7 @@ void cpu_case::render() {
 }
 
 void cpu_case::motionHandle() {
+	PROFILE_ZONE("cpu_case::motionHandle");
 	// SIDE PANEL REMOVAL
 	if (((enterPressed && objIndex == REMOVE_SIDE_PANEL) || objMove == true) && !assemble)
 	{
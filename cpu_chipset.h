@@ -2,6 +2,7 @@
 #define CPU_CHIPSET
 
 #include "parameter.h"
+#include "profiler.h"
 
 class cpu_chipset {
 	point3D move;
@@ -13,6 +14,7 @@ public:void render();
 };
 
 void cpu_chipset::motionHandle() {
+	PROFILE_ZONE("cpu_chipset::motionHandle");
 	if (((enterPressed && objIndex == REMOVE_PROCESSOR) || objMove == true) && !assemble)
 	{
 		objMove = true;
@@ -39,6 +41,7 @@ void cpu_chipset::motionHandle() {
 }
 
 void cpu_chipset::render() {
+	PROFILE_ZONE("cpu_chipset::render");
 	
 	motionHandle();
 	if (!visible) return;
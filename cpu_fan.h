@@ -1,6 +1,7 @@
 #ifndef CPU_FAN
 #define CPU_FAN
 #include "parameter.h"
+#include "profiler.h"
 #include "dragHandler.h"
 
 class  cpu_fan {
@@ -80,6 +81,7 @@ void cpu_fan::showDescrpiton() {
 }
 
 void cpu_fan::motionHandle() {
+	PROFILE_ZONE("cpu_fan::motionHandle");
 
 	if (((enterPressed && objIndex == REMOVE_FAN) || objMove == true) && !assemble)
 	{
@@ -106,6 +108,7 @@ void cpu_fan::motionHandle() {
 }
 
 void cpu_fan::render() {
+	PROFILE_ZONE("cpu_fan::render");
 	motionHandle();
 	if (!visible) return;
 	glPushMatrix();
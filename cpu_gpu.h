@@ -2,6 +2,7 @@
 #define CPU_GPU
 
 #include "parameter.h"
+#include "profiler.h"
 
 class cpu_gpu {
 		point3D move;
@@ -14,6 +15,7 @@ public: void render();
 };
 
 void cpu_gpu::motionHandle() {
+	PROFILE_ZONE("cpu_gpu::motionHandle");
 	if (((enterPressed && objIndex == REMOVE_GPU) || objMove == true) && !assemble)
 	{
 		objMove = true;
@@ -40,6 +42,7 @@ void cpu_gpu::motionHandle() {
 }
 
 void cpu_gpu::render() {
+	PROFILE_ZONE("cpu_gpu::render");
 
 	motionHandle();
 	if (!visible) return;
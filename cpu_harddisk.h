@@ -2,6 +2,7 @@
 #define HARDDISK
 
 #include "parameter.h"
+#include "profiler.h"
 
 class cpu_harddisk {
 	point3D move;
@@ -14,6 +15,7 @@ public:void render();
 };
 
 void cpu_harddisk::motionHandle() {
+	PROFILE_ZONE("cpu_harddisk::motionHandle");
 
 	if (((enterPressed && objIndex == REMOVE_HDD) || objMove == true) && !assemble)
 	{
@@ -48,6 +50,7 @@ void cpu_harddisk::motionHandle() {
 }
 
 void cpu_harddisk::render() {
+	PROFILE_ZONE("cpu_harddisk::render");
 	GLfloat scaleFactor = 0.4;
 	
 	motionHandle();
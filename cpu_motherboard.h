@@ -4,6 +4,7 @@
 #include <GL/glut.h>
 #include "dragHandler.h"
 #include "parameter.h"
+#include "profiler.h"
 
 class cpu_motherboard {
 private:GLfloat boardThickness = 0.025;
@@ -18,6 +19,7 @@ public:void render();
 };
 
 void cpu_motherboard::motionHandle() {
+	PROFILE_ZONE("cpu_motherboard::motionHandle");
 	if (((enterPressed && objIndex == REMOVE_MOTHERBOARD) || objMove == true) && !assemble)
 	{
 		objMove = true;
@@ -43,6 +45,7 @@ void cpu_motherboard::motionHandle() {
 }
 
 void cpu_motherboard::render() {
+	PROFILE_ZONE("cpu_motherboard::render");
 
 	motionHandle();
 	if (!visible) return;
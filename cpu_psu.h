@@ -2,6 +2,7 @@
 #define CPU_PSU
 
 #include "parameter.h"
+#include "profiler.h"
 #include "bitmap.h"
 
 class cpu_psu {
@@ -14,6 +15,7 @@ public:void render();
 };
 
 void cpu_psu::motionHandle() {
+	PROFILE_ZONE("cpu_psu::motionHandle");
 
 	if (((enterPressed && objIndex == REMOVE_PSU) || objMove == true) && !assemble)
 	{
@@ -40,6 +42,7 @@ void cpu_psu::motionHandle() {
 }
 
 void cpu_psu::render() {
+	PROFILE_ZONE("cpu_psu::render");
 	
 	motionHandle();
 
@@ -2,6 +2,7 @@
 #define CPU_RAM
 
 #include "parameter.h"
+#include "profiler.h"
 
 class cpu_ramstick {
 	point3D move;
@@ -13,6 +14,7 @@ public:void render(GLfloat, GLfloat, GLfloat);
 };
 
 void cpu_ramstick::motionHandle() {
+	PROFILE_ZONE("cpu_ramstick::motionHandle");
 	// RAM REMOVAL
 	if (((enterPressed && objIndex == REMOVE_RAM_STICK) || objMove == true) && !assemble)
 	{
@@ -43,6 +45,7 @@ void cpu_ramstick::motionHandle() {
 }
 
 void cpu_ramstick::render(GLfloat tx, GLfloat ty, GLfloat tz) {
+	PROFILE_ZONE("cpu_ramstick::render");
 	
 	motionHandle();
 	if (!visible) return;
@@ -0,0 +1,195 @@
+#ifndef DECORATION_BATCH_H
+#define DECORATION_BATCH_H
+
+#include <GL/glut.h>
+#include <cmath>
+#include <vector>
+
+#include "camera.h"
+#include "glcount.h"
+
+// Collects a frame's worth of untextured world-space decoration (lines,
+// points, quads) into two client-side vertex arrays and draws each with one
+// glDrawArrays: an additive glow pass, then a regular alpha-blended pass.
+//
+// Lines and points are expanded on the CPU into camera-facing quads whose
+// width is given in pixels, so nothing depends on glLineWidth / glPointSize
+// (wide lines are slow or unsupported on many rasterizers). The calls mirror
+// immediate mode: set the pass and color, then emit primitives.
+class DecorationBatch {
+public:
+  enum Pass { Glow = 0, Alpha = 1 };
+
+  DecorationBatch() {
+    for (auto &v : vertices_) v.reserve(4096);
+  }
+
+  // Record the camera used to turn pixel widths into world units.
+  void begin(const Camera &camera) {
+    const float *e = camera.position();
+    const float *r = camera.rightAxis();
+    const float *u = camera.upAxis();
+    const float *b = camera.backAxis();
+    for (int i = 0; i < 3; i++) {
+      eye_[i] = e[i];
+      right_[i] = r[i];
+      up_[i] = u[i];
+      forward_[i] = -b[i];
+    }
+    nearZ_ = camera.nearPlane();
+    // World size of one pixel at unit depth.
+    pixelScale_ = 2.0f *
+                  std::tan(camera.fieldOfViewY() * 0.5f * 3.14159265f / 180.0f) /
+                  camera.viewportHeight();
+    for (auto &v : vertices_) v.clear();
+  }
+
+  // Room for this many quads in pass p, so a frame that queues no more
+  // never reallocates.
+  void reserve(Pass p, size_t quads) { vertices_[p].reserve(quads * 4); }
+
+  void pass(Pass p) { pass_ = p; }
+
+  void color(float r, float g, float b, float a) {
+    const float in[4] = {r, g, b, a};
+    for (int i = 0; i < 4; i++) {
+      float c = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+      rgba_[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+    }
+  }
+
+  // Segment a-b, widthPx pixels wide at every depth, with square caps.
+  void line(const float *a, const float *b, float widthPx) {
+    float d[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float toMid[3] = {(a[0] + b[0]) * 0.5f - eye_[0],
+                      (a[1] + b[1]) * 0.5f - eye_[1],
+                      (a[2] + b[2]) * 0.5f - eye_[2]};
+    float side[3];
+    cross(d, toMid, side);
+    if (!normalize(side)) {
+      // Seen end-on: any screen direction will do.
+      for (int i = 0; i < 3; i++) side[i] = right_[i];
+    }
+    normalize(d);
+
+    float ha = 0.5f * widthPx * pixelSize(a);
+    float hb = 0.5f * widthPx * pixelSize(b);
+    float p[4][3];
+    for (int i = 0; i < 3; i++) {
+      p[0][i] = a[i] - d[i] * ha + side[i] * ha;
+      p[1][i] = a[i] - d[i] * ha - side[i] * ha;
+      p[2][i] = b[i] + d[i] * hb - side[i] * hb;
+      p[3][i] = b[i] + d[i] * hb + side[i] * hb;
+    }
+    emitQuad(p);
+  }
+
+  void line(float x0, float y0, float z0, float x1, float y1, float z1,
+            float widthPx) {
+    const float a[3] = {x0, y0, z0};
+    const float b[3] = {x1, y1, z1};
+    line(a, b, widthPx);
+  }
+
+  // Screen-aligned square sizePx pixels across, like a GL_POINTS vertex.
+  void point(float x, float y, float z, float sizePx) {
+    const float c[3] = {x, y, z};
+    float h = 0.5f * sizePx * pixelSize(c);
+    float p[4][3];
+    for (int i = 0; i < 3; i++) {
+      p[0][i] = c[i] - right_[i] * h - up_[i] * h;
+      p[1][i] = c[i] + right_[i] * h - up_[i] * h;
+      p[2][i] = c[i] + right_[i] * h + up_[i] * h;
+      p[3][i] = c[i] - right_[i] * h + up_[i] * h;
+    }
+    emitQuad(p);
+  }
+
+  // Filled quad, corners in drawing order.
+  void quad(const float (*corners)[3]) { emitQuad(corners); }
+
+  // Draw both passes and reset. Depth testing is off for the glow pass;
+  // the alpha pass draws over the scene but writes depth, so things drawn
+  // later with a depth test (tooltip labels) are hidden by nearer panels.
+  void flush() {
+    if (vertices_[Glow].empty() && vertices_[Alpha].empty()) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    drawArray(vertices_[Glow]);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    drawArray(vertices_[Alpha]);
+
+    glPopClientAttrib();
+    glPopAttrib();
+    for (auto &v : vertices_) v.clear();
+  }
+
+private:
+  struct Vertex {
+    float x, y, z;
+    unsigned char rgba[4];
+  };
+
+  static void cross(const float *a, const float *b, float *out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+  }
+
+  static bool normalize(float *v) {
+    float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (len <= 1e-12f) return false;
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+    return true;
+  }
+
+  // World size of one pixel at p's view depth.
+  float pixelSize(const float *p) const {
+    float depth = (p[0] - eye_[0]) * forward_[0] +
+                  (p[1] - eye_[1]) * forward_[1] +
+                  (p[2] - eye_[2]) * forward_[2];
+    return (depth > nearZ_ ? depth : nearZ_) * pixelScale_;
+  }
+
+  void emitQuad(const float (*p)[3]) {
+    std::vector<Vertex> &out = vertices_[pass_];
+    for (int k = 0; k < 4; k++) {
+      Vertex v = {p[k][0], p[k][1], p[k][2], {rgba_[0], rgba_[1], rgba_[2], rgba_[3]}};
+      out.push_back(v);
+    }
+  }
+
+  static void drawArray(const std::vector<Vertex> &v) {
+    if (v.empty()) return;
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &v[0].x);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), v[0].rgba);
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(v.size()));
+  }
+
+  std::vector<Vertex> vertices_[2];
+  Pass pass_ = Alpha;
+  unsigned char rgba_[4] = {255, 255, 255, 255};
+  float eye_[3] = {0.0f, 0.0f, 0.0f};
+  float right_[3] = {1.0f, 0.0f, 0.0f};
+  float up_[3] = {0.0f, 1.0f, 0.0f};
+  float forward_[3] = {0.0f, 0.0f, -1.0f};
+  float nearZ_ = 0.7f;
+  float pixelScale_ = 0.001f;
+};
+
+#endif
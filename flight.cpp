@@ -0,0 +1,282 @@
+#include "flight.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace flight {
+
+std::uint32_t g_glCalls = 0;
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+thread_local std::uint64_t t_allocations = 0;
+
+struct FrameSummary {
+    std::uint32_t frame;
+    std::uint32_t profilerFrame;
+    std::uint64_t startNs;
+    std::uint64_t endNs;
+    std::uint32_t glCalls;
+    std::uint32_t allocations;
+};
+
+struct InputRecord {
+    std::uint64_t ns;
+    Input kind;
+    int code;
+    int x;
+    int y;
+};
+
+// ~17 s of frames at 60 fps; inputs include passive mouse motion, so keep more.
+const int kFrameHistory = 1024;
+const int kInputHistory = 4096;
+const std::uint64_t kDumpCooldownNs = 5000000000ull;
+
+FrameSummary g_frames[kFrameHistory];
+std::uint64_t g_frameCount = 0;
+InputRecord g_inputs[kInputHistory];
+std::uint64_t g_inputCount = 0;
+
+FrameSummary g_current = {};
+bool g_started = false;
+std::uint64_t g_allocAtStart = 0;
+
+std::uint64_t g_thresholdNs = 100000000ull;
+std::uint64_t g_windowNs = 3000000000ull;
+std::uint64_t g_lastDumpNs = 0;
+std::atomic<bool> g_dumping{false};
+
+// One writer thread, started by the first hitch and joined by shutdown().
+// g_dumping limits it to one pending dump.
+struct Dump {
+    std::vector<FrameSummary> frames;
+    std::vector<InputRecord> inputs;
+    FrameSummary hitch;
+};
+std::mutex g_writerMutex;
+std::condition_variable g_writerWake;
+std::thread g_writer;
+Dump g_pending;
+bool g_hasPending = false;
+bool g_stopping = false;
+
+const char* input_name(Input kind) {
+    switch (kind) {
+    case Input::Key: return "key";
+    case Input::SpecialKey: return "special_key";
+    case Input::Mouse: return "mouse";
+    default: return "input";
+    }
+}
+
+void write_dump(const std::vector<FrameSummary>& frames, const std::vector<InputRecord>& inputs,
+                const FrameSummary& hitch) {
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+    char path[96];
+    std::snprintf(path, sizeof(path), "hitch_%s_f%u.json", stamp, hitch.frame);
+
+    std::FILE* f = std::fopen(path, "w");
+    if (!f) {
+        std::fprintf(stderr, "[flight] Cannot write %s\n", path);
+        return;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    std::fputs("{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"frames\"}}", f);
+    for (const FrameSummary& s : frames) {
+        std::fprintf(f, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"frame %u\","
+                        "\"args\":{\"gl_calls\":%u,\"allocations\":%u}}",
+                     s.startNs / 1000.0, (s.endNs - s.startNs) / 1000.0, s.frame, s.glCalls, s.allocations);
+        std::fprintf(f, ",\n{\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"name\":\"per frame\","
+                        "\"args\":{\"gl_calls\":%u,\"allocations\":%u}}",
+                     s.startNs / 1000.0, s.glCalls, s.allocations);
+    }
+    for (const InputRecord& in : inputs) {
+        std::fprintf(f, ",\n{\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"name\":\"%s\","
+                        "\"args\":{\"code\":%d,\"x\":%d,\"y\":%d}}",
+                     in.ns / 1000.0, input_name(in.kind), in.code, in.x, in.y);
+    }
+    bool needComma = true;
+    if (!frames.empty())
+        profiler::write_trace_events(f, frames.front().profilerFrame, frames.back().profilerFrame, needComma);
+    std::fputs("\n]}\n", f);
+    std::fclose(f);
+
+    std::fprintf(stderr, "[flight] Frame %u took %.1f ms; wrote %zu frames to %s\n",
+                 hitch.frame, (hitch.endNs - hitch.startNs) / 1.0e6, frames.size(), path);
+}
+
+void writer_main() {
+    profiler::set_thread_name("flight");
+    std::unique_lock<std::mutex> lock(g_writerMutex);
+    while (true) {
+        g_writerWake.wait(lock, [] { return g_hasPending || g_stopping; });
+        if (!g_hasPending) break;
+        Dump job = std::move(g_pending);
+        g_hasPending = false;
+        lock.unlock();
+        write_dump(job.frames, job.inputs, job.hitch);
+        g_dumping.store(false);
+        lock.lock();
+    }
+}
+
+// Copy the window out of the rings and hand it to the writer thread so the
+// render thread only pays for the snapshot.
+void dump(const FrameSummary& hitch) {
+    if (g_dumping.exchange(true)) return;
+
+    std::uint64_t since = hitch.endNs > g_windowNs ? hitch.endNs - g_windowNs : 0;
+    std::vector<FrameSummary> frames;
+    std::uint64_t first = g_frameCount > kFrameHistory ? g_frameCount - kFrameHistory : 0;
+    for (std::uint64_t i = first; i < g_frameCount; ++i) {
+        const FrameSummary& s = g_frames[i % kFrameHistory];
+        if (s.endNs >= since) frames.push_back(s);
+    }
+    std::vector<InputRecord> inputs;
+    first = g_inputCount > kInputHistory ? g_inputCount - kInputHistory : 0;
+    for (std::uint64_t i = first; i < g_inputCount; ++i) {
+        const InputRecord& in = g_inputs[i % kInputHistory];
+        if (in.ns >= since) inputs.push_back(in);
+    }
+
+    std::lock_guard<std::mutex> lock(g_writerMutex);
+    if (g_stopping) {
+        g_dumping.store(false);
+        return;
+    }
+    g_pending.frames = std::move(frames);
+    g_pending.inputs = std::move(inputs);
+    g_pending.hitch = hitch;
+    g_hasPending = true;
+    if (!g_writer.joinable()) {
+        g_writer = std::thread(writer_main);
+        std::atexit(shutdown);
+    }
+    g_writerWake.notify_one();
+}
+
+} // namespace
+
+void frame_mark() {
+    std::uint64_t now = profiler::now_ns();
+    std::uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+
+    if (g_started) {
+        g_current.endNs = now;
+        g_current.glCalls = g_glCalls;
+        g_current.allocations = static_cast<std::uint32_t>(allocations - g_allocAtStart);
+        g_frames[g_frameCount++ % kFrameHistory] = g_current;
+
+        bool cooledDown = g_lastDumpNs == 0 || now - g_lastDumpNs > kDumpCooldownNs;
+        if (now - g_current.startNs > g_thresholdNs && cooledDown) {
+            g_lastDumpNs = now;
+            dump(g_current);
+        }
+    }
+
+    g_started = true;
+    g_current.frame = static_cast<std::uint32_t>(g_frameCount + 1);
+    g_current.profilerFrame = profiler::current_frame();
+    g_current.startNs = now;
+    g_glCalls = 0;
+    // Re-read so the dump snapshot above is not charged to the new frame.
+    g_allocAtStart = g_allocations.load(std::memory_order_relaxed);
+}
+
+void set_threshold_ms(double ms) {
+    if (ms > 0.0) g_thresholdNs = static_cast<std::uint64_t>(ms * 1.0e6);
+}
+
+void set_window_seconds(double seconds) {
+    if (seconds > 0.0) g_windowNs = static_cast<std::uint64_t>(seconds * 1.0e9);
+}
+
+void shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(g_writerMutex);
+        g_stopping = true;
+    }
+    g_writerWake.notify_one();
+    if (g_writer.joinable()) g_writer.join();
+}
+
+void input_event(Input kind, int code, int x, int y) {
+    g_inputs[g_inputCount++ % kInputHistory] = {profiler::now_ns(), kind, code, x, y};
+}
+
+std::uint64_t allocation_count() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+std::uint64_t thread_allocation_count() {
+    return t_allocations;
+}
+
+} // namespace flight
+
+// Count every heap allocation in the program. The replacements forward to
+// malloc/free like the default implementations.
+void* operator new(std::size_t size) {
+    flight::g_allocations.fetch_add(1, std::memory_order_relaxed);
+    ++flight::t_allocations;
+    if (size == 0) size = 1;
+    while (true) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+// Always-on hitch flight recorder.
+//
+// Keeps a short history of per-frame summaries (frame time, GL call and heap
+// allocation counts) plus recent input events. When a frame takes longer than
+// the threshold, the last few seconds are dumped on a writer thread to
+// hitch_<date>_<time>_f<frame>.json (Chrome trace format), together with the
+// profiler zones for those frames when built with ENABLE_PROFILER.
+//
+// The steady-state cost is a counter increment per GL call / allocation and
+// one small struct copy per frame.
+
+namespace flight {
+
+enum class Input : std::uint8_t {
+    Key,
+    SpecialKey,
+    Mouse,
+};
+
+// Called at the start of every frame; closes the previous frame and checks it
+// against the threshold.
+void frame_mark();
+
+// Frames slower than this trigger a dump (default 100 ms).
+void set_threshold_ms(double ms);
+// Seconds of history written per dump (default 3 s, capped by the ring).
+void set_window_seconds(double seconds);
+
+void input_event(Input kind, int code, int x = 0, int y = 0);
+
+// Finish the dump being written, if any, and stop the writer thread. Runs at
+// exit once a dump has been made; later hitches are not dumped.
+void shutdown();
+
+// Render-thread GL call counter, bumped by the macros in glcount.h.
+extern std::uint32_t g_glCalls;
+inline void count_gl_call() { ++g_glCalls; }
+
+// Heap allocations since startup (global operator new is counted).
+std::uint64_t allocation_count();
+// Heap allocations made by the calling thread.
+std::uint64_t thread_allocation_count();
+
+} // namespace flight
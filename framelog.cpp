@@ -0,0 +1,111 @@
+#include "framelog.h"
+#include "profiler.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace framelog {
+
+namespace {
+
+// ~68 s of headroom at 60 fps before records are dropped.
+SpscRing<FrameRecord, 4096> g_ring;
+std::atomic<std::uint64_t> g_dropped{0};
+std::atomic<bool> g_running{false};
+std::thread g_writer;
+
+Config g_config;
+std::FILE* g_file = nullptr;
+std::size_t g_fileBytes = 0;
+
+std::string file_name(int index) {
+    std::string name = g_config.basePath;
+    if (index > 0) name += "." + std::to_string(index);
+    return name + ".bin";
+}
+
+bool open_file() {
+    g_file = std::fopen(file_name(0).c_str(), "wb");
+    if (!g_file) {
+        std::fprintf(stderr, "[framelog] Cannot open %s\n", file_name(0).c_str());
+        return false;
+    }
+    FileHeader header{kMagic, kVersion, static_cast<std::uint32_t>(sizeof(FrameRecord)), 0};
+    std::fwrite(&header, sizeof(header), 1, g_file);
+    g_fileBytes = sizeof(header);
+    return true;
+}
+
+// <base>.bin -> <base>.1.bin -> ... ; the oldest file falls off the end.
+void shift_files() {
+    std::remove(file_name(g_config.maxFiles - 1).c_str());
+    for (int i = g_config.maxFiles - 2; i >= 0; --i)
+        std::rename(file_name(i).c_str(), file_name(i + 1).c_str());
+}
+
+void rotate() {
+    std::fclose(g_file);
+    g_file = nullptr;
+    shift_files();
+    open_file();
+}
+
+void drain() {
+    FrameRecord record;
+    while (g_ring.pop(record)) {
+        if (!g_file) continue;
+        std::fwrite(&record, sizeof(record), 1, g_file);
+        g_fileBytes += sizeof(record);
+        if (g_fileBytes >= g_config.maxFileBytes) rotate();
+    }
+    if (g_file) std::fflush(g_file);
+}
+
+void writer_main() {
+    profiler::set_thread_name("framelog");
+    // Keep the previous session's log instead of truncating it.
+    shift_files();
+    open_file();
+    while (g_running.load(std::memory_order_acquire)) {
+        {
+            PROFILE_ZONE("framelog::drain");
+            drain();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    drain();
+    if (g_file) std::fclose(g_file);
+    g_file = nullptr;
+}
+
+} // namespace
+
+bool start(const Config& config) {
+    if (g_running.load()) return true;
+    g_config = config;
+    if (g_config.maxFiles < 1) g_config.maxFiles = 1;
+    if (g_config.maxFileBytes < sizeof(FileHeader) + sizeof(FrameRecord))
+        g_config.maxFileBytes = sizeof(FileHeader) + sizeof(FrameRecord);
+    g_running.store(true, std::memory_order_release);
+    g_writer = std::thread(writer_main);
+    return true;
+}
+
+void stop() {
+    if (!g_running.exchange(false)) return;
+    if (g_writer.joinable()) g_writer.join();
+}
+
+void push(const FrameRecord& record) {
+    if (!g_ring.push(record)) g_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t dropped() {
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace framelog
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Asynchronous binary per-frame log.
+//
+// The render thread only copies a FrameRecord into a lock-free ring; a
+// background thread writes records to disk, rotating files once they reach a
+// size cap. tools/framelog2csv converts the binary files to CSV on demand.
+//
+// File layout: FileHeader followed by packed FrameRecords (little-endian).
+
+namespace framelog {
+
+const std::uint32_t kMagic = 0x474F4C46; // "FLOG"
+const std::uint32_t kVersion = 1;
+const int kGpuPasses = 5; // matches stats::Pass::Count
+
+#pragma pack(push, 1)
+struct FileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+};
+
+struct FrameRecord {
+    std::uint64_t frame;
+    std::uint64_t gpuFrame;
+    double timeS;
+    float frameMs;
+    float fps;
+    float avgFps;
+    float minMs;
+    float maxMs;
+    float gpuPassMs[kGpuPasses];
+    float gpuTotalMs;
+    std::uint16_t width;
+    std::uint16_t height;
+    std::uint8_t page;
+    std::uint8_t motionPresent;
+    std::uint8_t pad[6];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FrameRecord) == 80, "FrameRecord layout is part of the file format");
+
+struct Config {
+    const char* basePath = "performance_log"; // writes <base>.bin, <base>.1.bin, ...
+    std::size_t maxFileBytes = 8u << 20;      // rotate after this many bytes
+    int maxFiles = 4;                         // current file plus rotated ones
+};
+
+// Start the writer thread. Safe to call more than once.
+bool start(const Config& config = Config());
+// Drain pending records, close the file and join the writer thread.
+void stop();
+
+// Render thread: enqueue one record. Never blocks or touches the disk; drops
+// the record if the writer has fallen behind.
+void push(const FrameRecord& record);
+
+// Records dropped because the ring was full.
+std::uint64_t dropped();
+
+} // namespace framelog
@@ -0,0 +1,15 @@
+#ifndef GLCOUNT_H
+#define GLCOUNT_H
+
+// Count the high-frequency immediate-mode calls for the flight recorder.
+// Include after the GL headers; the macros forward to the real functions.
+
+#include <GL/glut.h>
+#include "flight.h"
+
+#define glBegin(mode) (::flight::count_gl_call(), ::glBegin(mode))
+#define glDrawArrays(mode, first, count) (::flight::count_gl_call(), ::glDrawArrays(mode, first, count))
+#define glBindTexture(target, texture) (::flight::count_gl_call(), ::glBindTexture(target, texture))
+#define glutBitmapCharacter(font, character) (::flight::count_gl_call(), ::glutBitmapCharacter(font, character))
+
+#endif
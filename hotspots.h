@@ -0,0 +1,219 @@
+#ifndef HOTSPOTS_H
+#define HOTSPOTS_H
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HOTSPOTS_SSE2 1
+#endif
+
+// Hoverable hotspots stored as structure-of-arrays floats for ray picking.
+//
+// Every array is padded to a multiple of kLanes; padding slots have a negative
+// squared radius so they can never be hit. Visibility and blocking are packed
+// into bitmasks (bit i = hotspot i). pick() tests 8 hotspots per step with
+// AVX2 (or 2x4 with SSE2), falling back to scalar code elsewhere.
+class HotspotSet {
+public:
+  static const int kLanes = 8;
+
+private:
+  std::vector<float> cx, cy, cz, radiusSq;
+  std::vector<std::uint64_t> visibleBits, blockedBits;
+  int count = 0;
+
+  static void setBit(std::vector<std::uint64_t> &bits, int i, bool on) {
+    std::uint64_t bit = std::uint64_t(1) << (i & 63);
+    if (on)
+      bits[i >> 6] |= bit;
+    else
+      bits[i >> 6] &= ~bit;
+  }
+
+  // Bits of hotspots that may be picked, for the 8 slots starting at base.
+  unsigned activeByte(int base) const {
+    std::uint64_t active = visibleBits[base >> 6] & ~blockedBits[base >> 6];
+    return unsigned(active >> (base & 63)) & 0xFFu;
+  }
+
+public:
+  int size() const { return count; }
+
+  // Returns the new hotspot's index. Hotspots start visible and unblocked.
+  int add(float x, float y, float z, float detectionRadius) {
+    int index = count++;
+    int padded = (count + kLanes - 1) / kLanes * kLanes;
+    if ((int)cx.size() < padded) {
+      cx.resize(padded, 0.0f);
+      cy.resize(padded, 0.0f);
+      cz.resize(padded, 0.0f);
+      radiusSq.resize(padded, -1.0f);
+      visibleBits.resize((padded + 63) / 64, 0);
+      blockedBits.resize((padded + 63) / 64, 0);
+    }
+    cx[index] = x;
+    cy[index] = y;
+    cz[index] = z;
+    radiusSq[index] = detectionRadius * detectionRadius;
+    setBit(visibleBits, index, true);
+    return index;
+  }
+
+  void setPosition(int i, float x, float y, float z) {
+    cx[i] = x;
+    cy[i] = y;
+    cz[i] = z;
+  }
+  void setVisible(int i, bool visible) { setBit(visibleBits, i, visible); }
+  void setBlocked(int i, bool blocked) { setBit(blockedBits, i, blocked); }
+
+  bool isVisible(int i) const { return (visibleBits[i >> 6] >> (i & 63)) & 1; }
+
+  float x(int i) const { return cx[i]; }
+  float y(int i) const { return cy[i]; }
+  float z(int i) const { return cz[i]; }
+
+  // Nearest hotspot whose detection sphere the ray passes through, or -1.
+  // dir must be normalized. Spheres whose centre is behind the origin are
+  // skipped, as is any hotspot that is hidden or blocked.
+  int pick(float ox, float oy, float oz, float dx, float dy, float dz,
+           float *hitT = nullptr) const {
+    int best = -1;
+    float bestT = 1e9f;
+    int padded = (int)cx.size();
+
+#if defined(__AVX2__)
+    const __m256 vox = _mm256_set1_ps(ox), voy = _mm256_set1_ps(oy), voz = _mm256_set1_ps(oz);
+    const __m256 vdx = _mm256_set1_ps(dx), vdy = _mm256_set1_ps(dy), vdz = _mm256_set1_ps(dz);
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 vBestT = _mm256_set1_ps(bestT);
+    __m256i vBest = _mm256_set1_epi32(-1);
+
+    for (int base = 0; base < padded; base += kLanes) {
+      unsigned active = activeByte(base);
+      if (!active)
+        continue;
+      __m256 fx = _mm256_sub_ps(_mm256_loadu_ps(&cx[base]), vox);
+      __m256 fy = _mm256_sub_ps(_mm256_loadu_ps(&cy[base]), voy);
+      __m256 fz = _mm256_sub_ps(_mm256_loadu_ps(&cz[base]), voz);
+      __m256 t = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fx, vdx), _mm256_mul_ps(fy, vdy)),
+                               _mm256_mul_ps(fz, vdz));
+      __m256 ff = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fx, fx), _mm256_mul_ps(fy, fy)),
+                                _mm256_mul_ps(fz, fz));
+      // Squared distance from the centre to the ray: |f|^2 - t^2.
+      __m256 d2 = _mm256_sub_ps(ff, _mm256_mul_ps(t, t));
+
+      __m256 hit = _mm256_and_ps(_mm256_cmp_ps(d2, _mm256_loadu_ps(&radiusSq[base]), _CMP_LT_OQ),
+                                 _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ));
+      hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, vBestT, _CMP_LT_OQ));
+      __m256i activeLanes = _mm256_cmpeq_epi32(
+          _mm256_and_si256(_mm256_set1_epi32((int)active), laneBits), laneBits);
+      hit = _mm256_and_ps(hit, _mm256_castsi256_ps(activeLanes));
+
+      vBestT = _mm256_blendv_ps(vBestT, t, hit);
+      vBest = _mm256_castps_si256(_mm256_blendv_ps(
+          _mm256_castsi256_ps(vBest),
+          _mm256_castsi256_ps(_mm256_add_epi32(laneIndex, _mm256_set1_epi32(base))), hit));
+    }
+
+    alignas(32) float lanesT[8];
+    alignas(32) int lanesIdx[8];
+    _mm256_store_ps(lanesT, vBestT);
+    _mm256_store_si256((__m256i *)lanesIdx, vBest);
+    for (int l = 0; l < 8; l++) {
+      if (lanesIdx[l] < 0)
+        continue;
+      if (lanesT[l] < bestT || (lanesT[l] == bestT && lanesIdx[l] < best)) {
+        bestT = lanesT[l];
+        best = lanesIdx[l];
+      }
+    }
+#elif defined(HOTSPOTS_SSE2)
+    const __m128 vox = _mm_set1_ps(ox), voy = _mm_set1_ps(oy), voz = _mm_set1_ps(oz);
+    const __m128 vdx = _mm_set1_ps(dx), vdy = _mm_set1_ps(dy), vdz = _mm_set1_ps(dz);
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+    __m128 vBestT = _mm_set1_ps(bestT);
+    __m128i vBest = _mm_set1_epi32(-1);
+
+    for (int base = 0; base < padded; base += kLanes) {
+      unsigned active = activeByte(base);
+      if (!active)
+        continue;
+      // Two 4-wide halves per block of 8.
+      for (int half = 0; half < 2; half++) {
+        int b = base + half * 4;
+        unsigned bits = (active >> (half * 4)) & 0xFu;
+        if (!bits)
+          continue;
+        __m128 fx = _mm_sub_ps(_mm_loadu_ps(&cx[b]), vox);
+        __m128 fy = _mm_sub_ps(_mm_loadu_ps(&cy[b]), voy);
+        __m128 fz = _mm_sub_ps(_mm_loadu_ps(&cz[b]), voz);
+        __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, vdx), _mm_mul_ps(fy, vdy)), _mm_mul_ps(fz, vdz));
+        __m128 ff = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz));
+        __m128 d2 = _mm_sub_ps(ff, _mm_mul_ps(t, t));
+
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(d2, _mm_loadu_ps(&radiusSq[b])),
+                                _mm_cmpge_ps(t, _mm_setzero_ps()));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(t, vBestT));
+        __m128i activeLanes = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)bits), laneBits), laneBits);
+        hit = _mm_and_ps(hit, _mm_castsi128_ps(activeLanes));
+
+        vBestT = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, vBestT));
+        __m128i idx = _mm_add_epi32(laneIndex, _mm_set1_epi32(b));
+        __m128i hitI = _mm_castps_si128(hit);
+        vBest = _mm_or_si128(_mm_and_si128(hitI, idx), _mm_andnot_si128(hitI, vBest));
+      }
+    }
+
+    alignas(16) float lanesT[4];
+    alignas(16) int lanesIdx[4];
+    _mm_store_ps(lanesT, vBestT);
+    _mm_store_si128((__m128i *)lanesIdx, vBest);
+    for (int l = 0; l < 4; l++) {
+      if (lanesIdx[l] < 0)
+        continue;
+      if (lanesT[l] < bestT || (lanesT[l] == bestT && lanesIdx[l] < best)) {
+        bestT = lanesT[l];
+        best = lanesIdx[l];
+      }
+    }
+#else
+    best = pickScalar(ox, oy, oz, dx, dy, dz, &bestT);
+#endif
+
+    if (hitT)
+      *hitT = bestT;
+    return best;
+  }
+
+  // Reference implementation (also the fallback without SSE2).
+  int pickScalar(float ox, float oy, float oz, float dx, float dy, float dz,
+                 float *hitT = nullptr) const {
+    int best = -1;
+    float bestT = 1e9f;
+    for (int i = 0; i < count; i++) {
+      if (!((visibleBits[i >> 6] & ~blockedBits[i >> 6]) >> (i & 63) & 1))
+        continue;
+      float fx = cx[i] - ox, fy = cy[i] - oy, fz = cz[i] - oz;
+      float t = fx * dx + fy * dy + fz * dz;
+      if (t < 0.0f)
+        continue;
+      float d2 = fx * fx + fy * fy + fz * fz - t * t;
+      if (d2 < radiusSq[i] && t < bestT) {
+        bestT = t;
+        best = i;
+      }
+    }
+    if (hitT)
+      *hitT = bestT;
+    return best;
+  }
+};
+
+#endif
@@ -0,0 +1,661 @@
+#include "jpeg.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JPEG_SSE2 1
+#endif
+
+namespace jpeg {
+
+namespace {
+
+// Natural (row-major) index of each zigzag position, padded so a corrupt
+// run length cannot index past the block.
+const int kZigzag[64 + 16] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63};
+
+const int kFastBits = 9;
+
+struct Huffman {
+    bool present = false;
+    std::uint16_t fast[1 << kFastBits]; // (length << 8) | symbol; 0 when the code is longer
+    // For AC tables: a code and its magnitude bits both within the lookup,
+    // as (value << 8) | (run << 4) | total length; 0 otherwise.
+    std::int16_t fastAc[1 << kFastBits];
+    int maxcode[18];
+    int mincode[17];
+    int valptr[17];
+    std::uint8_t values[256];
+};
+
+struct Component {
+    int id = 0;
+    int h = 1, v = 1;   // sampling factors
+    int tq = 0;         // quantization table
+    int td = 0, ta = 0; // Huffman tables of the current scan
+    int pred = 0;       // DC predictor
+    int width = 0, height = 0;     // samples that hold image data
+    int blocksW = 0, blocksH = 0;  // blocks in the plane, whole MCUs
+    std::vector<std::uint8_t> plane; // blocksW * 8 samples per row
+};
+
+struct Decoder {
+    const std::uint8_t* file = nullptr;
+    std::size_t size = 0;
+    float quant[4][64]; // dequantization with the IDCT's scale factors, natural order
+    bool haveQuant[4] = {};
+    Huffman dc[4], ac[4];
+    Component comps[3];
+    int count = 0;
+    int width = 0, height = 0;
+    int hmax = 1, vmax = 1;
+    int mcusX = 0, mcusY = 0;
+    int restartInterval = 0;
+    bool haveFrame = false;
+    bool rgb = false; // Adobe transform 0: components are R, G, B
+    int scans = 0;
+};
+
+bool fail(const char* why) {
+    std::cerr << "[jpeg] " << why << "\n";
+    return false;
+}
+
+int u16_at(const std::uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+// Entropy-coded data, 64 bits at a time, with stuffed zero bytes removed.
+// At a marker it feeds zeros, so a truncated scan decodes as gray.
+struct Bits {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    std::uint64_t buffer = 0; // left-aligned
+    int count = 0;
+    bool marker = false;
+
+    void fill() {
+        while (count <= 56) {
+            unsigned byte = 0;
+            if (!marker && p < end) {
+                byte = *p;
+                if (byte != 0xFF) {
+                    p++;
+                } else if (p + 1 < end && p[1] == 0) {
+                    p += 2;
+                } else {
+                    marker = true;
+                    byte = 0;
+                }
+            }
+            buffer |= (std::uint64_t)byte << (56 - count);
+            count += 8;
+        }
+    }
+
+    unsigned peek(int n) const { return (unsigned)(buffer >> (64 - n)); }
+
+    void skip(int n) {
+        buffer <<= n;
+        count -= n;
+    }
+
+    int receive(int n) {
+        if (count < n) fill();
+        int v = (int)peek(n);
+        skip(n);
+        return v;
+    }
+
+    // Drop buffered bits and move past the RSTn marker that should be next.
+    void restart() {
+        while (p + 1 < end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7)) p++;
+        if (p + 1 < end) p += 2;
+        buffer = 0;
+        count = 0;
+        marker = false;
+    }
+};
+
+// False if the counts do not form a prefix code (more codes of a length
+// than it has room for).
+bool build_huffman(Huffman& h, const std::uint8_t* counts, const std::uint8_t* symbols, int total) {
+    std::memset(h.fast, 0, sizeof(h.fast));
+    std::memcpy(h.values, symbols, (std::size_t)total);
+    int code = 0, k = 0;
+    for (int len = 1; len <= 16; len++) {
+        h.valptr[len] = k;
+        h.mincode[len] = code;
+        for (int i = 0; i < counts[len - 1]; i++, k++, code++) {
+            if (code >= (1 << len)) return false;
+            if (len <= kFastBits) {
+                int first = code << (kFastBits - len);
+                for (int j = 0; j < (1 << (kFastBits - len)); j++)
+                    h.fast[first + j] = (std::uint16_t)((len << 8) | symbols[k]);
+            }
+        }
+        h.maxcode[len] = counts[len - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    h.maxcode[17] = INT_MAX;
+    for (int i = 0; i < (1 << kFastBits); i++) {
+        h.fastAc[i] = 0;
+        int len = h.fast[i] >> 8, run = (h.fast[i] >> 4) & 15, s = h.fast[i] & 15;
+        if (!len || !s || len + s > kFastBits) continue;
+        int bits = (i >> (kFastBits - len - s)) & ((1 << s) - 1);
+        int value = bits < (1 << (s - 1)) ? bits - (1 << s) + 1 : bits;
+        if (value >= -128 && value <= 127) h.fastAc[i] = (std::int16_t)(value * 256 + run * 16 + len + s);
+    }
+    h.present = true;
+    return true;
+}
+
+inline int decode_symbol(Bits& bits, const Huffman& h) {
+    if (bits.count < 16) bits.fill();
+    unsigned entry = h.fast[bits.peek(kFastBits)];
+    if (entry) {
+        bits.skip((int)(entry >> 8));
+        return (int)(entry & 0xFF);
+    }
+    unsigned code16 = bits.peek(16);
+    for (int len = kFastBits + 1; len <= 16; len++) {
+        int code = (int)(code16 >> (16 - len));
+        if (code <= h.maxcode[len]) {
+            bits.skip(len);
+            return h.values[h.valptr[len] + code - h.mincode[len]];
+        }
+    }
+    return -1;
+}
+
+inline int extend(int v, int s) {
+    return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+}
+
+// Huffman-decode one block into dequantized, prescaled coefficients.
+// Returns 1 when it has AC coefficients, 0 when only DC (the whole block
+// is one value), -1 when the data is corrupt.
+int decode_block(Bits& bits, Component& c, const Huffman& dc, const Huffman& ac, const float* q, float* block) {
+    int t = decode_symbol(bits, dc);
+    if (t < 0 || t > 16) return -1;
+    c.pred += t ? extend(bits.receive(t), t) : 0;
+    block[0] = (float)c.pred * q[0];
+    int acs = 0;
+    for (int k = 1; k < 64;) {
+        if (bits.count < 16) bits.fill();
+        int fast = ac.fastAc[bits.peek(kFastBits)];
+        if (fast) {
+            bits.skip(fast & 15);
+            k += (fast >> 4) & 15;
+            if (k > 63) return -1;
+            if (!acs) {
+                std::memset(block + 1, 0, 63 * sizeof(float));
+                acs = 1;
+            }
+            int z = kZigzag[k];
+            block[z] = (float)(fast >> 8) * q[z];
+            k++;
+            continue;
+        }
+        int rs = decode_symbol(bits, ac);
+        if (rs < 0) return -1;
+        int r = rs >> 4, s = rs & 15;
+        if (s == 0) {
+            if (r != 15) break; // end of block
+            k += 16;
+            continue;
+        }
+        k += r;
+        if (k > 63) return -1;
+        if (!acs) {
+            std::memset(block + 1, 0, 63 * sizeof(float));
+            acs = 1;
+        }
+        int z = kZigzag[k];
+        block[z] = (float)extend(bits.receive(s), s) * q[z];
+        k++;
+    }
+    return acs;
+}
+
+// The AAN 8-point inverse DCT (as in libjpeg's jidctflt.c) on v[0..7],
+// written once for single floats and for SSE vectors of 4 columns.
+inline float vadd(float a, float b) { return a + b; }
+inline float vsub(float a, float b) { return a - b; }
+inline float vmul(float a, float k) { return a * k; }
+#if defined(JPEG_SSE2)
+inline __m128 vadd(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 vsub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 vmul(__m128 a, float k) { return _mm_mul_ps(a, _mm_set1_ps(k)); }
+#endif
+
+template <class V>
+inline void idct8(V* v) {
+    V tmp10 = vadd(v[0], v[4]);
+    V tmp11 = vsub(v[0], v[4]);
+    V tmp13 = vadd(v[2], v[6]);
+    V tmp12 = vsub(vmul(vsub(v[2], v[6]), 1.414213562f), tmp13);
+    V tmp0 = vadd(tmp10, tmp13);
+    V tmp3 = vsub(tmp10, tmp13);
+    V tmp1 = vadd(tmp11, tmp12);
+    V tmp2 = vsub(tmp11, tmp12);
+
+    V z13 = vadd(v[5], v[3]);
+    V z10 = vsub(v[5], v[3]);
+    V z11 = vadd(v[1], v[7]);
+    V z12 = vsub(v[1], v[7]);
+    V tmp7 = vadd(z11, z13);
+    V tmp11o = vmul(vsub(z11, z13), 1.414213562f);
+    V z5 = vmul(vadd(z10, z12), 1.847759065f);
+    V tmp10o = vsub(vmul(z12, 1.082392200f), z5);
+    V tmp12o = vadd(vmul(z10, -2.613125930f), z5);
+    V tmp6 = vsub(tmp12o, tmp7);
+    V tmp5 = vsub(tmp11o, tmp6);
+    V tmp4 = vadd(tmp10o, tmp5);
+
+    v[0] = vadd(tmp0, tmp7);
+    v[7] = vsub(tmp0, tmp7);
+    v[1] = vadd(tmp1, tmp6);
+    v[6] = vsub(tmp1, tmp6);
+    v[2] = vadd(tmp2, tmp5);
+    v[5] = vsub(tmp2, tmp5);
+    v[4] = vadd(tmp3, tmp4);
+    v[3] = vsub(tmp3, tmp4);
+}
+
+#if defined(JPEG_SSE2)
+// Transpose an 8x8 float block as four 4x4 quadrants.
+void transpose8(float* b) {
+    __m128 r0 = _mm_loadu_ps(b), r1 = _mm_loadu_ps(b + 8), r2 = _mm_loadu_ps(b + 16), r3 = _mm_loadu_ps(b + 24);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    __m128 s0 = _mm_loadu_ps(b + 4), s1 = _mm_loadu_ps(b + 12), s2 = _mm_loadu_ps(b + 20), s3 = _mm_loadu_ps(b + 28);
+    __m128 t0 = _mm_loadu_ps(b + 32), t1 = _mm_loadu_ps(b + 40), t2 = _mm_loadu_ps(b + 48), t3 = _mm_loadu_ps(b + 56);
+    _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+    _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+    __m128 u0 = _mm_loadu_ps(b + 36), u1 = _mm_loadu_ps(b + 44), u2 = _mm_loadu_ps(b + 52), u3 = _mm_loadu_ps(b + 60);
+    _MM_TRANSPOSE4_PS(u0, u1, u2, u3);
+    _mm_storeu_ps(b, r0), _mm_storeu_ps(b + 8, r1), _mm_storeu_ps(b + 16, r2), _mm_storeu_ps(b + 24, r3);
+    _mm_storeu_ps(b + 4, t0), _mm_storeu_ps(b + 12, t1), _mm_storeu_ps(b + 20, t2), _mm_storeu_ps(b + 28, t3);
+    _mm_storeu_ps(b + 32, s0), _mm_storeu_ps(b + 40, s1), _mm_storeu_ps(b + 48, s2), _mm_storeu_ps(b + 56, s3);
+    _mm_storeu_ps(b + 36, u0), _mm_storeu_ps(b + 44, u1), _mm_storeu_ps(b + 52, u2), _mm_storeu_ps(b + 60, u3);
+}
+#endif
+
+// Inverse-transform a block and store it, level-shifted and clamped, as
+// 8 rows of 8 samples `stride` bytes apart.
+void idct_block(float* block, std::uint8_t* out, std::size_t stride) {
+#if defined(JPEG_SSE2)
+    for (int pass = 0; pass < 2; pass++) {
+        for (int half = 0; half < 2; half++) {
+            __m128 v[8];
+            for (int r = 0; r < 8; r++) v[r] = _mm_loadu_ps(block + r * 8 + half * 4);
+            idct8(v);
+            for (int r = 0; r < 8; r++) _mm_storeu_ps(block + r * 8 + half * 4, v[r]);
+        }
+        transpose8(block);
+    }
+    const __m128 bias = _mm_set1_ps(128.0f);
+    for (int r = 0; r < 8; r++) {
+        __m128i lo = _mm_cvtps_epi32(_mm_add_ps(_mm_loadu_ps(block + r * 8), bias));
+        __m128i hi = _mm_cvtps_epi32(_mm_add_ps(_mm_loadu_ps(block + r * 8 + 4), bias));
+        __m128i words = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + r * stride), _mm_packus_epi16(words, words));
+    }
+#else
+    for (int c = 0; c < 8; c++) {
+        float v[8];
+        for (int r = 0; r < 8; r++) v[r] = block[r * 8 + c];
+        idct8(v);
+        for (int r = 0; r < 8; r++) block[r * 8 + c] = v[r];
+    }
+    for (int r = 0; r < 8; r++) {
+        idct8(block + r * 8);
+        for (int c = 0; c < 8; c++) {
+            long s = std::lrint(block[r * 8 + c] + 128.0f);
+            out[r * stride + c] = (std::uint8_t)std::min(255L, std::max(0L, s));
+        }
+    }
+#endif
+}
+
+bool read_quant(Decoder& d, const std::uint8_t* p, int length) {
+    static const float kAan[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                  1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+    while (length > 0) {
+        int precision = p[0] >> 4, id = p[0] & 15;
+        int bytes = precision ? 129 : 65;
+        if (id > 3 || length < bytes) return fail("bad quantization table");
+        for (int k = 0; k < 64; k++) {
+            int q = precision ? u16_at(p + 1 + 2 * k) : p[1 + k];
+            int z = kZigzag[k];
+            d.quant[id][z] = (float)q * kAan[z >> 3] * kAan[z & 7] / 8.0f;
+        }
+        d.haveQuant[id] = true;
+        p += bytes;
+        length -= bytes;
+    }
+    return true;
+}
+
+bool read_huffman(Decoder& d, const std::uint8_t* p, int length) {
+    while (length > 17) {
+        int tc = p[0] >> 4, th = p[0] & 15;
+        if (tc > 1 || th > 3) return fail("bad Huffman table");
+        int total = 0;
+        for (int i = 0; i < 16; i++) total += p[1 + i];
+        if (total > 256 || length < 17 + total) return fail("bad Huffman table");
+        if (!build_huffman(tc ? d.ac[th] : d.dc[th], p + 1, p + 17, total)) return fail("bad Huffman table");
+        p += 17 + total;
+        length -= 17 + total;
+    }
+    return true;
+}
+
+bool read_frame(Decoder& d, const std::uint8_t* p, int length) {
+    if (d.haveFrame || length < 6) return fail("bad frame header");
+    if (p[0] != 8) return fail("only 8-bit JPEGs are supported");
+    d.height = u16_at(p + 1);
+    d.width = u16_at(p + 3);
+    d.count = p[5];
+    if (d.width == 0 || d.height == 0) return fail("bad image size");
+    if ((std::size_t)d.width * d.height > texture::kMaxImagePixels) return fail("image too large");
+    if (d.count != 1 && d.count != 3) return fail("only grayscale and 3-component JPEGs are supported");
+    if (length < 6 + 3 * d.count) return fail("bad frame header");
+    for (int i = 0; i < d.count; i++) {
+        Component& c = d.comps[i];
+        c.id = p[6 + 3 * i];
+        c.h = p[7 + 3 * i] >> 4;
+        c.v = p[7 + 3 * i] & 15;
+        c.tq = p[8 + 3 * i];
+        if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.tq > 3) return fail("bad component");
+        d.hmax = std::max(d.hmax, c.h);
+        d.vmax = std::max(d.vmax, c.v);
+    }
+    if (d.count == 1) d.comps[0].h = d.comps[0].v = d.hmax = d.vmax = 1; // a single component has no MCU structure
+    d.mcusX = (d.width + 8 * d.hmax - 1) / (8 * d.hmax);
+    d.mcusY = (d.height + 8 * d.vmax - 1) / (8 * d.vmax);
+    for (int i = 0; i < d.count; i++) {
+        Component& c = d.comps[i];
+        if (d.hmax % c.h || d.vmax % c.v || d.hmax / c.h > 2 || d.vmax / c.v > 2)
+            return fail("unsupported chroma subsampling");
+        c.width = (d.width * c.h + d.hmax - 1) / d.hmax;
+        c.height = (d.height * c.v + d.vmax - 1) / d.vmax;
+        c.blocksW = d.mcusX * c.h;
+        c.blocksH = d.mcusY * c.v;
+        c.plane.assign((std::size_t)c.blocksW * 8 * c.blocksH * 8, 0);
+    }
+    if (d.count == 3 && d.comps[0].id == 'R' && d.comps[1].id == 'G' && d.comps[2].id == 'B') d.rgb = true;
+    d.haveFrame = true;
+    return true;
+}
+
+// Decode the entropy-coded data of a scan; returns where it ends.
+bool read_scan(Decoder& d, const std::uint8_t* p, int length, std::size_t& pos) {
+    if (!d.haveFrame || length < 1) return fail("scan before frame");
+    int n = p[0];
+    if (n < 1 || n > d.count || length < 4 + 2 * n) return fail("bad scan header");
+    Component* scan[3];
+    for (int i = 0; i < n; i++) {
+        int id = p[1 + 2 * i];
+        scan[i] = nullptr;
+        for (int k = 0; k < d.count; k++)
+            if (d.comps[k].id == id) scan[i] = &d.comps[k];
+        if (!scan[i]) return fail("scan names an unknown component");
+        scan[i]->td = p[2 + 2 * i] >> 4;
+        scan[i]->ta = p[2 + 2 * i] & 15;
+        if (scan[i]->td > 3 || scan[i]->ta > 3 || !d.dc[scan[i]->td].present || !d.ac[scan[i]->ta].present ||
+            !d.haveQuant[scan[i]->tq])
+            return fail("scan uses a missing table");
+        scan[i]->pred = 0;
+    }
+
+    Bits bits{d.file + pos, d.file + d.size};
+    alignas(16) float block[64];
+    // An interleaved scan goes MCU by MCU; a single-component scan block
+    // by block over the component's own extent.
+    const bool interleaved = n > 1;
+    const int unitsX = interleaved ? d.mcusX : (scan[0]->width + 7) / 8;
+    const int unitsY = interleaved ? d.mcusY : (scan[0]->height + 7) / 8;
+    int untilRestart = d.restartInterval;
+    for (int uy = 0; uy < unitsY; uy++) {
+        for (int ux = 0; ux < unitsX; ux++) {
+            if (d.restartInterval && untilRestart == 0) {
+                bits.restart();
+                for (int i = 0; i < n; i++) scan[i]->pred = 0;
+                untilRestart = d.restartInterval;
+            }
+            for (int i = 0; i < n; i++) {
+                Component& c = *scan[i];
+                const int bh = interleaved ? c.h : 1, bv = interleaved ? c.v : 1;
+                for (int by = 0; by < bv; by++) {
+                    for (int bx = 0; bx < bh; bx++) {
+                        int acs = decode_block(bits, c, d.dc[c.td], d.ac[c.ta], d.quant[c.tq], block);
+                        if (acs < 0) return fail("corrupt entropy-coded data");
+                        const std::size_t stride = (std::size_t)c.blocksW * 8;
+                        const std::size_t row = (std::size_t)(uy * bv + by) * 8, col = (std::size_t)(ux * bh + bx) * 8;
+                        std::uint8_t* out = c.plane.data() + row * stride + col;
+                        if (acs) {
+                            idct_block(block, out, stride);
+                        } else { // flat block: the IDCT of DC alone is DC everywhere
+                            long v = std::lrint(block[0] + 128.0f);
+                            std::uint8_t value = (std::uint8_t)std::min(255L, std::max(0L, v));
+                            for (int r = 0; r < 8; r++) std::memset(out + r * stride, value, 8);
+                        }
+                    }
+                }
+            }
+            untilRestart--;
+        }
+    }
+
+    // The next marker: the reader stops at it, or is at most 16 bytes
+    // (8 buffered, each possibly stuffed) past where it last read. Never
+    // back up before the scan's data, or a short scan finds its own SOS.
+    const std::size_t start = pos;
+    pos = (std::size_t)(bits.p - d.file);
+    pos = pos > start + 16 ? pos - 16 : start;
+    while (pos + 1 < d.size && !(d.file[pos] == 0xFF && d.file[pos + 1] != 0 && d.file[pos + 1] != 0xFF &&
+                                 !(d.file[pos + 1] >= 0xD0 && d.file[pos + 1] <= 0xD7)))
+        pos++;
+    d.scans++;
+    return true;
+}
+
+// Chroma for output row y at full resolution, with libjpeg's "fancy"
+// upsampling: each output sample weighs the nearest input sample 3/4 and
+// the next nearest 1/4 along each subsampled axis. colsum is scratch of
+// c.width + 2 entries.
+void upsample_row(const Component& c, int hs, int vs, int y, std::int16_t* colsum, std::uint8_t* out) {
+    const std::size_t stride = (std::size_t)c.blocksW * 8;
+    const int w = c.width;
+    std::int16_t* sum = colsum + 1;
+    if (vs == 2) {
+        int near = std::min(y >> 1, c.height - 1);
+        int far = (y & 1) ? std::min(near + 1, c.height - 1) : std::max(near - 1, 0);
+        const std::uint8_t* a = c.plane.data() + near * stride;
+        const std::uint8_t* b = c.plane.data() + far * stride;
+        int x = 0;
+#if defined(JPEG_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= w; x += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+            __m128i alo = _mm_unpacklo_epi8(va, zero), ahi = _mm_unpackhi_epi8(va, zero);
+            __m128i lo = _mm_add_epi16(_mm_add_epi16(alo, _mm_slli_epi16(alo, 1)), _mm_unpacklo_epi8(vb, zero));
+            __m128i hi = _mm_add_epi16(_mm_add_epi16(ahi, _mm_slli_epi16(ahi, 1)), _mm_unpackhi_epi8(vb, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sum + x), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sum + x + 8), hi);
+        }
+#endif
+        for (; x < w; x++) sum[x] = (std::int16_t)(3 * a[x] + b[x]);
+    } else {
+        const std::uint8_t* a = c.plane.data() + std::min(y, c.height - 1) * stride;
+        for (int x = 0; x < w; x++) sum[x] = (std::int16_t)(4 * a[x]);
+    }
+    sum[-1] = sum[0];
+    sum[w] = sum[w - 1];
+
+    if (hs == 1) {
+        for (int x = 0; x < w; x++) out[x] = (std::uint8_t)((sum[x] + 2) >> 2);
+        return;
+    }
+    int x = 0;
+#if defined(JPEG_SSE2)
+    const __m128i eight = _mm_set1_epi16(8), seven = _mm_set1_epi16(7);
+    for (; x + 8 <= w; x += 8) {
+        __m128i mid = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sum + x));
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sum + x - 1));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sum + x + 1));
+        __m128i three = _mm_add_epi16(mid, _mm_slli_epi16(mid, 1));
+        __m128i even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(three, left), eight), 4);
+        __m128i odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(three, right), seven), 4);
+        __m128i lo = _mm_unpacklo_epi16(even, odd), hi = _mm_unpackhi_epi16(even, odd);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < w; x++) {
+        out[2 * x] = (std::uint8_t)((3 * sum[x] + sum[x - 1] + 8) >> 4);
+        out[2 * x + 1] = (std::uint8_t)((3 * sum[x] + sum[x + 1] + 7) >> 4);
+    }
+}
+
+// YCbCr (JFIF, full range) to BGR, in 16-bit fixed point: each chroma
+// term is (c - 128) * 4 times the coefficient scaled by 2^14, rounded to
+// its high 16 bits (_mm_mulhi_epi16 plus bit 15 of _mm_mullo_epi16).
+const int kCrToR = 22970; // 1.402
+const int kCbToG = 5638;  // 0.344136
+const int kCrToG = 11700; // 0.714136
+const int kCbToB = 29032; // 1.772
+
+inline int mulhi(int a, int k) {
+    return (a * k + 32768) >> 16;
+}
+
+// Convert a row of w pixels to BGR at dst.
+void ycc_to_bgr(const std::uint8_t* y, const std::uint8_t* cb, const std::uint8_t* cr, int w, std::uint8_t* dst) {
+    int x = 0;
+#if defined(JPEG_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+    auto mulhi_round = [](__m128i a, int k) {
+        __m128i vk = _mm_set1_epi16((short)k);
+        return _mm_add_epi16(_mm_mulhi_epi16(a, vk), _mm_srli_epi16(_mm_mullo_epi16(a, vk), 15));
+    };
+    // 8 pixels at a time, as BGR0 words stored 3 bytes apart: each store's
+    // fourth byte is overwritten by the next, so the last pixel of the row
+    // is left to the scalar loop.
+    for (; x + 8 < w; x += 8) {
+        __m128i vy = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+        __m128i vcb = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + x)), zero);
+        __m128i vcr = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + x)), zero);
+        vcb = _mm_slli_epi16(_mm_sub_epi16(vcb, c128), 2);
+        vcr = _mm_slli_epi16(_mm_sub_epi16(vcr, c128), 2);
+        __m128i vr = _mm_add_epi16(vy, mulhi_round(vcr, kCrToR));
+        __m128i vg = _mm_sub_epi16(_mm_sub_epi16(vy, mulhi_round(vcb, kCbToG)), mulhi_round(vcr, kCrToG));
+        __m128i vb = _mm_add_epi16(vy, mulhi_round(vcb, kCbToB));
+        __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(vb, vb), _mm_packus_epi16(vg, vg));
+        __m128i r0 = _mm_unpacklo_epi8(_mm_packus_epi16(vr, vr), zero);
+        alignas(16) std::uint32_t pixels[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(pixels), _mm_unpacklo_epi16(bg, r0));
+        _mm_store_si128(reinterpret_cast<__m128i*>(pixels + 4), _mm_unpackhi_epi16(bg, r0));
+        for (int i = 0; i < 8; i++) std::memcpy(dst + 3 * (x + i), pixels + i, 4);
+    }
+#endif
+    for (; x < w; x++) {
+        int vcb = (cb[x] - 128) * 4, vcr = (cr[x] - 128) * 4;
+        dst[3 * x + 2] = (std::uint8_t)std::min(255, std::max(0, y[x] + mulhi(vcr, kCrToR)));
+        dst[3 * x + 1] = (std::uint8_t)std::min(255, std::max(0, y[x] - mulhi(vcb, kCbToG) - mulhi(vcr, kCrToG)));
+        dst[3 * x] = (std::uint8_t)std::min(255, std::max(0, y[x] + mulhi(vcb, kCbToB)));
+    }
+}
+
+void write_image(const Decoder& d, texture::Image& image) {
+    const int w = d.width, h = d.height;
+    const std::size_t stride = texture::bmp_stride(w);
+    image.width = w;
+    image.height = h;
+    image.storage.assign(stride * h, 0);
+    image.pixels = image.storage.data();
+
+    // Full-resolution rows of each component (+16 so SIMD stores of the
+    // upsampler may run past an odd width).
+    std::vector<std::uint8_t> rows((std::size_t)d.count * (w + 16));
+    std::vector<std::int16_t> colsum((std::size_t)w + 16);
+    for (int y = 0; y < h; y++) {
+        const std::uint8_t* src[3];
+        for (int i = 0; i < d.count; i++) {
+            const Component& c = d.comps[i];
+            int hs = d.hmax / c.h, vs = d.vmax / c.v;
+            if (hs == 1 && vs == 1) {
+                src[i] = c.plane.data() + (std::size_t)y * c.blocksW * 8;
+            } else {
+                std::uint8_t* out = rows.data() + (std::size_t)i * (w + 16);
+                upsample_row(c, hs, vs, y, colsum.data(), out);
+                src[i] = out;
+            }
+        }
+        std::uint8_t* dst = image.storage.data() + (std::size_t)(h - 1 - y) * stride; // bottom row first
+        if (d.count == 1) {
+            for (int x = 0; x < w; x++) dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = src[0][x];
+            continue;
+        }
+        if (!d.rgb) {
+            ycc_to_bgr(src[0], src[1], src[2], w, dst);
+            continue;
+        }
+        for (int x = 0; x < w; x++) {
+            dst[3 * x] = src[2][x];
+            dst[3 * x + 1] = src[1][x];
+            dst[3 * x + 2] = src[0][x];
+        }
+    }
+}
+
+} // namespace
+
+bool decode(const std::uint8_t* file, std::size_t size, texture::Image& image) {
+    if (size < 4 || file[0] != 0xFF || file[1] != 0xD8) return fail("not a JPEG file");
+    Decoder d;
+    d.file = file;
+    d.size = size;
+    std::size_t pos = 2;
+    for (;;) {
+        while (pos < size && file[pos] != 0xFF) pos++; // tolerate junk between segments
+        while (pos < size && file[pos] == 0xFF) pos++;
+        if (pos >= size) break;
+        int marker = file[pos++];
+        if (marker == 0xD9) break; // EOI
+        if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+        if (pos + 2 > size) return fail("truncated file");
+        int length = u16_at(file + pos) - 2;
+        if (length < 0 || pos + 2 + (std::size_t)length > size) return fail("truncated segment");
+        const std::uint8_t* p = file + pos + 2;
+        pos += 2 + (std::size_t)length;
+
+        bool ok = true;
+        if (marker == 0xC0 || marker == 0xC1) ok = read_frame(d, p, length);
+        else if (marker == 0xC4) ok = read_huffman(d, p, length);
+        else if (marker == 0xDB) ok = read_quant(d, p, length);
+        else if (marker == 0xDD) d.restartInterval = length >= 2 ? u16_at(p) : 0;
+        else if (marker == 0xDA) ok = read_scan(d, p, length, pos);
+        else if (marker == 0xEE && length >= 12 && std::memcmp(p, "Adobe", 5) == 0) d.rgb = p[11] == 0 && d.count != 1;
+        else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            return fail("progressive, lossless and arithmetic-coded JPEGs are not supported");
+        if (!ok) return false;
+    }
+    if (!d.haveFrame || d.scans == 0) return fail("no image data");
+    write_image(d, image);
+    return true;
+}
+
+} // namespace jpeg
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "texture.h"
+
+// Baseline JPEG decoding for textures (ceiling.jpg).
+//
+// Huffman-coded sequential DCT, 8-bit, grayscale or YCbCr with chroma
+// subsampled by up to 2 in either direction (4:4:4, 4:2:2, 4:2:0, 4:4:0),
+// interleaved or not, with or without restart markers. Progressive,
+// arithmetic-coded, lossless, 12-bit and CMYK files are rejected.
+//
+// The IDCT (float AAN), fancy (triangle-filter) chroma upsampling and the
+// YCbCr to BGR conversion use SSE2 where available, and match the scalar
+// code they replace. Huffman decoding is table driven, 9 bits at a time.
+namespace jpeg {
+
+// Decode into image (BMP layout, see texture::Image). False, with a message
+// on stderr, for a file that is malformed or uses an unsupported feature.
+bool decode(const std::uint8_t* file, std::size_t size, texture::Image& image);
+
+} // namespace jpeg
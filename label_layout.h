@@ -0,0 +1,182 @@
+#ifndef LABEL_LAYOUT_H
+#define LABEL_LAYOUT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Screen-space declutter for floating labels.
+//
+// Callers add each label's window rectangle and a priority, then solve()
+// places the labels in one greedy pass, highest priority first (ties keep
+// the earlier label first). Each label is lifted until it clears every
+// label already placed, then inserted into a hashed uniform grid sized to
+// the average label, so a label is only compared with its placed
+// neighbours and the cost stays linear in the label count. Rectangles
+// spanning more than kMaxSpan cells per axis (labels right in front of the
+// camera) are tested against everything instead, which keeps the grid's
+// memory bounded by kMaxSpan^2 entries per label. Nothing allocates once
+// reserve() has covered the label count.
+class LabelLayout {
+public:
+    static const int kMaxSpan = 4;
+
+    void reserve(int n) {
+        boxes.reserve(n);
+        order.reserve(n);
+        placed.reserve(n);
+        large.reserve(n);
+        entries.reserve(static_cast<size_t>(n) * kMaxSpan * kMaxSpan);
+        bucketHead.reserve(bucketCount(n));
+    }
+
+    void clear() { boxes.clear(); }
+    int size() const { return static_cast<int>(boxes.size()); }
+
+    // Window rectangle (y up) of a label; returns its index.
+    int add(float x0, float y0, float x1, float y1, float priority) {
+        boxes.push_back({x0, y0, x1, y1, priority, 0.0f});
+        return size() - 1;
+    }
+
+    // How far label i was moved up, in pixels.
+    float shift(int i) const { return boxes[i].shift; }
+
+    // Lift labels clear of every higher-priority one, leaving margin pixels
+    // between a lifted label and the ones below it. Returns the number of
+    // labels moved; none overlap afterwards.
+    int solve(float margin) {
+        int n = size();
+        if (n < 2) return 0;
+
+        float sumW = 0.0f, sumH = 0.0f;
+        order.clear();
+        for (int i = 0; i < n; i++) {
+            sumW += boxes[i].x1 - boxes[i].x0;
+            sumH += boxes[i].y1 - boxes[i].y0;
+            order.push_back(i);
+        }
+        cell = std::fmax(std::fmax(sumW, sumH) / n, 1.0f);
+        std::sort(order.begin(), order.end(), [this](int a, int b) {
+            return boxes[a].priority > boxes[b].priority || (boxes[a].priority == boxes[b].priority && a < b);
+        });
+
+        int buckets = bucketCount(n);
+        bucketMask = static_cast<uint32_t>(buckets - 1);
+        bucketHead.assign(buckets, -1);
+        entries.clear();
+        placed.clear();
+        large.clear();
+
+        int moved = 0;
+        for (int i : order) {
+            Box& b = boxes[i];
+            // Each lift goes above the highest placed label hit, so the
+            // loop ends; a new hit can only come from a label further up.
+            for (float top = highestHit(b, margin); top > b.y0; top = highestHit(b, margin)) {
+                b.shift += top - b.y0;
+                b.y1 += top - b.y0;
+                b.y0 = top;
+            }
+            if (b.shift > 0.0f) moved++;
+            insert(i);
+        }
+        return moved;
+    }
+
+    // Overlapping pairs left, by brute force (for tests and benchmarks).
+    int countOverlaps() const {
+        int count = 0;
+        for (int i = 0; i < size(); i++)
+            for (int j = i + 1; j < size(); j++)
+                if (overlap(boxes[i], boxes[j])) count++;
+        return count;
+    }
+
+private:
+    struct Box {
+        float x0, y0, x1, y1;
+        float priority;
+        float shift;
+    };
+
+    // A placed box's rectangle, copied so a bucket walk touches no Box.
+    struct Entry {
+        float x0, y0, x1, y1;
+        int next; // next entry in the same bucket, or -1
+    };
+
+    std::vector<Box> boxes;
+    std::vector<int> order;      // box indices, highest priority first
+    std::vector<int> placed;     // boxes placed so far
+    std::vector<int> large;      // placed boxes too big for the grid
+    std::vector<Entry> entries;  // (cell, box) pairs of placed boxes
+    std::vector<int> bucketHead; // first entry of each bucket, or -1
+    uint32_t bucketMask = 0;
+    float cell = 1.0f;
+
+    static bool overlap(const Box& a, const Box& b) {
+        return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+    }
+
+    static int bucketCount(int n) {
+        int buckets = 64;
+        while (buckets < 2 * n) buckets *= 2;
+        return buckets;
+    }
+
+    uint32_t bucket(int cx, int cy) const {
+        uint32_t h = static_cast<uint32_t>(cx) * 73856093u ^ static_cast<uint32_t>(cy) * 19349663u;
+        return h & bucketMask;
+    }
+
+    void cells(const Box& b, int& cx0, int& cy0, int& cx1, int& cy1) const {
+        cx0 = static_cast<int>(std::floor(b.x0 / cell));
+        cy0 = static_cast<int>(std::floor(b.y0 / cell));
+        cx1 = static_cast<int>(std::floor(b.x1 / cell));
+        cy1 = static_cast<int>(std::floor(b.y1 / cell));
+    }
+
+    // Where b's bottom must go to clear the placed labels it overlaps, plus
+    // margin; b.y0 itself when it overlaps none.
+    float highestHit(const Box& b, float margin) const {
+        float top = b.y0;
+        int cx0, cy0, cx1, cy1;
+        cells(b, cx0, cy0, cx1, cy1);
+        if (cx1 - cx0 >= kMaxSpan || cy1 - cy0 >= kMaxSpan) {
+            for (int j : placed)
+                if (overlap(b, boxes[j])) top = std::fmax(top, boxes[j].y1 + margin);
+            return top;
+        }
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++)
+                for (int e = bucketHead[bucket(cx, cy)]; e >= 0; e = entries[e].next) {
+                    const Entry& other = entries[e];
+                    if (b.x0 < other.x1 && other.x0 < b.x1 && b.y0 < other.y1 && other.y0 < b.y1)
+                        top = std::fmax(top, other.y1 + margin);
+                }
+        for (int j : large)
+            if (overlap(b, boxes[j])) top = std::fmax(top, boxes[j].y1 + margin);
+        return top;
+    }
+
+    void insert(int i) {
+        placed.push_back(i);
+        const Box& box = boxes[i];
+        int cx0, cy0, cx1, cy1;
+        cells(box, cx0, cy0, cx1, cy1);
+        if (cx1 - cx0 >= kMaxSpan || cy1 - cy0 >= kMaxSpan) {
+            large.push_back(i);
+            return;
+        }
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) {
+                uint32_t b = bucket(cx, cy);
+                entries.push_back({box.x0, box.y0, box.x1, box.y1, bucketHead[b]});
+                bucketHead[b] = static_cast<int>(entries.size()) - 1;
+            }
+    }
+};
+
+#endif
@@ -1,17 +1,37 @@
 #include <GL/glut.h>
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <cstdlib>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "asset_pack.h"
 #include "audio.h"
+#include "texture.h"
 #include "bitmap.h"
 #include "light.h"
+#include "camera.h"
 #include "tooltip.h"
 #include "checklist.h"
 #include "stats.h"
+#include "profiler.h"
+#include "text.h"
+#include "sdf_text.h"
 
+// Camera matrices shared by rendering and picking
+Camera camera;
 // Initialize TooltipSystem
 TooltipSystem tooltipSystem;
+TooltipHandle gpuTooltip, fanTooltip, ramTooltip, motherboardTooltip,
+	processorTooltip, psuTooltip, hddTooltip;
 ChecklistSystem checklistSystem;
 int mouseGlobalX = 0;
 int mouseGlobalY = 0;
@@ -21,10 +41,44 @@ int mouseGlobalY = 0;
 #include "parameter.h"
 #include "motion.h"
 #include "objects.h"
+#include "mesh_capture.h"
 
 /* TEXTURE HANDLING */
-void loadTexture(GLuint texture, const char* filename) {
-	BmpLoader image(filename);
+#ifndef GL_BGR_EXT
+#define GL_BGR_EXT 0x80E0
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// glCompressedTexImage2D (GL 1.3), loaded at runtime since the Windows GL
+// headers only expose 1.1. It stays NULL when the driver has no S3TC (or
+// with --texture-decompress); BC1 textures are then decompressed on the
+// texture threads and uploaded as BGR.
+typedef void (GLAPIENTRY* CompressedTexImage2DFn)(GLenum target, GLint level, GLenum internalFormat, GLsizei width,
+	GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data);
+CompressedTexImage2DFn compressedTexImage2D = NULL;
+bool textureDecompress = false;
+
+void compressedTextureInit() {
+	const char* ext = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+	const char* name = "GL_EXT_texture_compression_s3tc";
+	const size_t length = std::strlen(name);
+	bool s3tc = false;
+	for (const char* p = ext ? std::strstr(ext, name) : NULL; p && !s3tc; p = std::strstr(p + length, name))
+		s3tc = (p == ext || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0');
+	if (textureDecompress || !s3tc)
+		return;
+	compressedTexImage2D = reinterpret_cast<CompressedTexImage2DFn>(glutGetProcAddress("glCompressedTexImage2D"));
+	if (!compressedTexImage2D)
+		compressedTexImage2D = reinterpret_cast<CompressedTexImage2DFn>(glutGetProcAddress("glCompressedTexImage2DARB"));
+}
+
+// Upload a mip chain (texture.h). Levels too large for the driver are
+// skipped, so the next one down becomes level 0. Returns the texture memory
+// the levels take, or 0 if nothing was uploaded.
+size_t loadTexture(GLuint texture, const std::uint8_t* chain, size_t size, texture::Pixels& pixels) {
+	PROFILE_ZONE("loadTexture");
 	glBindTexture(GL_TEXTURE_2D, texture);
 
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
@@ -33,17 +87,118 @@ void loadTexture(GLuint texture, const char* filename) {
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, image.iWidth, image.iHeight, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+	texture::Header header;
+	std::vector<texture::Level> levels;
+	if (!texture::parse(chain, size, header, levels))
+		return 0;
+	pixels = (texture::Pixels)header.pixels;
+	if (pixels == texture::Pixels::Bc1 && !compressedTexImage2D)
+		return 0;
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	size_t first = 0;
+	while (first + 1 < levels.size() && (levels[first].width > maxSize || levels[first].height > maxSize))
+		first++;
+	size_t bytes = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t l = first; l < levels.size(); l++) {
+		if (pixels == texture::Pixels::Bc1) {
+			compressedTexImage2D(GL_TEXTURE_2D, (GLint)(l - first), GL_COMPRESSED_RGB_S3TC_DXT1_EXT, levels[l].width,
+				levels[l].height, 0, (GLsizei)levels[l].size, levels[l].data);
+			bytes += levels[l].size;
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)(l - first), GL_RGB, levels[l].width, levels[l].height, 0, GL_BGR_EXT,
+				GL_UNSIGNED_BYTE, levels[l].data);
+			bytes += (size_t)levels[l].width * levels[l].height * 4;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return bytes;
 }
 
 void textureInit() {
+	PROFILE_ZONE("textureInit");
 	// Create Texture.
 	textures = new GLuint[NUM_TEXTURE];
 	glGenTextures(NUM_TEXTURE, textures);
 
-	// Load the Texture.
-	for (int i = 0; i < NUM_TEXTURE; i++)
-		loadTexture(textures[i], texPath[i]);
+	// Decode and mipmap the images on worker threads (compiled chains in the
+	// pack need neither, and BC1 chains only need decompressing where the
+	// driver cannot take them); GL is only called from this thread, which
+	// uploads each texture as soon as it is ready and then frees its pixels.
+	compressedTextureInit();
+	const bool decompress = compressedTexImage2D == NULL;
+	std::vector<std::vector<std::uint8_t> > storage(NUM_TEXTURE);
+	std::vector<const std::uint8_t*> chains(NUM_TEXTURE, NULL);
+	std::vector<size_t> sizes(NUM_TEXTURE, 0);
+	std::vector<double> decompressMs(NUM_TEXTURE, 0.0);
+	std::vector<char> done(NUM_TEXTURE, 0);
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::atomic<int> next(0);
+	unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < std::min<unsigned>(workers, NUM_TEXTURE); t++) {
+		pool.emplace_back([&] {
+			profiler::set_thread_name("textures");
+			for (int i = next++; i < NUM_TEXTURE; i = next++) {
+				PROFILE_ZONE("decodeTexture");
+				if (!texture::load(texPath[i], storage[i], chains[i], sizes[i]))
+					chains[i] = NULL;
+				texture::Header header;
+				std::vector<texture::Level> levels;
+				if (chains[i] != NULL && decompress && texture::parse(chains[i], sizes[i], header, levels) &&
+					header.pixels == (std::uint32_t)texture::Pixels::Bc1) {
+					PROFILE_ZONE("decompressTexture");
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					std::vector<std::uint8_t> decoded;
+					if (texture::decompress(chains[i], sizes[i], decoded)) {
+						storage[i].swap(decoded);
+						chains[i] = storage[i].data();
+						sizes[i] = storage[i].size();
+					} else {
+						chains[i] = NULL;
+					}
+					decompressMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				done[i] = 1;
+				ready.notify_one();
+			}
+		});
+	}
+	for (int i = 0; i < NUM_TEXTURE; i++) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ready.wait(lock, [&] { return done[i] != 0; });
+		}
+		if (chains[i] != NULL) {
+			// Timed to completion, so drivers that copy lazily are not flattered.
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			texture::Pixels pixels = texture::Pixels::Bgr8;
+			size_t bytes = loadTexture(textures[i], chains[i], sizes[i], pixels);
+			glFinish();
+			double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (bytes > 0)
+				stats::record_texture(pixels == texture::Pixels::Bc1 ? stats::TextureFormat::Bc1 : stats::TextureFormat::Bgr8,
+					(double)bytes, uploadMs, decompressMs[i]);
+		}
+		std::vector<std::uint8_t>().swap(storage[i]);
+	}
+	for (size_t t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	const char* names[] = {"BGR8", "BC1"};
+	for (int f = 0; f < (int)stats::TextureFormat::Count; f++) {
+		const stats::TextureUploads& uploads = stats::get().textures[f];
+		if (uploads.textures == 0)
+			continue;
+		std::cout << "[texture] " << names[f] << ": " << uploads.textures << " textures, " << uploads.megabytes
+			<< " MB, upload " << uploads.uploadMs << " ms";
+		if (uploads.decompressMs > 0.0)
+			std::cout << ", BC1 decompression " << uploads.decompressMs << " ms";
+		std::cout << std::endl;
+	}
 }
 
 /* RENDERING HANDLING */
@@ -58,120 +213,179 @@ void change_size(int w, int h) {
 	h = h == 0 ? 1 : h;
 	ratio = (float)w / (float)h;
 	glViewport(0, 0, w, h);
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(80.0f, ratio, 0.7f, 100.0f);
-	glMatrixMode(GL_MODELVIEW);
+	camera.setViewport(0, 0, w, h);
+	camera.setPerspective(80.0f, ratio, 0.7f, 100.0f);
+	camera.loadProjection();
 }
 
 void renderScene()
 {
+	PROFILE_FRAME();
+	PROFILE_ZONE("renderScene");
 	stats::frame_start();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glLoadIdentity();
-	gluLookAt(x, 5.0f, z,
+	camera.lookAt(x, 5.0f, z,
 		x + lx, y, z + lz,
 		0.0f, 1.0f, 0.0f);
+	// Before glClear: the first frame bakes the glyph atlas in the back buffer.
+	text::begin_frame(camera);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	camera.loadView();
 
 	// 3D audio listener follows the camera.
-	audio::update_listener(
-		{(float)x, 5.0f, (float)z},
-		{(float)lx, (float)(y - 5.0), (float)lz},
-		{0.0f, 1.0f, 0.0f}
-	);
+	{
+		PROFILE_ZONE("renderScene::listener");
+		audio::update_listener(
+			{(float)x, 5.0f, (float)z},
+			{(float)lx, (float)(y - 5.0), (float)lz},
+			{0.0f, 1.0f, 0.0f}
+		);
+	}
 	
 	// App Logic - Tooltips
-	std::string forcedComponent = "";
+	TooltipHandle forcedComponent;
 	if (enterPressed) {
-		if (objIndex == REMOVE_FAN || objIndex == REMOVE_FAN - 1) forcedComponent = "CPU Cooling Unit";
-		else if (objIndex == REMOVE_RAM_STICK || objIndex == REMOVE_RAM_STICK - 1) forcedComponent = "DDR4 RAM";
-		else if (objIndex == REMOVE_PROCESSOR || objIndex == REMOVE_PROCESSOR - 1) forcedComponent = "Processor";
-		else if (objIndex == REMOVE_PSU || objIndex == REMOVE_PSU - 1) forcedComponent = "Power Supply";
-		else if (objIndex == REMOVE_HDD || objIndex == REMOVE_HDD - 1) forcedComponent = "Hard Disk";
-		else if (objIndex == REMOVE_GPU || objIndex == REMOVE_GPU - 1) forcedComponent = "NVIDIA GTX Graphics";
-		else if (objIndex == REMOVE_MOTHERBOARD || objIndex == REMOVE_MOTHERBOARD - 1) forcedComponent = "Motherboard";
+		if (objIndex == REMOVE_FAN || objIndex == REMOVE_FAN - 1) forcedComponent = fanTooltip;
+		else if (objIndex == REMOVE_RAM_STICK || objIndex == REMOVE_RAM_STICK - 1) forcedComponent = ramTooltip;
+		else if (objIndex == REMOVE_PROCESSOR || objIndex == REMOVE_PROCESSOR - 1) forcedComponent = processorTooltip;
+		else if (objIndex == REMOVE_PSU || objIndex == REMOVE_PSU - 1) forcedComponent = psuTooltip;
+		else if (objIndex == REMOVE_HDD || objIndex == REMOVE_HDD - 1) forcedComponent = hddTooltip;
+		else if (objIndex == REMOVE_GPU || objIndex == REMOVE_GPU - 1) forcedComponent = gpuTooltip;
+		else if (objIndex == REMOVE_MOTHERBOARD || objIndex == REMOVE_MOTHERBOARD - 1) forcedComponent = motherboardTooltip;
+	}
+	{
+		PROFILE_ZONE("renderScene::tooltipUpdate");
+		tooltipSystem.update(camera, mouseGlobalX, mouseGlobalY, forcedComponent);
 	}
-	tooltipSystem.update(mouseGlobalX, mouseGlobalY, forcedComponent);
 
 	// Save simple context for performance logs.
 	stats::set_frame_context(page, motion_present);
 
 	if (page == 1) {
-		drawGround();
-		drawCube();
-		cpuView();
-		drawCPU();
+		{
+			PROFILE_ZONE("renderScene::room");
+			stats::GpuPassScope gpuPass(stats::Pass::Room);
+			drawGround();
+			drawCube();
+			cpuView();
+			drawRoomObjects();
+		}
+		{
+			PROFILE_ZONE("renderScene::components");
+			stats::GpuPassScope gpuPass(stats::Pass::Components);
+			drawCPU();
+		}
+		{
+			PROFILE_ZONE("renderScene::glass");
+			stats::GpuPassScope gpuPass(stats::Pass::Glass);
+			drawCase();
+		}
 
 		// Update dynamic positions and visibility based on offset
-		point3D gpuOff = gpu_.getOffset();
-		tooltipSystem.updateComponent("NVIDIA GTX Graphics", 7.55f + gpuOff.x,
-									4.2f + gpuOff.y, -4.65f + gpuOff.z, gpuOff.x);
-
-		point3D fanOff = fan_.getOffset();
-		tooltipSystem.updateComponent("CPU Cooling Unit", 7.746f + fanOff.x,
-									4.841f + fanOff.y, -4.566f + fanOff.z,
-									fanOff.x);
-
-		point3D psuOff = psu_.getOffset();
-		tooltipSystem.updateComponent("Power Supply", 8.0f + psuOff.x,
-									3.4f + psuOff.y, -4.79f + psuOff.z, psuOff.x);
-
-		point3D hddOff = harddisk_.getOffset();
-		tooltipSystem.updateComponent("Hard Disk", 8.0f + hddOff.x,
-									3.86f + hddOff.y, -3.2f + hddOff.z, hddOff.x);
-
-		point3D chipOff = chipset_.getOffset();
-		tooltipSystem.updateComponent("Processor", 8.0f + chipOff.x,
-									4.77f + chipOff.y, -4.7f + chipOff.z,
-									chipOff.x);
+		{
+			PROFILE_ZONE("renderScene::tooltipSync");
+			point3D gpuOff = gpu_.getOffset();
+			tooltipSystem.updateComponent(gpuTooltip, 7.55f + gpuOff.x,
+										4.2f + gpuOff.y, -4.65f + gpuOff.z, gpuOff.x);
+
+			point3D fanOff = fan_.getOffset();
+			tooltipSystem.updateComponent(fanTooltip, 7.746f + fanOff.x,
+										4.841f + fanOff.y, -4.566f + fanOff.z,
+										fanOff.x);
+
+			point3D psuOff = psu_.getOffset();
+			tooltipSystem.updateComponent(psuTooltip, 8.0f + psuOff.x,
+										3.4f + psuOff.y, -4.79f + psuOff.z, psuOff.x);
+
+			point3D hddOff = harddisk_.getOffset();
+			tooltipSystem.updateComponent(hddTooltip, 8.0f + hddOff.x,
+										3.86f + hddOff.y, -3.2f + hddOff.z, hddOff.x);
+
+			point3D chipOff = chipset_.getOffset();
+			tooltipSystem.updateComponent(processorTooltip, 8.0f + chipOff.x,
+										4.77f + chipOff.y, -4.7f + chipOff.z,
+										chipOff.x);
 									
-		point3D ramOff = ram_.getOffset();
-		tooltipSystem.updateComponent("DDR4 RAM", 8.0f + ramOff.x,
-									4.85f + ramOff.y, -4.25f + ramOff.z, ramOff.x);
+			point3D ramOff = ram_.getOffset();
+			tooltipSystem.updateComponent(ramTooltip, 8.0f + ramOff.x,
+										4.85f + ramOff.y, -4.25f + ramOff.z, ramOff.x);
 
-		point3D mbOff = motherboard_.getOffset();
-		tooltipSystem.updateComponent("Motherboard", 8.0f + mbOff.x,
-									4.65f + mbOff.y, -4.6f + mbOff.z, mbOff.x);
+			point3D mbOff = motherboard_.getOffset();
+			tooltipSystem.updateComponent(motherboardTooltip, 8.0f + mbOff.x,
+										4.65f + mbOff.y, -4.6f + mbOff.z, mbOff.x);
+		}
 
 		// Draw tooltips on top
-		tooltipSystem.draw((float)x, 5.0f, (float)z);
-		
-		// Draw Checklist HUD
-		checklistSystem.draw(objIndex, width, hight);
+		{
+			PROFILE_ZONE("renderScene::tooltips");
+			stats::GpuPassScope gpuPass(stats::Pass::Tooltips);
+			tooltipSystem.draw(camera);
+		}
 	}
 	else if(page == 0) {
+		PROFILE_ZONE("renderScene::frontPage");
 		front_page();
 		progress_wheel();
 	}
-	stats::frame_end();
-	stats::draw_overlay();
+	{
+		stats::GpuPassScope gpuPass(stats::Pass::Hud);
+		// Draw Checklist HUD
+		if (page == 1) checklistSystem.draw(objIndex, hight);
+		stats::frame_end();
+		{
+			PROFILE_ZONE("renderScene::overlay");
+			stats::draw_overlay();
+		}
+		// All of the frame's text in one draw, on top of everything.
+		text::flush();
+	}
 	glutSwapBuffers();
 }
 
+// Capture each component's triangles once so hover picks hit the actual
+// geometry rather than its bounding sphere.
+void registerPickMeshes() {
+	PROFILE_ZONE("registerPickMeshes");
+	tooltipSystem.setPickMesh(gpuTooltip, mesh_capture::capture([] { gpu_.render(); }));
+	tooltipSystem.setPickMesh(fanTooltip, mesh_capture::capture([] { fan_.render(); }));
+	tooltipSystem.setPickMesh(ramTooltip, mesh_capture::capture([] {
+		ram_.render(8., 4.845, -4.296);
+		ram_.render(8., 4.845, -4.268);
+		ram_.render(8., 4.845, -4.235);
+	}));
+	// The motherboard applies its move offset twice in render().
+	tooltipSystem.setPickMesh(motherboardTooltip, mesh_capture::capture([] { motherboard_.render(); }), 2.0f);
+	tooltipSystem.setPickMesh(processorTooltip, mesh_capture::capture([] { chipset_.render(); }));
+	tooltipSystem.setPickMesh(psuTooltip, mesh_capture::capture([] { psu_.render(); }));
+	tooltipSystem.setPickMesh(hddTooltip, mesh_capture::capture([] { harddisk_.render(); }));
+}
+
 void opengl_init(void) {
 	glEnable(GL_DEPTH_TEST);
 	stats::init();
 	// Optional 3D audio (enabled when built with USE_OPENAL).
+	PROFILE_ZONE("opengl_init");
 	if (audio::init()) {
 		audio::preload_defaults();
 		std::atexit(audio::shutdown);
 	}
 	
 	// Register AR Tooltips
-	tooltipSystem.registerComponent("NVIDIA GTX Graphics", "High performance GPU",
+	gpuTooltip = tooltipSystem.registerComponent("NVIDIA GTX Graphics", "High performance GPU",
                                   7.55f, 4.2f, -4.65f, 0.6f);
-	tooltipSystem.registerComponent("CPU Cooling Unit", "Spinning at 2000 RPM",
+	fanTooltip = tooltipSystem.registerComponent("CPU Cooling Unit", "Spinning at 2000 RPM",
                                   7.746f, 4.841f, -4.566f, 0.5f);
-	tooltipSystem.registerComponent("DDR4 RAM", "16GB 3200MHz Memory", 8.0f, 4.85f, -4.25f, 0.4f);
-	tooltipSystem.registerComponent("Motherboard", "Main Circuit Board", 8.0f, 4.65f, -4.6f, 0.7f, "CPU Cooling Unit");
-	tooltipSystem.registerComponent("Processor", "Intel Core i7 CPU", 8.0f, 4.77f,
-                                  -4.7f, 0.3f, "CPU Cooling Unit");
-	tooltipSystem.registerComponent("Power Supply", "750W Gold Rated", 8.0f, 3.4f,
+	ramTooltip = tooltipSystem.registerComponent("DDR4 RAM", "16GB 3200MHz Memory", 8.0f, 4.85f, -4.25f, 0.4f);
+	motherboardTooltip = tooltipSystem.registerComponent("Motherboard", "Main Circuit Board", 8.0f, 4.65f, -4.6f, 0.7f, fanTooltip);
+	processorTooltip = tooltipSystem.registerComponent("Processor", "Intel Core i7 CPU", 8.0f, 4.77f,
+                                  -4.7f, 0.3f, fanTooltip);
+	psuTooltip = tooltipSystem.registerComponent("Power Supply", "750W Gold Rated", 8.0f, 3.4f,
                                   -4.79f, 0.6f);
-	tooltipSystem.registerComponent("Hard Disk", "2TB Mechanical Storage", 8.0f,
+	hddTooltip = tooltipSystem.registerComponent("Hard Disk", "2TB Mechanical Storage", 8.0f,
                                   3.86f, -3.2f, 0.5f);
 
 	textureInit();
+	registerPickMeshes();
+	sdf_text::init();
 	glutDisplayFunc(renderScene);
 	glutIdleFunc(renderScene);
 	glutReshapeFunc(change_size);
@@ -188,7 +402,32 @@ void setDeltaTime() {
 }
 
 int main(int argc, char ** argv) {
+	profiler::set_thread_name("main");
 	glutInit(&argc, argv);
+	// --audio-out=<file.wav> records the software audio mix (builds without OpenAL).
+	// --audio-adpcm keeps sounds IMA-ADPCM compressed in memory.
+	// --audio-reverb adds the reverberation of the room drawCube() draws.
+	// --pack=<file> loads assets from another pack than data/assets.pack.
+	// --check-sources reads assets edited since the pack was built from their
+	// files (always on in debug builds; it stats every source file).
+	// --texture-decompress decompresses BC1 textures on the CPU even where the driver has S3TC.
+	std::string pack = assets::kDefaultPack;
+#ifdef NDEBUG
+	bool checkSources = false;
+#else
+	bool checkSources = true;
+#endif
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.compare(0, 12, "--audio-out=") == 0) audio::set_output_file(arg.substr(12));
+		if (arg == "--audio-adpcm") audio::set_compression(true);
+		if (arg == "--audio-reverb") audio::set_room({-10.0f, 0.0f, -10.0f}, {10.0f, 9.0f, 10.0f});
+		if (arg.compare(0, 7, "--pack=") == 0) pack = arg.substr(7);
+		if (arg == "--check-sources") checkSources = true;
+		if (arg == "--texture-decompress") textureDecompress = true;
+	}
+	// Without a pack, textures and sounds are read from their own files.
+	assets::open(pack, checkSources);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
 	glutInitWindowSize(width, hight);
 	glutCreateWindow("Graphical Simulation of Desktop & it's Components");
@@ -197,6 +436,7 @@ int main(int argc, char ** argv) {
 	setDeltaTime();
 	glutMainLoop();
 	audio::shutdown();
+	assets::close();
 	getchar();
 	return 0;
 }
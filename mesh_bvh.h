@@ -0,0 +1,191 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over a static triangle soup, for exact ray picks.
+//
+// Built once from world-space triangles (9 floats each). Nodes are stored
+// depth-first so a node's left child directly follows it; leaves hold up to
+// kLeafSize triangles. Moving parts are handled by translating the ray into
+// the mesh's capture space instead of refitting.
+class MeshBVH {
+public:
+    static const int kLeafSize = 4;
+    // Traversal stack entries. A depth-first walk holds at most depth + 1
+    // nodes, and median splits keep the depth under log2(count) + 1, so this
+    // covers any triangle count an int can hold; build() asserts it.
+    static const int kStackSize = 64;
+
+    struct Hit {
+        float t = 1e9f;
+        int triangle = -1;
+    };
+
+private:
+    struct Node {
+        float bmin[3];
+        float bmax[3];
+        // Leaf: first triangle and count. Inner: index of right child, count 0.
+        int offset;
+        int count;
+    };
+
+    std::vector<float> verts; // 9 floats per triangle, in BVH order
+    std::vector<Node> nodes;
+    int maxDepth = 0; // of any node; the root is 0
+
+    static float centroid(const float* tri, int axis) {
+        return (tri[axis] + tri[3 + axis] + tri[6 + axis]) * (1.0f / 3.0f);
+    }
+
+    void computeBounds(Node& node, const std::vector<int>& order, int first, int count) const {
+        for (int a = 0; a < 3; a++) {
+            node.bmin[a] = 1e30f;
+            node.bmax[a] = -1e30f;
+        }
+        for (int i = first; i < first + count; i++) {
+            const float* tri = &source[order[i] * 9];
+            for (int v = 0; v < 3; v++)
+                for (int a = 0; a < 3; a++) {
+                    node.bmin[a] = std::min(node.bmin[a], tri[v * 3 + a]);
+                    node.bmax[a] = std::max(node.bmax[a], tri[v * 3 + a]);
+                }
+        }
+    }
+
+    // Median split on the longest axis of the centroid bounds.
+    int buildNode(std::vector<int>& order, int first, int count, int depth) {
+        maxDepth = std::max(maxDepth, depth);
+        int index = (int)nodes.size();
+        nodes.push_back(Node());
+        computeBounds(nodes[index], order, first, count);
+
+        float cmin[3] = {1e30f, 1e30f, 1e30f}, cmax[3] = {-1e30f, -1e30f, -1e30f};
+        for (int i = first; i < first + count; i++)
+            for (int a = 0; a < 3; a++) {
+                float c = centroid(&source[order[i] * 9], a);
+                cmin[a] = std::min(cmin[a], c);
+                cmax[a] = std::max(cmax[a], c);
+            }
+        int axis = 0;
+        for (int a = 1; a < 3; a++)
+            if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis]) axis = a;
+
+        if (count <= kLeafSize || cmax[axis] - cmin[axis] <= 0.0f) {
+            nodes[index].offset = first;
+            nodes[index].count = count;
+            return index;
+        }
+
+        int mid = first + count / 2;
+        std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                         [&](int a, int b) {
+                             return centroid(&source[a * 9], axis) < centroid(&source[b * 9], axis);
+                         });
+        buildNode(order, first, mid - first, depth + 1);
+        int right = buildNode(order, mid, first + count - mid, depth + 1);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+        return index;
+    }
+
+    static bool hitBox(const Node& n, const float* o, const float* invD, float tMax) {
+        float t0 = 0.0f, t1 = tMax;
+        for (int a = 0; a < 3; a++) {
+            float tNear = (n.bmin[a] - o[a]) * invD[a];
+            float tFar = (n.bmax[a] - o[a]) * invD[a];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            t0 = std::max(t0, tNear);
+            t1 = std::min(t1, tFar);
+            if (t0 > t1) return false;
+        }
+        return true;
+    }
+
+    // Moller-Trumbore, double sided.
+    static bool hitTriangle(const float* tri, const float* o, const float* d, float& t) {
+        float e1[3] = {tri[3] - tri[0], tri[4] - tri[1], tri[5] - tri[2]};
+        float e2[3] = {tri[6] - tri[0], tri[7] - tri[1], tri[8] - tri[2]};
+        float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det > -1e-12f && det < 1e-12f) return false;
+        float inv = 1.0f / det;
+        float s[3] = {o[0] - tri[0], o[1] - tri[1], o[2] - tri[2]};
+        float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+        if (u < 0.0f || u > 1.0f) return false;
+        float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+        float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+        return t >= 0.0f;
+    }
+
+    std::vector<float> source; // only used while building
+
+public:
+    bool empty() const { return nodes.empty(); }
+    int triangleCount() const { return (int)verts.size() / 9; }
+    int nodeCount() const { return (int)nodes.size(); }
+    int depth() const { return maxDepth; }
+
+    // triangles: 9 floats (three xyz vertices) per triangle.
+    void build(const std::vector<float>& triangles) {
+        nodes.clear();
+        verts.clear();
+        maxDepth = 0;
+        int count = (int)triangles.size() / 9;
+        if (count == 0) return;
+
+        source = triangles;
+        std::vector<int> order(count);
+        for (int i = 0; i < count; i++) order[i] = i;
+        nodes.reserve(2 * count / kLeafSize + 1);
+        buildNode(order, 0, count, 0);
+        assert(maxDepth < kStackSize && "BVH deeper than the traversal stack");
+
+        verts.resize(count * 9);
+        for (int i = 0; i < count; i++)
+            std::copy(&source[order[i] * 9], &source[order[i] * 9] + 9, &verts[i * 9]);
+        std::vector<float>().swap(source);
+    }
+
+    // Nearest triangle hit by the ray (dir need not be normalized; t is in
+    // units of dir). Only hits closer than maxT are reported.
+    Hit intersect(const float* origin, const float* dir, float maxT = 1e9f) const {
+        Hit hit;
+        hit.t = maxT;
+        if (nodes.empty()) return hit;
+
+        float invD[3];
+        for (int a = 0; a < 3; a++) invD[a] = 1.0f / (dir[a] != 0.0f ? dir[a] : 1e-20f);
+
+        int stack[kStackSize];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            int index = stack[--top];
+            const Node& n = nodes[index];
+            if (!hitBox(n, origin, invD, hit.t)) continue;
+            if (n.count > 0) {
+                for (int i = n.offset; i < n.offset + n.count; i++) {
+                    float t;
+                    if (hitTriangle(&verts[i * 9], origin, dir, t) && t < hit.t) {
+                        hit.t = t;
+                        hit.triangle = i;
+                    }
+                }
+            } else {
+                // At most maxDepth + 1 entries are ever pending (see kStackSize).
+                stack[top++] = n.offset;  // right
+                stack[top++] = index + 1; // left, visited first
+            }
+        }
+        return hit;
+    }
+};
+
+#endif
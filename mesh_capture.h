@@ -0,0 +1,109 @@
+#ifndef MESH_CAPTURE_H
+#define MESH_CAPTURE_H
+
+#include <GL/glut.h>
+#include <vector>
+
+// Records the triangles an immediate-mode draw function emits, in the
+// coordinates of the current modelview at the call site (world space when
+// the draw function is called with an identity modelview, as the cpu_*
+// render() functions expect).
+//
+// Uses GL_FEEDBACK: the draw runs with an orthographic projection covering
+// +/-kCaptureExtent, and the transformed window coordinates are mapped back.
+// Polygons are fan-triangulated; points, lines and bitmaps are dropped.
+// Call once at init with a current GL context, never per frame.
+namespace mesh_capture {
+
+const float kCaptureExtent = 32.0f;
+
+inline std::vector<float> capture(void (*draw)()) {
+    std::vector<float> triangles;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0) return triangles;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_TRANSFORM_BIT);
+    glDisable(GL_CULL_FACE);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(-kCaptureExtent, kCaptureExtent, -kCaptureExtent, kCaptureExtent, -kCaptureExtent, kCaptureExtent);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // Grow the buffer until the whole draw fits.
+    std::vector<GLfloat> buffer(1 << 16);
+    GLint used = -1;
+    for (int attempt = 0; attempt < 8 && used < 0; attempt++) {
+        glFeedbackBuffer((GLsizei)buffer.size(), GL_3D, buffer.data());
+        glRenderMode(GL_FEEDBACK);
+        draw();
+        used = glRenderMode(GL_RENDER);
+        if (used < 0) buffer.resize(buffer.size() * 2);
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+
+    if (used < 0) return triangles;
+
+    // Window coordinates back to capture space (glOrtho with a symmetric box:
+    // ndc = x / extent, and z_ndc = -z / extent).
+    auto unproject = [&](const GLfloat* v, float* out) {
+        out[0] = (2.0f * (v[0] - viewport[0]) / viewport[2] - 1.0f) * kCaptureExtent;
+        out[1] = (2.0f * (v[1] - viewport[1]) / viewport[3] - 1.0f) * kCaptureExtent;
+        out[2] = -(2.0f * v[2] - 1.0f) * kCaptureExtent;
+    };
+
+    int i = 0;
+    while (i < used) {
+        GLint token = (GLint)buffer[i++];
+        switch (token) {
+        case GL_POLYGON_TOKEN: {
+            int n = (int)buffer[i++];
+            float first[3], prev[3], cur[3];
+            for (int k = 0; k < n; k++) {
+                unproject(&buffer[i + k * 3], cur);
+                if (k == 0) {
+                    for (int a = 0; a < 3; a++) first[a] = cur[a];
+                } else if (k >= 2) {
+                    triangles.insert(triangles.end(), first, first + 3);
+                    triangles.insert(triangles.end(), prev, prev + 3);
+                    triangles.insert(triangles.end(), cur, cur + 3);
+                }
+                for (int a = 0; a < 3; a++) prev[a] = cur[a];
+            }
+            i += n * 3;
+            break;
+        }
+        case GL_LINE_TOKEN:
+        case GL_LINE_RESET_TOKEN:
+            i += 6;
+            break;
+        case GL_POINT_TOKEN:
+        case GL_BITMAP_TOKEN:
+        case GL_DRAW_PIXEL_TOKEN:
+        case GL_COPY_PIXEL_TOKEN:
+            i += 3;
+            break;
+        case GL_PASS_THROUGH_TOKEN:
+            i += 1;
+            break;
+        default:
+            // Unknown token: the rest of the buffer cannot be parsed.
+            i = used;
+            break;
+        }
+    }
+    return triangles;
+}
+
+} // namespace mesh_capture
+
+#endif
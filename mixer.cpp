@@ -0,0 +1,398 @@
+#include "mixer.h"
+#include "adpcm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SSE2 1
+#endif
+
+namespace mixer {
+
+namespace {
+
+const float kSampleScale = 1.0f / 32768.0f;
+const float kFracScale = 1.0f / 4294967296.0f;
+const std::uint64_t kOne = 1ull << 32;
+
+void convert(const std::int16_t* src, float* dst, int count) {
+	int i = 0;
+#ifdef MIXER_SSE2
+	const __m128 scale = _mm_set1_ps(kSampleScale);
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		// Duplicate each sample into a 32-bit lane, then shift back down to sign-extend.
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+#endif
+	for (; i < count; i++) dst[i] = src[i] * kSampleScale;
+}
+
+// Linear interpolation of n frames starting at cursor. Every tap read
+// (frame index + 1 included) must lie inside the clip.
+void interpolate(const std::int16_t* src, int channels, std::uint64_t cursor, std::uint64_t step, float* dst, int n) {
+	int k = 0;
+#ifdef MIXER_SSE2
+	// Both taps of a frame are adjacent, so each frame is one unaligned load
+	// (32 bits mono, 64 bits stereo); the halves are split and sign-extended
+	// with shifts. Fractions keep the top 23 bits so they convert exactly.
+	const __m128 scale = _mm_set1_ps(kSampleScale);
+	const __m128 fracScale = _mm_set1_ps(1.0f / 8388608.0f);
+	if (channels == 1) {
+		for (; k + 4 <= n; k += 4) {
+			alignas(16) std::int32_t taps[4], frac[4];
+			for (int l = 0; l < 4; l++) {
+				std::memcpy(&taps[l], src + (cursor >> 32), 4);
+				frac[l] = (std::int32_t)((std::uint32_t)cursor >> 9);
+				cursor += step;
+			}
+			__m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(taps));
+			__m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16));
+			__m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(v, 16));
+			__m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(frac))), fracScale);
+			_mm_storeu_ps(dst + k, _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f)), scale));
+		}
+	} else {
+		for (; k + 2 <= n; k += 2) {
+			__m128i p0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 2 * (cursor >> 32)));
+			float f0 = (float)((std::uint32_t)cursor >> 9);
+			cursor += step;
+			__m128i p1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 2 * (cursor >> 32)));
+			float f1 = (float)((std::uint32_t)cursor >> 9);
+			cursor += step;
+			// int16 lanes: L0 R0 L1 R1 (first taps) | L0' R0' L1' R1' (second taps)
+			__m128i v = _mm_unpacklo_epi32(p0, p1);
+			__m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+			__m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+			__m128 f = _mm_mul_ps(_mm_setr_ps(f0, f0, f1, f1), fracScale);
+			_mm_storeu_ps(dst + 2 * k, _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), f)), scale));
+		}
+	}
+#endif
+	for (; k < n; k++) {
+		int tap = (int)(cursor >> 32) * channels;
+		float frac = (float)(std::uint32_t)cursor * kFracScale;
+		for (int c = 0; c < channels; c++) {
+			float a = src[tap + c];
+			dst[k * channels + c] = (a + (src[tap + channels + c] - a) * frac) * kSampleScale;
+		}
+		cursor += step;
+	}
+}
+
+float length(const float* v) {
+	return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+void put_u32(std::FILE* f, std::uint32_t v) {
+	unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+	std::fwrite(b, 1, 4, f);
+}
+
+void put_u16(std::FILE* f, std::uint16_t v) {
+	unsigned char b[2] = {(unsigned char)v, (unsigned char)(v >> 8)};
+	std::fwrite(b, 1, 2, f);
+}
+
+} // namespace
+
+float distance_gain(float distance, float refDistance, float maxDistance, float rolloff) {
+	if (distance < refDistance) distance = refDistance;
+	if (distance > maxDistance) distance = maxDistance;
+	return refDistance / (refDistance + rolloff * (distance - refDistance));
+}
+
+Mixer::Mixer(int sampleRate, int voiceCount)
+	: rate(sampleRate), voices(voiceCount), scratch(kMaxChunk * 2),
+	  windows((size_t)voiceCount * (adpcm::kBlockFrames + 1) * 2) {}
+
+int Mixer::active() const {
+	int n = 0;
+	for (const Voice& voice : voices)
+		if (voice.clip) n++;
+	return n;
+}
+
+void Mixer::set_distance_model(float ref, float max, float roll) {
+	refDistance = ref;
+	maxDistance = max;
+	rolloff = roll;
+}
+
+void Mixer::set_listener(const float* position, const float* forward, const float* up) {
+	for (int i = 0; i < 3; i++) listener[i] = position[i];
+	float r[3] = {forward[1] * up[2] - forward[2] * up[1], forward[2] * up[0] - forward[0] * up[2],
+		forward[0] * up[1] - forward[1] * up[0]};
+	float len = length(r);
+	if (len <= 1e-6f) return;
+	for (int i = 0; i < 3; i++) rightAxis[i] = r[i] / len;
+}
+
+int Mixer::play(const Clip* clip, double startFrame, bool loop) {
+	if (!clip || clip->frames() == 0 || (clip->channels != 1 && clip->channels != 2)) return -1;
+	for (int v = 0; v < (int)voices.size(); v++) {
+		Voice& voice = voices[v];
+		if (voice.clip) continue;
+		voice = Voice();
+		voice.clip = clip;
+		voice.loop = loop;
+		if (startFrame < 0.0 || startFrame >= clip->frames()) startFrame = 0.0;
+		voice.cursor = (std::uint64_t)(startFrame * (double)kOne);
+		voice.step = ((std::uint64_t)clip->sampleRate << 32) / (std::uint64_t)rate;
+		return v;
+	}
+	return -1;
+}
+
+void Mixer::stop(int voice) {
+	voices[voice].clip = nullptr;
+}
+
+bool Mixer::playing(int voice) const {
+	return voices[voice].clip != nullptr;
+}
+
+double Mixer::time(int voice) const {
+	const Voice& v = voices[voice];
+	if (!v.clip) return 0.0;
+	return (double)v.cursor / (double)kOne / v.clip->sampleRate;
+}
+
+void Mixer::set_gain(int voice, float gain) {
+	voices[voice].gain = gain;
+}
+
+void Mixer::set_position(int voice, const float* position, bool relative) {
+	Voice& v = voices[voice];
+	v.relative = relative;
+	for (int i = 0; i < 3; i++) v.position[i] = position[i];
+}
+
+void Mixer::target_gains(const Voice& voice, float& left, float& right) const {
+	if (voice.clip->channels == 2) {
+		left = right = voice.gain;
+		return;
+	}
+	float gain = voice.gain;
+	float pan = 0.0f; // -1 = left, 1 = right
+	if (!voice.relative) {
+		float d[3] = {voice.position[0] - listener[0], voice.position[1] - listener[1], voice.position[2] - listener[2]};
+		float dist = length(d);
+		gain *= distance_gain(dist, refDistance, maxDistance, rolloff);
+		if (dist > 1e-4f) pan = (d[0] * rightAxis[0] + d[1] * rightAxis[1] + d[2] * rightAxis[2]) / dist;
+	}
+	// Equal-power pan: the total power is the same in every direction.
+	float angle = (pan + 1.0f) * 0.78539816f;
+	left = gain * std::cos(angle);
+	right = gain * std::sin(angle);
+}
+
+// Decode a block of the voice's compressed clip into its window, followed
+// by the first frame of the next block so that every frame of the block
+// has both interpolation taps.
+const std::int16_t* Mixer::decode_window(Voice& voice, int block) {
+	const Clip& clip = *voice.clip;
+	const int channels = clip.channels;
+	std::int16_t* window = &windows[(size_t)(&voice - voices.data()) * (adpcm::kBlockFrames + 1) * 2];
+	if (voice.block == block) return window;
+
+	const size_t bytes = adpcm::block_bytes(channels);
+	const std::uint8_t* data = clip.adpcm.data() + (size_t)block * bytes;
+	int first = block * adpcm::kBlockFrames;
+	int n = std::min(adpcm::kBlockFrames, clip.adpcmFrames - first);
+	adpcm::decode_block(data, channels, n, window);
+	if (first + n < clip.adpcmFrames) {
+		for (int c = 0; c < channels; c++) window[n * channels + c] = adpcm::first_sample(data + bytes, c);
+	}
+	voice.block = block;
+	return window;
+}
+
+// Resample up to `frames` frames of the voice's clip into dst (in the clip's
+// channel layout). Returns fewer than asked when a one-shot runs out.
+int Mixer::resample(Voice& voice, float* dst, int frames) {
+	const Clip& clip = *voice.clip;
+	const int channels = clip.channels;
+	const std::uint64_t end = (std::uint64_t)clip.frames() << 32;
+	// Cursors below this have both interpolation taps inside the clip.
+	const std::uint64_t lastFrame = end - kOne;
+
+	int produced = 0;
+	while (produced < frames) {
+		if (voice.cursor >= end) {
+			if (!voice.loop) break;
+			voice.cursor %= end;
+			continue;
+		}
+		// Taps come from src, which starts at clip frame `base`: the whole
+		// clip, or the decoded block of a compressed one. Cursors below
+		// limit have both taps inside src.
+		const std::int16_t* src = clip.samples.data();
+		std::uint64_t base = 0;
+		std::uint64_t limit = lastFrame;
+		if (clip.compressed()) {
+			int block = (int)(voice.cursor >> 32) / adpcm::kBlockFrames;
+			src = decode_window(voice, block);
+			base = (std::uint64_t)block * adpcm::kBlockFrames << 32;
+			limit = std::min(lastFrame, base + ((std::uint64_t)adpcm::kBlockFrames << 32));
+		}
+		const std::uint64_t cursor = voice.cursor - base;
+		const int index = (int)(cursor >> 32);
+		float* out = dst + produced * channels;
+		if (voice.cursor < limit) {
+			std::uint64_t span = (limit - voice.cursor + voice.step - 1) / voice.step;
+			int n = frames - produced;
+			if (span < (std::uint64_t)n) n = (int)span;
+			if (voice.step == kOne && (cursor & 0xFFFFFFFFu) == 0)
+				convert(src + index * channels, out, n * channels);
+			else
+				interpolate(src, channels, cursor, voice.step, out, n);
+			voice.cursor += (std::uint64_t)n * voice.step;
+			produced += n;
+		} else {
+			// The last frame interpolates towards the start of a loop, or silence.
+			float frac = (float)(std::uint32_t)cursor * kFracScale;
+			for (int c = 0; c < channels; c++) {
+				float a = src[index * channels + c];
+				float b = 0.0f;
+				if (voice.loop) b = clip.compressed() ? adpcm::first_sample(clip.adpcm.data(), c) : clip.samples[c];
+				out[c] = (a + (b - a) * frac) * kSampleScale;
+			}
+			voice.cursor += voice.step;
+			produced++;
+		}
+	}
+	return produced;
+}
+
+// out[frame] += src[frame] * gain, with the gains stepping by dLeft/dRight
+// per frame. Mono sources feed both output channels.
+void Mixer::accumulate(const float* src, int channels, float* out, int frames, float left, float right, float dLeft,
+	float dRight) {
+	int k = 0;
+#ifdef MIXER_SSE2
+	__m128 g = _mm_setr_ps(left, right, left + dLeft, right + dRight);
+	const __m128 dg = _mm_setr_ps(2.0f * dLeft, 2.0f * dRight, 2.0f * dLeft, 2.0f * dRight);
+	if (channels == 1) {
+		for (; k + 4 <= frames; k += 4) {
+			__m128 m = _mm_loadu_ps(src + k);
+			float* o = out + 2 * k;
+			_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(_mm_unpacklo_ps(m, m), g)));
+			g = _mm_add_ps(g, dg);
+			_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(_mm_unpackhi_ps(m, m), g)));
+			g = _mm_add_ps(g, dg);
+		}
+	} else {
+		for (; k + 2 <= frames; k += 2) {
+			float* o = out + 2 * k;
+			_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(_mm_loadu_ps(src + 2 * k), g)));
+			g = _mm_add_ps(g, dg);
+		}
+	}
+#endif
+	for (; k < frames; k++) {
+		float gl = left + dLeft * k;
+		float gr = right + dRight * k;
+		float l = channels == 1 ? src[k] : src[2 * k];
+		float r = channels == 1 ? src[k] : src[2 * k + 1];
+		out[2 * k] += l * gl;
+		out[2 * k + 1] += r * gr;
+	}
+}
+
+void Mixer::mix(float* out, int frames) {
+	std::fill(out, out + 2 * frames, 0.0f);
+	if (frames <= 0) return;
+	for (Voice& voice : voices) {
+		if (!voice.clip) continue;
+		float left, right;
+		target_gains(voice, left, right);
+		if (voice.fresh) {
+			voice.left = left;
+			voice.right = right;
+			voice.fresh = false;
+		}
+		float dLeft = (left - voice.left) / frames;
+		float dRight = (right - voice.right) / frames;
+		int channels = voice.clip->channels;
+
+		int done = 0;
+		while (done < frames) {
+			int n = std::min(kMaxChunk, frames - done);
+			int got = resample(voice, scratch.data(), n);
+			accumulate(scratch.data(), channels, out + 2 * done, got, voice.left + dLeft * done,
+				voice.right + dRight * done, dLeft, dRight);
+			done += n;
+			if (got < n) {
+				voice.clip = nullptr; // one-shot finished
+				break;
+			}
+		}
+		voice.left = left;
+		voice.right = right;
+	}
+}
+
+bool WavWriter::open(const std::string& path, int sampleRate) {
+	close();
+	written = 0;
+	file = std::fopen(path.c_str(), "wb");
+	if (!file) return false;
+	// Sizes are patched by close().
+	std::fwrite("RIFF", 1, 4, file);
+	put_u32(file, 0);
+	std::fwrite("WAVEfmt ", 1, 8, file);
+	put_u32(file, 16);
+	put_u16(file, 1); // PCM
+	put_u16(file, 2);
+	put_u32(file, (std::uint32_t)sampleRate);
+	put_u32(file, (std::uint32_t)sampleRate * 4);
+	put_u16(file, 4);
+	put_u16(file, 16);
+	std::fwrite("data", 1, 4, file);
+	put_u32(file, 0);
+	return true;
+}
+
+void WavWriter::write(const float* stereo, int frames) {
+	written += frames;
+	if (!file || frames <= 0) return;
+	int count = frames * 2;
+	pcm.resize(count);
+	int i = 0;
+#ifdef MIXER_SSE2
+	// cvtps rounds, packs saturates to int16.
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(stereo + i), scale));
+		__m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(stereo + i + 4), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&pcm[i]), _mm_packs_epi32(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		float v = stereo[i] * 32767.0f;
+		v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+		pcm[i] = (std::int16_t)std::lround(v);
+	}
+	// WAV data is little-endian, like every platform this builds for.
+	std::fwrite(pcm.data(), sizeof(std::int16_t), count, file);
+}
+
+void WavWriter::close() {
+	if (!file) return;
+	std::uint32_t dataBytes = (std::uint32_t)(written * 4);
+	std::fseek(file, 4, SEEK_SET);
+	put_u32(file, 36 + dataBytes);
+	std::fseek(file, 40, SEEK_SET);
+	put_u32(file, dataBytes);
+	std::fclose(file);
+	file = nullptr;
+}
+
+} // namespace mixer
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Software mixer: the audio backend when the project is built without
+// OpenAL, and the thing bench_mixer measures.
+namespace mixer {
+
+// 16-bit PCM, mono or interleaved stereo.
+struct Clip {
+	std::vector<std::int16_t> samples;
+	// When not empty, the clip is held as IMA-ADPCM blocks (adpcm.h) of
+	// adpcmFrames frames instead of samples, and decoded as it plays.
+	std::vector<std::uint8_t> adpcm;
+	int adpcmFrames = 0;
+	int channels = 1;
+	int sampleRate = 48000;
+
+	bool compressed() const { return !adpcm.empty(); }
+	int frames() const {
+		if (compressed()) return adpcmFrames;
+		return channels ? (int)(samples.size() / channels) : 0;
+	}
+};
+
+// Attenuation of OpenAL's AL_INVERSE_DISTANCE_CLAMPED model.
+float distance_gain(float distance, float refDistance, float maxDistance, float rolloff);
+
+// A fixed number of voices mixed into interleaved stereo float.
+//
+// Each voice reads its clip through a 32.32 fixed-point cursor with linear
+// interpolation, so clips at any sample rate play at the output rate. Mono
+// clips that are not listener-relative are attenuated with distance_gain()
+// and panned with an equal-power law on the listener's right axis; stereo
+// clips are only scaled by their gain, as OpenAL does. Gain changes are
+// ramped across one mix() call so moving sources do not click. The
+// resampling and accumulation loops use SSE2 where available. A voice
+// playing a compressed clip decodes one block at a time into its own
+// window and resamples from there.
+class Mixer {
+public:
+	static const int kMaxChunk = 256; // frames resampled per step
+
+	Mixer(int sampleRate, int voices);
+
+	int sample_rate() const { return rate; }
+	int voice_count() const { return (int)voices.size(); }
+	int active() const;
+
+	void set_distance_model(float refDistance, float maxDistance, float rolloff);
+	void set_listener(const float* position, const float* forward, const float* up);
+
+	// Start a clip at frame startFrame; returns the voice or -1 if all are busy.
+	int play(const Clip* clip, double startFrame, bool loop);
+	void stop(int voice);
+	bool playing(int voice) const;
+	// Playback position, in seconds into the clip.
+	double time(int voice) const;
+
+	void set_gain(int voice, float gain);
+	// relative: the position is ignored and the voice plays unpanned.
+	void set_position(int voice, const float* position, bool relative);
+
+	// Overwrite out with `frames` stereo frames.
+	void mix(float* out, int frames);
+
+private:
+	struct Voice {
+		const Clip* clip = nullptr;
+		bool loop = false;
+		bool relative = true;
+		float gain = 1.0f;
+		float position[3] = {0.0f, 0.0f, 0.0f};
+		std::uint64_t cursor = 0; // clip frame, 32.32 fixed point
+		std::uint64_t step = 0;
+		float left = 0.0f, right = 0.0f; // gains applied at the end of the last mix
+		bool fresh = true;               // no ramp on the first block
+		int block = -1;                  // ADPCM block held in the voice's window
+	};
+
+	void target_gains(const Voice& voice, float& left, float& right) const;
+	int resample(Voice& voice, float* dst, int frames);
+	const std::int16_t* decode_window(Voice& voice, int block);
+	void accumulate(const float* src, int channels, float* out, int frames, float left, float right, float dLeft, float dRight);
+
+	int rate;
+	std::vector<Voice> voices;
+	std::vector<float> scratch;
+	std::vector<std::int16_t> windows; // per voice, one decoded ADPCM block and the next frame
+	float listener[3] = {0.0f, 0.0f, 0.0f};
+	float rightAxis[3] = {1.0f, 0.0f, 0.0f};
+	float refDistance = 2.0f;
+	float maxDistance = 50.0f;
+	float rolloff = 1.0f;
+};
+
+// Where mixed audio goes: a 16-bit stereo WAV file, or nowhere (a null
+// sink) if open() was not called or failed. Either way the frames written
+// are counted.
+class WavWriter {
+public:
+	WavWriter() {}
+	WavWriter(const WavWriter&) = delete;
+	WavWriter& operator=(const WavWriter&) = delete;
+	~WavWriter() { close(); }
+
+	bool open(const std::string& path, int sampleRate);
+	void write(const float* stereo, int frames);
+	// Patch the RIFF sizes and close the file.
+	void close();
+
+	bool is_file() const { return file != nullptr; }
+	long long frames() const { return written; }
+
+private:
+	std::FILE* file = nullptr;
+	long long written = 0;
+	std::vector<std::int16_t> pcm;
+};
+
+} // namespace mixer
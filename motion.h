@@ -4,6 +4,9 @@
 #include "parameter.h"
 #include "objects.h"
 #include "audio.h"
+#include "flight.h"
+#include "profiler.h"
+#include "text.h"
 
 
 int prev_x = 0, prev_y = 0;
@@ -15,6 +18,7 @@ void processSpecialKeys(int key, int xx, int yy)
 	float fraction = 0.001f;
 	float fraction_rotate = 0.001f;
 	static int lastStepMs = 0;
+	flight::input_event(flight::Input::SpecialKey, key, xx, yy);
 	
 	if (!motion_present)
 		return;
@@ -76,6 +80,7 @@ void processSpecialKeys(int key, int xx, int yy)
 
 void processNormalKeys(unsigned char key, int x, int y)
 {
+	flight::input_event(flight::Input::Key, key, x, y);
 	static int lastActionMs = 0;
 	auto allowAction = [&]() {
 		int now = glutGet(GLUT_ELAPSED_TIME);
@@ -113,6 +118,9 @@ void processNormalKeys(unsigned char key, int x, int y)
 
 	case 'n':
 	case 'N':choice = 'n'; break;
+
+	case 'p':
+	case 'P':profiler::capture_frames(120, "profile_trace.json"); break;
 	case 27:escape_pressed = true;
 			audio::play_ui("data/sfx/ui_click.wav", 0.5f);
 			if (!motion_present && choice == 'y') {
@@ -130,6 +138,7 @@ extern int mouseGlobalX;
 extern int mouseGlobalY;
 
 void mouse_follow(int new_x, int new_y) {
+    flight::input_event(flight::Input::Mouse, 0, new_x, new_y);
     // Always track mouse position for tooltips
     mouseGlobalX = new_x;
     mouseGlobalY = new_y;
@@ -176,10 +185,7 @@ void mouse_follow(int new_x, int new_y) {
 }
 
 void printMsg(char * message,GLfloat mX, GLfloat mY, GLfloat mZ) {
-	glRasterPos3f(mX, mY, mZ);
-	for (char* c = message; *c != '\0'; c++) {
-		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
-	}
+	text::draw_world(text::Font::Helvetica18, message, mX, mY, mZ, {1.0f, 1.0f, 1.0f, 1.0f});
 }
 
 void cpuView() {
@@ -3,7 +3,6 @@
 
 #include <GL/glut.h>
 #include <GL/freeglut.h> 
-#include "bmpLoader.h"
 
 #include "cpu_fan.h"
 #include "cpu_motherboard.h"
@@ -107,6 +106,11 @@ void drawGround() {
 	glDisable(GL_TEXTURE_2D);
 }
 
+void drawRoomObjects() {
+	env_.render();
+	envTable_.render();
+}
+
 void drawCPU() {
 	fan_.render();	//Renders Fan
 	motherboard_.render();
@@ -117,11 +121,13 @@ void drawCPU() {
 	gpu_.render();
 	psu_.render();
 	harddisk_.render();
-	env_.render();
-	envTable_.render();
 	sata_.render();
+}
+
+// Case last: its side panel is the blended glass pass.
+void drawCase() {
 	case_.render();
-	
+
     // Legacy Banner Removed
 	// if (enterPressed) {
 	// 	drawComponentInfo(objIndex);
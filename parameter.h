@@ -3,6 +3,7 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <GL/glut.h>
+#include "glcount.h"
 
 class point3D {
 public:	double x, y, z;
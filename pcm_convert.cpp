@@ -0,0 +1,217 @@
+#include "pcm_convert.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PCM_AVX2 1
+#define PCM_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PCM_SSE2 1
+#endif
+
+namespace pcm {
+
+void from_u8(const std::uint8_t* in, std::int16_t* out, size_t count) {
+	size_t i = 0;
+#if defined(PCM_AVX2)
+	const __m256i bias = _mm256_set1_epi16(128);
+	for (; i + 16 <= count; i += 16) {
+		__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_slli_epi16(_mm256_sub_epi16(v, bias), 8));
+	}
+#elif defined(PCM_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		__m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+		__m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_slli_epi16(lo, 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_slli_epi16(hi, 8));
+	}
+#endif
+	for (; i < count; i++) out[i] = (std::int16_t)((in[i] - 128) * 256);
+}
+
+void from_s24(const std::uint8_t* in, std::int16_t* out, size_t count) {
+	size_t i = 0;
+#if defined(PCM_AVX2)
+	// The top two bytes of each 3-byte sample, four samples per shuffle.
+	const __m128i pick = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+	// Each 16-byte load uses 12 bytes; stop while the second load is in bounds.
+	for (; i + 10 <= count; i += 8) {
+		const std::uint8_t* p = in + 3 * i;
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), pick);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), pick);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi64(a, b));
+	}
+#elif defined(PCM_SSE2)
+	// No byte shuffle: shift each sample's top two bytes down to word 0 and
+	// gather the words with unpacks, four samples per 12 bytes.
+	for (; i + 10 <= count; i += 8) {
+		const std::uint8_t* p = in + 3 * i;
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12));
+		__m128i a = _mm_unpacklo_epi32(_mm_unpacklo_epi16(_mm_srli_si128(v, 1), _mm_srli_si128(v, 4)),
+			_mm_unpacklo_epi16(_mm_srli_si128(v, 7), _mm_srli_si128(v, 10)));
+		__m128i b = _mm_unpacklo_epi32(_mm_unpacklo_epi16(_mm_srli_si128(w, 1), _mm_srli_si128(w, 4)),
+			_mm_unpacklo_epi16(_mm_srli_si128(w, 7), _mm_srli_si128(w, 10)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi64(a, b));
+	}
+#endif
+	for (; i < count; i++) out[i] = (std::int16_t)(in[3 * i + 1] | (in[3 * i + 2] << 8));
+}
+
+void from_s32(const std::uint8_t* in, std::int16_t* out, size_t count) {
+	size_t i = 0;
+#if defined(PCM_AVX2)
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i)), 16);
+		__m256i b = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * i + 32)), 16);
+		// packs works per 128-bit lane; restore the sample order.
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+	}
+#elif defined(PCM_SSE2)
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i)), 16);
+		__m128i b = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * i + 16)), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+	}
+#endif
+	for (; i < count; i++) {
+		std::int32_t v;
+		std::memcpy(&v, in + 4 * i, 4);
+		out[i] = (std::int16_t)(v >> 16);
+	}
+}
+
+void from_f32(const std::uint8_t* in, std::int16_t* out, size_t count) {
+	size_t i = 0;
+	// cvtps rounds to nearest-even (the default MXCSR mode), as does
+	// nearbyint in the scalar tail.
+#if defined(PCM_AVX2)
+	const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(32767.0f);
+	for (; i + 16 <= count; i += 16) {
+		__m256 fa = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+		__m256 fb = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 4 * i + 32));
+		__m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(fa, lo), hi), scale));
+		__m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(fb, lo), hi), scale));
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+	}
+#elif defined(PCM_SSE2)
+	const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+	for (; i + 8 <= count; i += 8) {
+		__m128 fa = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+		__m128 fb = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i + 16));
+		__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(fa, lo), hi), scale));
+		__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(fb, lo), hi), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+	}
+#endif
+	for (; i < count; i++) {
+		float f;
+		std::memcpy(&f, in + 4 * i, 4);
+		// Written so that NaN clamps to -1, as maxps does (it returns its
+		// second operand when either is NaN).
+		f = f > -1.0f ? f : -1.0f;
+		f = f < 1.0f ? f : 1.0f;
+		out[i] = (std::int16_t)std::nearbyint(f * 32767.0f);
+	}
+}
+
+void resample(const std::int16_t* in, size_t frames, int channels, int fromRate, int toRate,
+	std::vector<std::int16_t>& out) {
+	if (frames == 0 || fromRate <= 0 || toRate <= 0) {
+		out.clear();
+		return;
+	}
+	size_t outFrames = (size_t)((std::uint64_t)frames * (std::uint64_t)toRate / (std::uint64_t)fromRate);
+	if (outFrames == 0) outFrames = 1;
+	out.resize(outFrames * channels);
+
+	// 32.32 fixed-point position in the input.
+	const std::uint64_t step = ((std::uint64_t)fromRate << 32) / (std::uint64_t)toRate;
+	std::uint64_t cursor = 0;
+	for (size_t k = 0; k < outFrames; k++, cursor += step) {
+		size_t i = (size_t)(cursor >> 32);
+		size_t j = i + 1 < frames ? i + 1 : frames - 1;
+		float frac = (float)(std::uint32_t)cursor * (1.0f / 4294967296.0f);
+		for (int c = 0; c < channels; c++) {
+			float a = in[i * channels + c];
+			float b = in[j * channels + c];
+			out[k * channels + c] = (std::int16_t)std::lrint(a + (b - a) * frac);
+		}
+	}
+}
+
+static std::uint32_t u32_at(const std::uint8_t* p) {
+	return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) | ((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24);
+}
+
+static std::uint16_t u16_at(const std::uint8_t* p) {
+	return (std::uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool parse_wav(const std::uint8_t* file, size_t size, WavInfo& info) {
+	if (size < 12 || std::memcmp(file, "RIFF", 4) != 0 || std::memcmp(file + 8, "WAVE", 4) != 0) return false;
+
+	bool haveFmt = false;
+	bool haveData = false;
+	size_t pos = 12;
+	while (pos + 8 <= size && !(haveFmt && haveData)) {
+		const std::uint8_t* chunk = file + pos;
+		std::uint32_t chunkSize = u32_at(chunk + 4);
+		pos += 8;
+		if (std::memcmp(chunk, "fmt ", 4) == 0) {
+			if (chunkSize < 16 || size - pos < 16) return false;
+			info.audioFormat = u16_at(file + pos);
+			info.channels = u16_at(file + pos + 2);
+			info.sampleRate = (int)u32_at(file + pos + 4);
+			info.bitsPerSample = u16_at(file + pos + 14);
+			haveFmt = true;
+		} else if (std::memcmp(chunk, "data", 4) == 0) {
+			info.dataOffset = (std::uint32_t)pos;
+			info.dataSize = chunkSize;
+			haveData = true;
+		}
+		// Chunks are word-aligned
+		pos += (size_t)chunkSize + (chunkSize & 1);
+	}
+
+	if (!haveFmt || !haveData) return false;
+	if (info.dataOffset > size || info.dataSize > size - info.dataOffset) return false;
+	if (!((info.channels == 1) || (info.channels == 2))) return false;
+	if (!((info.audioFormat == 1) || (info.audioFormat == 3))) return false; // 1=PCM, 3=IEEE float
+	if (!((info.bitsPerSample == 8) || (info.bitsPerSample == 16) || (info.bitsPerSample == 24) || (info.bitsPerSample == 32))) return false;
+	if (info.audioFormat == 3 && info.bitsPerSample != 32) return false;
+	return info.sampleRate > 0;
+}
+
+void to_s16(const std::uint8_t* raw, size_t size, const WavInfo& info, std::int16_t* out) {
+	size_t count = size / (info.bitsPerSample / 8);
+	if (info.audioFormat == 3) from_f32(raw, out, count);
+	else if (info.bitsPerSample == 8) from_u8(raw, out, count);
+	else if (info.bitsPerSample == 16) std::memcpy(out, raw, count * 2);
+	else if (info.bitsPerSample == 24) from_s24(raw, out, count);
+	else from_s32(raw, out, count);
+}
+
+bool convert_wav(const std::uint8_t* file, size_t size, int rate, WavInfo& info, std::vector<std::int16_t>& samples) {
+	if (!parse_wav(file, size, info)) return false;
+	size_t frames = info.dataSize / block_align(info);
+	samples.resize(frames * info.channels);
+	to_s16(file + info.dataOffset, frames * block_align(info), info, samples.data());
+	if (info.sampleRate != rate) {
+		std::vector<std::int16_t> resampled;
+		resample(samples.data(), frames, info.channels, info.sampleRate, rate, resampled);
+		samples.swap(resampled);
+	}
+	return true;
+}
+
+} // namespace pcm
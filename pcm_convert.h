@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sample format conversion for sound loading. Every format a WAV file may
+// hold becomes signed 16-bit, which both audio backends play directly.
+//
+// The kernels write `count` samples into a buffer the caller has sized;
+// input is raw little-endian file data with no alignment requirement. They
+// use AVX2 when compiled for it, SSE2 otherwise (scalar code elsewhere),
+// and every path gives the same result: 24/32-bit PCM keeps its top 16
+// bits, float is clamped to [-1, 1] and rounded to nearest-even.
+namespace pcm {
+
+void from_u8(const std::uint8_t* in, std::int16_t* out, size_t count);
+void from_s24(const std::uint8_t* in, std::int16_t* out, size_t count);
+void from_s32(const std::uint8_t* in, std::int16_t* out, size_t count);
+void from_f32(const std::uint8_t* in, std::int16_t* out, size_t count);
+
+// Linear-interpolation rate conversion of interleaved 16-bit frames;
+// out is resized to the converted length.
+void resample(const std::int16_t* in, size_t frames, int channels, int fromRate, int toRate,
+	std::vector<std::int16_t>& out);
+
+// Format and location of a WAV file's sample data, as stored on disk.
+struct WavInfo {
+	int channels = 0;
+	int sampleRate = 0;
+	int bitsPerSample = 0;
+	std::uint16_t audioFormat = 0;
+	std::uint32_t dataOffset = 0;
+	std::uint32_t dataSize = 0;
+};
+
+inline int block_align(const WavInfo& info) {
+	return info.channels * (info.bitsPerSample / 8);
+}
+
+// Walk the RIFF chunks of a WAV file in memory and validate the format:
+// mono or stereo, 8/16/24/32-bit PCM or 32-bit float, with the sample data
+// inside the `size` bytes.
+bool parse_wav(const std::uint8_t* file, size_t size, WavInfo& info);
+
+// Convert `size` bytes of raw sample data (a whole number of samples) to
+// signed 16-bit; out must have room for size / (bitsPerSample / 8) samples.
+void to_s16(const std::uint8_t* raw, size_t size, const WavInfo& info, std::int16_t* out);
+
+// Parse a WAV file in memory and convert its samples to 16-bit at `rate`.
+// info describes the file as it is.
+bool convert_wav(const std::uint8_t* file, size_t size, int rate, WavInfo& info, std::vector<std::int16_t>& samples);
+
+} // namespace pcm
@@ -0,0 +1,502 @@
+#include "png.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PNG_SSE2 1
+#endif
+
+namespace png {
+
+namespace {
+
+bool fail(const char* why) {
+    std::cerr << "[png] " << why << "\n";
+    return false;
+}
+
+std::uint32_t u32_be(const std::uint8_t* p) {
+    return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | p[3];
+}
+
+// ---- Inflate (RFC 1951) ----
+
+const int kFastBits = 10;
+
+struct Huffman {
+    std::uint16_t fast[1 << kFastBits]; // (length << 9) | symbol; 0 when the code is longer
+    std::uint16_t counts[16];
+    std::uint16_t symbols[288];
+};
+
+// Canonical codes from code lengths. False for an over-subscribed set.
+bool build_huffman(Huffman& h, const std::uint8_t* lengths, int n) {
+    std::memset(h.counts, 0, sizeof(h.counts));
+    std::memset(h.fast, 0, sizeof(h.fast));
+    for (int i = 0; i < n; i++) h.counts[lengths[i]]++;
+    h.counts[0] = 0;
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - h.counts[len];
+        if (left < 0) return false;
+    }
+    int offsets[16];
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + h.counts[len];
+    for (int i = 0; i < n; i++)
+        if (lengths[i]) h.symbols[offsets[lengths[i]]++] = (std::uint16_t)i;
+
+    // Codes arrive least significant bit first, so the table is indexed by
+    // bit-reversed codes.
+    int code = 0, k = 0;
+    for (int len = 1; len < 16; len++) {
+        for (int i = 0; i < h.counts[len]; i++, k++, code++) {
+            if (len > kFastBits) continue;
+            int reversed = 0;
+            for (int b = 0; b < len; b++) reversed |= ((code >> b) & 1) << (len - 1 - b);
+            for (int fill = reversed; fill < (1 << kFastBits); fill += 1 << len)
+                h.fast[fill] = (std::uint16_t)((len << 9) | h.symbols[k]);
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+struct Inflater {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    std::uint64_t buffer = 0; // least significant bit next
+    int count = 0;
+    std::size_t overrun = 0;  // zero bytes fed past the end
+    std::uint8_t* out;
+    std::size_t outSize;
+    std::size_t pos = 0;
+
+    void fill() {
+        while (count <= 56) {
+            std::uint64_t byte = 0;
+            if (p < end) byte = *p++;
+            else overrun++;
+            buffer |= byte << count;
+            count += 8;
+        }
+    }
+
+    unsigned bits(int n) {
+        if (count < n) fill();
+        unsigned v = (unsigned)(buffer & ((1u << n) - 1));
+        buffer >>= n;
+        count -= n;
+        return v;
+    }
+
+    int decode(const Huffman& h) {
+        if (count < 16) fill();
+        unsigned entry = h.fast[buffer & ((1u << kFastBits) - 1)];
+        if (entry) {
+            buffer >>= entry >> 9;
+            count -= (int)(entry >> 9);
+            return (int)(entry & 511);
+        }
+        // Longer code: canonical decoding a bit at a time.
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; len++) {
+            code |= (int)bits(1);
+            int n = h.counts[len];
+            if (code - n < first) return h.symbols[index + (code - first)];
+            index += n;
+            first = (first + n) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool stored() {
+        bits(count & 7); // to a byte boundary
+        unsigned length = bits(16), inverse = bits(16);
+        if ((length ^ 0xFFFF) != inverse) return fail("corrupt stored block");
+        if (length > outSize - pos) return fail("image data too long");
+        for (unsigned i = 0; i < length; i++) out[pos++] = (std::uint8_t)bits(8);
+        return overrun <= 8 || fail("truncated image data");
+    }
+
+    bool codes(const Huffman& lit, const Huffman& dist) {
+        static const std::uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const std::uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const std::uint16_t kDistBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                                    33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                                    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const std::uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        for (;;) {
+            if (overrun > 8) return fail("truncated image data");
+            int symbol = decode(lit);
+            if (symbol < 0) return fail("corrupt image data");
+            if (symbol < 256) {
+                if (pos == outSize) return fail("image data too long");
+                out[pos++] = (std::uint8_t)symbol;
+                continue;
+            }
+            if (symbol == 256) return true;
+            symbol -= 257;
+            if (symbol >= 29) return fail("corrupt image data");
+            std::size_t length = kLengthBase[symbol] + bits(kLengthExtra[symbol]);
+            int d = decode(dist);
+            if (d < 0 || d >= 30) return fail("corrupt image data");
+            std::size_t distance = kDistBase[d] + bits(kDistExtra[d]);
+            if (distance > pos) return fail("corrupt image data");
+            if (length > outSize - pos) return fail("image data too long");
+            std::uint8_t* dst = out + pos;
+            const std::uint8_t* src = dst - distance;
+            if (distance >= length) std::memcpy(dst, src, length);
+            else for (std::size_t i = 0; i < length; i++) dst[i] = src[i]; // overlapping: repeats the run
+            pos += length;
+        }
+    }
+
+    bool dynamic() {
+        static const std::uint8_t kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        int nlit = (int)bits(5) + 257, ndist = (int)bits(5) + 1, ncode = (int)bits(4) + 4;
+        if (nlit > 286 || ndist > 30) return fail("corrupt image data");
+        std::uint8_t lengths[286 + 30] = {};
+        for (int i = 0; i < ncode; i++) lengths[kOrder[i]] = (std::uint8_t)bits(3);
+        Huffman lencode;
+        if (!build_huffman(lencode, lengths, 19)) return fail("corrupt image data");
+        std::memset(lengths, 0, 19);
+        for (int i = 0; i < nlit + ndist;) {
+            int symbol = decode(lencode);
+            if (symbol < 0) return fail("corrupt image data");
+            if (symbol < 16) {
+                lengths[i++] = (std::uint8_t)symbol;
+                continue;
+            }
+            int repeat, value = 0;
+            if (symbol == 16) {
+                if (i == 0) return fail("corrupt image data");
+                value = lengths[i - 1];
+                repeat = 3 + (int)bits(2);
+            } else if (symbol == 17) {
+                repeat = 3 + (int)bits(3);
+            } else {
+                repeat = 11 + (int)bits(7);
+            }
+            if (i + repeat > nlit + ndist) return fail("corrupt image data");
+            while (repeat--) lengths[i++] = (std::uint8_t)value;
+        }
+        Huffman lit, dist;
+        if (!build_huffman(lit, lengths, nlit) || !build_huffman(dist, lengths + nlit, ndist))
+            return fail("corrupt image data");
+        return codes(lit, dist);
+    }
+
+    bool fixed() {
+        static Huffman lit, dist;
+        static const bool built = [] {
+            std::uint8_t lengths[288];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            build_huffman(lit, lengths, 288);
+            std::memset(lengths, 5, 30);
+            build_huffman(dist, lengths, 30);
+            return true;
+        }();
+        (void)built;
+        return codes(lit, dist);
+    }
+};
+
+// Inflate a zlib stream into out, which holds exactly the expected bytes.
+bool inflate(const std::uint8_t* data, std::size_t size, std::uint8_t* out, std::size_t outSize) {
+    if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+        return fail("bad zlib stream");
+    Inflater in{data + 2, data + size, 0, 0, 0, out, outSize};
+    for (bool last = false; !last;) {
+        last = in.bits(1) != 0;
+        unsigned type = in.bits(2);
+        bool ok = type == 0 ? in.stored() : type == 1 ? in.fixed() : type == 2 ? in.dynamic() : fail("bad block type");
+        if (!ok) return false;
+    }
+    return in.pos == outSize || fail("image data too short");
+}
+
+// ---- Filters ----
+
+inline int paeth(int a, int b, int c) {
+    int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+#if defined(PNG_SSE2)
+inline __m128i load_pixel(const std::uint8_t* p, int bpp) {
+    std::uint32_t v = 0;
+    std::memcpy(&v, p, (std::size_t)bpp);
+    return _mm_cvtsi32_si128((int)v);
+}
+
+inline void store_pixel(std::uint8_t* p, __m128i v, int bpp) {
+    std::uint32_t bytes = (std::uint32_t)_mm_cvtsi128_si32(v);
+    std::memcpy(p, &bytes, (std::size_t)bpp);
+}
+
+inline __m128i abs16(__m128i x) {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+// Sub, Average and Paeth reconstruct one 3- or 4-byte pixel at a time, as
+// each depends on the one to its left; all its bytes are done at once.
+void unfilter_pixels(int type, std::uint8_t* cur, const std::uint8_t* prev, std::size_t n, int bpp) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = zero, c = zero; // left and upper left, reconstructed
+    for (std::size_t i = 0; i < n; i += (std::size_t)bpp) {
+        __m128i x = load_pixel(cur + i, bpp);
+        if (type == 1) {
+            a = _mm_add_epi8(x, a);
+        } else if (type == 3) {
+            __m128i b = load_pixel(prev + i, bpp);
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one)); // floor
+            a = _mm_add_epi8(x, avg);
+        } else {
+            __m128i b = load_pixel(prev + i, bpp);
+            __m128i a16 = _mm_unpacklo_epi8(a, zero), b16 = _mm_unpacklo_epi8(b, zero), c16 = _mm_unpacklo_epi8(c, zero);
+            __m128i pa = abs16(_mm_sub_epi16(b16, c16));
+            __m128i pb = abs16(_mm_sub_epi16(a16, c16));
+            __m128i pc = abs16(_mm_sub_epi16(_mm_add_epi16(a16, b16), _mm_add_epi16(c16, c16)));
+            // a where pa <= pb and pa <= pc, else b where pb <= pc, else c.
+            __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+            __m128i notB = _mm_cmpgt_epi16(pb, pc);
+            __m128i bc = _mm_or_si128(_mm_and_si128(notB, c16), _mm_andnot_si128(notB, b16));
+            __m128i pred = _mm_or_si128(_mm_and_si128(notA, bc), _mm_andnot_si128(notA, a16));
+            c = b;
+            a = _mm_add_epi8(x, _mm_packus_epi16(pred, pred));
+        }
+        store_pixel(cur + i, a, bpp);
+    }
+}
+#endif
+
+// Undo a row's filter in place. prev is the reconstructed row above (all
+// zeros for the first row of a pass).
+bool unfilter(int type, std::uint8_t* cur, const std::uint8_t* prev, std::size_t n, int bpp) {
+    switch (type) {
+    case 0:
+        return true;
+    case 2: {
+        std::size_t i = 0;
+#if defined(PNG_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(cur + i), _mm_add_epi8(x, b));
+        }
+#endif
+        for (; i < n; i++) cur[i] = (std::uint8_t)(cur[i] + prev[i]);
+        return true;
+    }
+    case 1:
+    case 3:
+    case 4:
+        break;
+    default:
+        return fail("bad filter type");
+    }
+#if defined(PNG_SSE2)
+    if (bpp == 3 || bpp == 4) {
+        unfilter_pixels(type, cur, prev, n, bpp);
+        return true;
+    }
+#endif
+    const std::size_t step = (std::size_t)bpp;
+    for (std::size_t i = 0; i < n; i++) {
+        int a = i >= step ? cur[i - step] : 0;
+        int b = prev[i];
+        int c = i >= step ? prev[i - step] : 0;
+        int pred = type == 1 ? a : type == 3 ? (a + b) >> 1 : paeth(a, b, c);
+        cur[i] = (std::uint8_t)(cur[i] + pred);
+    }
+    return true;
+}
+
+// ---- Image ----
+
+struct Header {
+    int width = 0, height = 0;
+    int depth = 0;
+    int colorType = 0;
+    bool interlaced = false;
+    int channels = 0;
+    std::uint8_t palette[256][3] = {};
+    int paletteSize = 0;
+
+    int bits_per_pixel() const { return channels * depth; }
+    std::size_t row_bytes(int w) const { return ((std::size_t)w * bits_per_pixel() + 7) / 8; }
+};
+
+struct Pass {
+    int x0, y0, dx, dy;
+    int width, height;
+};
+
+// The first sample of a pixel's channel, scaled to 8 bits.
+inline std::uint8_t sample(const std::uint8_t* row, int index, int depth) {
+    if (depth == 8) return row[index];
+    if (depth == 16) return row[2 * index];
+    int bit = index * depth;
+    int v = (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+    return (std::uint8_t)(v * 255 / ((1 << depth) - 1));
+}
+
+// Write a pass row's pixels as BGR, `step` bytes apart.
+void convert_row(const Header& png, const std::uint8_t* row, int n, std::uint8_t* dst, std::size_t step) {
+    if (png.depth == 8 && (png.colorType == 2 || png.colorType == 6)) {
+        const int c = png.channels;
+        for (int x = 0; x < n; x++, dst += step, row += c) {
+            dst[0] = row[2];
+            dst[1] = row[1];
+            dst[2] = row[0];
+        }
+        return;
+    }
+    for (int x = 0; x < n; x++, dst += step) {
+        switch (png.colorType) {
+        case 0:
+        case 4:
+            dst[0] = dst[1] = dst[2] = sample(row, x * png.channels, png.depth);
+            break;
+        case 2:
+        case 6:
+            dst[0] = sample(row, x * png.channels + 2, png.depth);
+            dst[1] = sample(row, x * png.channels + 1, png.depth);
+            dst[2] = sample(row, x * png.channels, png.depth);
+            break;
+        case 3: {
+            int bit = x * png.depth;
+            int index = png.depth == 8 ? row[x] : (row[bit >> 3] >> (8 - png.depth - (bit & 7))) & ((1 << png.depth) - 1);
+            const std::uint8_t* rgb = png.palette[index];
+            dst[0] = rgb[2];
+            dst[1] = rgb[1];
+            dst[2] = rgb[0];
+            break;
+        }
+        }
+    }
+}
+
+bool read_header(const std::uint8_t* p, std::uint32_t length, Header& png) {
+    if (length < 13) return fail("bad IHDR");
+    std::uint32_t w = u32_be(p), h = u32_be(p + 4);
+    png.depth = p[8];
+    png.colorType = p[9];
+    png.interlaced = p[12] == 1;
+    if (w == 0 || h == 0 || w > 65535 || h > 65535) return fail("bad image size");
+    if ((std::size_t)w * h > texture::kMaxImagePixels) return fail("image too large");
+    if (p[10] != 0 || p[11] != 0 || p[12] > 1) return fail("unknown compression, filter or interlace method");
+    png.width = (int)w;
+    png.height = (int)h;
+    const int d = png.depth;
+    switch (png.colorType) {
+    case 0: png.channels = 1; if (d != 1 && d != 2 && d != 4 && d != 8 && d != 16) return fail("bad bit depth"); break;
+    case 2: png.channels = 3; if (d != 8 && d != 16) return fail("bad bit depth"); break;
+    case 3: png.channels = 1; if (d != 1 && d != 2 && d != 4 && d != 8) return fail("bad bit depth"); break;
+    case 4: png.channels = 2; if (d != 8 && d != 16) return fail("bad bit depth"); break;
+    case 6: png.channels = 4; if (d != 8 && d != 16) return fail("bad bit depth"); break;
+    default: return fail("bad color type");
+    }
+    return true;
+}
+
+} // namespace
+
+bool decode(const std::uint8_t* file, std::size_t size, texture::Image& image) {
+    if (size < 8 || std::memcmp(file, "\x89PNG\r\n\x1a\n", 8) != 0) return fail("not a PNG file");
+    Header png;
+    bool haveHeader = false;
+    // The zlib stream: where it is, when it is a single IDAT chunk, or
+    // gathered from several.
+    const std::uint8_t* stream = nullptr;
+    std::size_t streamSize = 0;
+    std::vector<std::uint8_t> gathered;
+    int idats = 0;
+    for (std::size_t pos = 8;;) {
+        if (size - pos < 12) return fail("truncated file");
+        std::uint32_t length = u32_be(file + pos);
+        const std::uint8_t* type = file + pos + 4;
+        const std::uint8_t* data = file + pos + 8;
+        if (length > size - pos - 12) return fail("truncated chunk");
+        pos += 12 + (std::size_t)length;
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (!read_header(data, length, png)) return false;
+            haveHeader = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 || length > 768) return fail("bad palette");
+            png.paletteSize = (int)length / 3;
+            std::memcpy(png.palette, data, length);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            if (idats++ == 1) gathered.assign(stream, stream + streamSize);
+            if (idats == 1) {
+                stream = data;
+                streamSize = length;
+            } else {
+                gathered.insert(gathered.end(), data, data + length);
+            }
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 0x20)) {
+            return fail("unknown critical chunk");
+        }
+    }
+    if (!haveHeader || idats == 0) return fail("no image data");
+    if (png.colorType == 3 && png.paletteSize == 0) return fail("no palette");
+    if (idats > 1) {
+        stream = gathered.data();
+        streamSize = gathered.size();
+    }
+
+    std::vector<Pass> passes;
+    if (png.interlaced) {
+        static const int kAdam7[7][4] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                         {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+        for (const int* a : kAdam7) {
+            Pass pass{a[0], a[1], a[2], a[3], (png.width - a[0] + a[2] - 1) / a[2], (png.height - a[1] + a[3] - 1) / a[3]};
+            if (pass.width > 0 && pass.height > 0) passes.push_back(pass);
+        }
+    } else {
+        passes.push_back(Pass{0, 0, 1, 1, png.width, png.height});
+    }
+    std::size_t rawSize = 0;
+    for (const Pass& pass : passes) rawSize += (1 + png.row_bytes(pass.width)) * pass.height;
+    std::vector<std::uint8_t> raw(rawSize);
+    if (!inflate(stream, streamSize, raw.data(), raw.size())) return false;
+
+    const std::size_t stride = texture::bmp_stride(png.width);
+    image.width = png.width;
+    image.height = png.height;
+    image.storage.assign(stride * png.height, 0);
+    image.pixels = image.storage.data();
+    const int bpp = std::max(1, png.bits_per_pixel() / 8);
+    std::vector<std::uint8_t> zeros(png.row_bytes(png.width));
+    std::uint8_t* row = raw.data();
+    for (const Pass& pass : passes) {
+        const std::size_t n = png.row_bytes(pass.width);
+        const std::uint8_t* prev = zeros.data();
+        for (int y = 0; y < pass.height; y++, row += 1 + n) {
+            if (!unfilter(row[0], row + 1, prev, n, bpp)) return false;
+            prev = row + 1;
+            const int line = pass.y0 + y * pass.dy;
+            std::uint8_t* dst = image.storage.data() + (std::size_t)(png.height - 1 - line) * stride + pass.x0 * 3;
+            convert_row(png, row + 1, pass.width, dst, (std::size_t)pass.dx * 3); // bottom row first
+        }
+    }
+    return true;
+}
+
+} // namespace png
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "texture.h"
+
+// PNG decoding for textures.
+//
+// Every standard color type and bit depth, with or without Adam7
+// interlacing. Alpha (and tRNS) is dropped and 16-bit samples keep their
+// high byte, as the textures are opaque RGB. Chunk CRCs and the zlib
+// checksum are not verified.
+//
+// The zlib stream is inflated by the decoder itself with 10-bit lookup
+// tables. The row filters use SSE2 where available for 3- and 4-byte
+// pixels: Up 16 bytes at a time, Sub, Average and Paeth a pixel at a time.
+namespace png {
+
+// Decode into image (BMP layout, see texture::Image). False, with a message
+// on stderr, for a file that is malformed.
+bool decode(const std::uint8_t* file, std::size_t size, texture::Image& image);
+
+} // namespace png
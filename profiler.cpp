@@ -0,0 +1,184 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace profiler {
+
+namespace {
+
+using clock_t = std::chrono::steady_clock;
+const clock_t::time_point g_epoch = clock_t::now();
+
+std::atomic<std::uint32_t> g_frame{0};
+
+#ifdef ENABLE_PROFILER
+
+const std::uint32_t kRingCapacity = 1u << 16; // events per thread
+
+struct Event {
+    const char* name;
+    std::uint64_t startNs;
+    std::uint64_t endNs;
+    std::uint32_t depth;
+    std::uint32_t frame;
+};
+
+// One ring per thread. Only the owning thread writes; readers use the
+// published write index and accept that the oldest entries may be recycled
+// while they export.
+struct ThreadBuffer {
+    Event events[kRingCapacity];
+    std::atomic<std::uint64_t> written{0};
+    std::uint32_t tid = 0;
+    char name[32] = {};
+    ThreadBuffer* next = nullptr;
+};
+
+std::atomic<ThreadBuffer*> g_buffers{nullptr};
+std::atomic<std::uint32_t> g_nextTid{1};
+
+// Buffers are intentionally never freed: exporters may still walk them after
+// their thread has exited.
+ThreadBuffer* thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer) return buffer;
+    buffer = new ThreadBuffer();
+    buffer->tid = g_nextTid.fetch_add(1, std::memory_order_relaxed);
+    std::snprintf(buffer->name, sizeof(buffer->name), "thread %u", buffer->tid);
+    ThreadBuffer* head = g_buffers.load(std::memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!g_buffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+    return buffer;
+}
+
+// Pending capture, driven from frame_mark().
+std::uint32_t g_captureFirst = 0;
+std::uint32_t g_captureLast = 0;
+bool g_capturePending = false;
+std::string g_capturePath;
+
+void write_json_string(std::FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+#endif
+
+} // namespace
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - g_epoch).count());
+}
+
+std::uint32_t current_frame() {
+    return g_frame.load(std::memory_order_relaxed);
+}
+
+#ifdef ENABLE_PROFILER
+
+namespace detail {
+
+void record(const char* name, std::uint64_t startNs, std::uint64_t endNs, std::uint32_t depth, std::uint32_t frame) {
+    ThreadBuffer* buffer = thread_buffer();
+    std::uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[index % kRingCapacity] = {name, startNs, endNs, depth, frame};
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+std::uint32_t& depth() {
+    thread_local std::uint32_t value = 0;
+    return value;
+}
+
+} // namespace detail
+
+void set_thread_name(const char* name) {
+    ThreadBuffer* buffer = thread_buffer();
+    std::snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+void frame_mark() {
+    std::uint32_t frame = g_frame.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (g_capturePending && frame > g_captureLast) {
+        export_chrome_trace(g_captureFirst, g_captureLast, g_capturePath.c_str());
+        g_capturePending = false;
+    }
+}
+
+bool capture_frames(std::uint32_t frameCount, const char* path) {
+    if (g_capturePending || frameCount == 0) return false;
+    g_captureFirst = current_frame() + 1;
+    g_captureLast = g_captureFirst + frameCount - 1;
+    g_capturePath = path;
+    g_capturePending = true;
+    return true;
+}
+
+void write_trace_events(std::FILE* f, std::uint32_t firstFrame, std::uint32_t lastFrame, bool& needComma) {
+    for (ThreadBuffer* b = g_buffers.load(std::memory_order_acquire); b; b = b->next) {
+        std::fprintf(f, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":",
+                     needComma ? ",\n" : "", b->tid);
+        write_json_string(f, b->name);
+        std::fputs("}}", f);
+        needComma = true;
+
+        std::uint64_t written = b->written.load(std::memory_order_acquire);
+        std::uint64_t begin = written > kRingCapacity ? written - kRingCapacity : 0;
+        for (std::uint64_t i = begin; i < written; ++i) {
+            const Event& e = b->events[i % kRingCapacity];
+            if (e.frame < firstFrame || e.frame > lastFrame) continue;
+            std::fputs(",\n{\"ph\":\"X\",\"pid\":1,", f);
+            std::fprintf(f, "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", b->tid,
+                         e.startNs / 1000.0, (e.endNs - e.startNs) / 1000.0);
+            write_json_string(f, e.name);
+            std::fprintf(f, ",\"args\":{\"frame\":%u,\"depth\":%u}}", e.frame, e.depth);
+        }
+    }
+}
+
+bool export_chrome_trace(std::uint32_t firstFrame, std::uint32_t lastFrame, const char* path) {
+    std::FILE* f = std::fopen(path, "w");
+    if (!f) {
+        std::fprintf(stderr, "[profiler] Cannot write trace: %s\n", path);
+        return false;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    bool needComma = false;
+    write_trace_events(f, firstFrame, lastFrame, needComma);
+    std::fputs("\n]}\n", f);
+    std::fclose(f);
+    std::fprintf(stderr, "[profiler] Wrote frames %u-%u to %s\n", firstFrame, lastFrame, path);
+    return true;
+}
+
+#else
+
+void set_thread_name(const char*) {}
+
+void frame_mark() {
+    g_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool capture_frames(std::uint32_t, const char*) {
+    return false;
+}
+
+bool export_chrome_trace(std::uint32_t, std::uint32_t, const char*) {
+    return false;
+}
+
+void write_trace_events(std::FILE*, std::uint32_t, std::uint32_t, bool&) {}
+
+#endif
+
+} // namespace profiler
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Scoped CPU profiling zones.
+//
+// Build with ENABLE_PROFILER to record zones; otherwise PROFILE_ZONE and
+// PROFILE_FRAME expand to nothing. Each thread writes into its own fixed-size
+// ring buffer (single writer, no locks), and a capture of a frame range can be
+// exported as Chrome/Perfetto trace JSON (chrome://tracing, ui.perfetto.dev).
+
+namespace profiler {
+
+// Nanoseconds since the profiler epoch (steady clock).
+std::uint64_t now_ns();
+
+// Current frame number, advanced by frame_mark().
+std::uint32_t current_frame();
+
+#ifdef ENABLE_PROFILER
+
+namespace detail {
+void record(const char* name, std::uint64_t startNs, std::uint64_t endNs, std::uint32_t depth, std::uint32_t frame);
+std::uint32_t& depth();
+} // namespace detail
+
+class Zone {
+public:
+    explicit Zone(const char* name)
+        : m_name(name), m_frame(current_frame()), m_depth(detail::depth()++), m_start(now_ns()) {}
+    ~Zone() {
+        std::uint64_t end = now_ns();
+        --detail::depth();
+        detail::record(m_name, m_start, end, m_depth, m_frame);
+    }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* m_name;
+    std::uint32_t m_frame;
+    std::uint32_t m_depth;
+    std::uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// Name must be a string literal (or otherwise outlive the capture).
+#define PROFILE_ZONE(name) ::profiler::Zone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FRAME() ::profiler::frame_mark()
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+
+#endif
+
+// Name the calling thread in exported traces.
+void set_thread_name(const char* name);
+
+// Start of a new frame (called once per frame from the render loop).
+void frame_mark();
+
+// Capture the next frameCount frames and write them to path when the range
+// completes. Returns false if profiling is compiled out or a capture is pending.
+bool capture_frames(std::uint32_t frameCount, const char* path);
+
+// Export every buffered zone whose frame lies in [firstFrame, lastFrame].
+// Zones older than the per-thread ring capacity are no longer available.
+bool export_chrome_trace(std::uint32_t firstFrame, std::uint32_t lastFrame, const char* path);
+
+// Append the same zones as trace events to an open traceEvents array.
+// needComma tracks whether a separator is due before the next event.
+void write_trace_events(std::FILE* f, std::uint32_t firstFrame, std::uint32_t lastFrame, bool& needComma);
+
+} // namespace profiler
@@ -0,0 +1,300 @@
+#include "reverb.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define REVERB_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REVERB_SSE2 1
+#endif
+
+namespace reverb {
+
+namespace {
+
+const float kPi = 3.14159265f;
+const float kSpeedOfSound = 343.0f; // m/s
+const int kOrder = 3;               // highest image-source reflection order
+
+// Left and right sums += x * left / x * right, bin by bin, for one
+// partition. The input spectrum is loaded once for both channels.
+void multiply_add(const float* xRe, const float* xIm, const float* lRe, const float* lIm, const float* rRe,
+	const float* rIm, float* sum, int bins) {
+	float* slRe = sum;
+	float* slIm = sum + bins;
+	float* srRe = sum + 2 * bins;
+	float* srIm = sum + 3 * bins;
+	int k = 0;
+#if defined(REVERB_AVX)
+	for (; k + 8 <= bins; k += 8) {
+		__m256 xr = _mm256_loadu_ps(xRe + k), xi = _mm256_loadu_ps(xIm + k);
+		__m256 hr = _mm256_loadu_ps(lRe + k), hi = _mm256_loadu_ps(lIm + k);
+		_mm256_storeu_ps(slRe + k, _mm256_add_ps(_mm256_loadu_ps(slRe + k),
+			_mm256_sub_ps(_mm256_mul_ps(xr, hr), _mm256_mul_ps(xi, hi))));
+		_mm256_storeu_ps(slIm + k, _mm256_add_ps(_mm256_loadu_ps(slIm + k),
+			_mm256_add_ps(_mm256_mul_ps(xr, hi), _mm256_mul_ps(xi, hr))));
+		hr = _mm256_loadu_ps(rRe + k);
+		hi = _mm256_loadu_ps(rIm + k);
+		_mm256_storeu_ps(srRe + k, _mm256_add_ps(_mm256_loadu_ps(srRe + k),
+			_mm256_sub_ps(_mm256_mul_ps(xr, hr), _mm256_mul_ps(xi, hi))));
+		_mm256_storeu_ps(srIm + k, _mm256_add_ps(_mm256_loadu_ps(srIm + k),
+			_mm256_add_ps(_mm256_mul_ps(xr, hi), _mm256_mul_ps(xi, hr))));
+	}
+#elif defined(REVERB_SSE2)
+	for (; k + 4 <= bins; k += 4) {
+		__m128 xr = _mm_loadu_ps(xRe + k), xi = _mm_loadu_ps(xIm + k);
+		__m128 hr = _mm_loadu_ps(lRe + k), hi = _mm_loadu_ps(lIm + k);
+		_mm_storeu_ps(slRe + k, _mm_add_ps(_mm_loadu_ps(slRe + k), _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi))));
+		_mm_storeu_ps(slIm + k, _mm_add_ps(_mm_loadu_ps(slIm + k), _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr))));
+		hr = _mm_loadu_ps(rRe + k);
+		hi = _mm_loadu_ps(rIm + k);
+		_mm_storeu_ps(srRe + k, _mm_add_ps(_mm_loadu_ps(srRe + k), _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi))));
+		_mm_storeu_ps(srIm + k, _mm_add_ps(_mm_loadu_ps(srIm + k), _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr))));
+	}
+#endif
+	for (; k < bins; k++) {
+		slRe[k] += xRe[k] * lRe[k] - xIm[k] * lIm[k];
+		slIm[k] += xRe[k] * lIm[k] + xIm[k] * lRe[k];
+		srRe[k] += xRe[k] * rRe[k] - xIm[k] * rIm[k];
+		srIm[k] += xRe[k] * rIm[k] + xIm[k] * rRe[k];
+	}
+}
+
+} // namespace
+
+float rt60(const Room& room) {
+	float volume = room.width * room.height * room.depth;
+	float surface = 2.0f * (room.width * room.height + room.width * room.depth + room.height * room.depth);
+	float absorption = std::min(1.0f, std::max(0.01f, room.absorption));
+	return surface > 0.0f ? 0.161f * volume / (surface * absorption) : 0.0f;
+}
+
+void impulse_response(const Room& room, int sampleRate, float maxSeconds, std::vector<float>& left,
+	std::vector<float>& right) {
+	size_t frames = (size_t)std::max(1.0f, std::min(rt60(room), maxSeconds) * sampleRate);
+	left.assign(frames, 0.0f);
+	right.assign(frames, 0.0f);
+
+	// Listener near the middle at ear height, facing -z; the source is
+	// three metres away, in front and to the right.
+	const float size[3] = {room.width, room.height, room.depth};
+	const float listener[3] = {size[0] * 0.5f, std::min(1.7f, size[1] * 0.5f), size[2] * 0.5f};
+	float source[3] = {listener[0] + 1.5f, listener[1], listener[2] - 2.5f};
+	for (int a = 0; a < 3; a++) source[a] = std::min(size[a] * 0.95f, std::max(size[a] * 0.05f, source[a]));
+	const float beta = std::sqrt(1.0f - std::min(0.99f, std::max(0.0f, room.absorption))); // pressure per bounce
+
+	// Image sources: along each axis, image i of parity q sits at
+	// 2 i L +/- s after |2 i - q| reflections.
+	float firstDelay = (float)frames, lastDelay = 0.0f;
+	for (int ix = -kOrder; ix <= kOrder; ix++)
+	for (int qx = 0; qx < 2; qx++)
+	for (int iy = -kOrder; iy <= kOrder; iy++)
+	for (int qy = 0; qy < 2; qy++)
+	for (int iz = -kOrder; iz <= kOrder; iz++)
+	for (int qz = 0; qz < 2; qz++) {
+		const int index[3] = {ix, iy, iz};
+		const int parity[3] = {qx, qy, qz};
+		int bounces = 0;
+		float d[3];
+		for (int a = 0; a < 3; a++) {
+			bounces += std::abs(2 * index[a] - parity[a]);
+			d[a] = 2.0f * index[a] * size[a] + (parity[a] ? -source[a] : source[a]) - listener[a];
+		}
+		if (bounces == 0 || bounces > kOrder) continue; // the direct sound is the dry signal
+		float dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		float delay = dist / kSpeedOfSound * sampleRate;
+		if (delay + 1.0f >= (float)frames) continue;
+		float gain = std::pow(beta, (float)bounces) / std::max(1.0f, dist);
+		float pan = d[0] / std::max(1e-3f, dist);
+		float gl = gain * std::sqrt(0.5f * (1.0f - pan));
+		float gr = gain * std::sqrt(0.5f * (1.0f + pan));
+		// Split between the two nearest samples.
+		size_t i = (size_t)delay;
+		float frac = delay - (float)i;
+		left[i] += gl * (1.0f - frac);
+		left[i + 1] += gl * frac;
+		right[i] += gr * (1.0f - frac);
+		right[i + 1] += gr * frac;
+		firstDelay = std::min(firstDelay, delay);
+		lastDelay = std::max(lastDelay, delay);
+	}
+
+	// The tail fades in over the early reflections and carries on at the
+	// level they reach at the end: their RMS over the last 20 ms of them.
+	size_t window = (size_t)(0.02f * sampleRate);
+	size_t end = std::min(frames, (size_t)lastDelay + 1);
+	size_t start = end > window ? end - window : 0;
+	double energy = 0.0;
+	for (size_t i = start; i < end; i++) energy += 0.5 * (left[i] * left[i] + right[i] * right[i]);
+	float level = end > start && energy > 0.0 ? (float)std::sqrt(energy / (end - start)) : 1.0f;
+
+	// One-pole low-pass noise (the air absorbs highs), scaled back to unit
+	// RMS, decaying by 60 dB over RT60.
+	const float smooth = 0.6f;
+	const float unit = std::sqrt(3.0f) / std::sqrt(smooth / (2.0f - smooth));
+	const float decay = -6.9078f / (rt60(room) * sampleRate);
+	std::mt19937 rng(20241);
+	std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+	float nl = 0.0f, nr = 0.0f;
+	for (size_t i = (size_t)firstDelay; i < frames; i++) {
+		nl += smooth * (noise(rng) * unit - nl);
+		nr += smooth * (noise(rng) * unit - nr);
+		float fade = i < end ? (float)(i - (size_t)firstDelay) / std::max(1.0f, (float)end - firstDelay) : 1.0f;
+		float env = level * fade * std::exp(decay * (float)(i - start));
+		left[i] += nl * env;
+		right[i] += nr * env;
+	}
+
+	double total = 0.0;
+	for (size_t i = 0; i < frames; i++) total += left[i] * left[i] + right[i] * right[i];
+	float scale = total > 0.0 ? (float)(1.0 / std::sqrt(total)) : 0.0f;
+	for (size_t i = 0; i < frames; i++) {
+		left[i] *= scale;
+		right[i] *= scale;
+	}
+}
+
+Convolver::Convolver(const std::vector<float>& left, const std::vector<float>& right)
+	: input(kFft, 0.0f), outLeft(kBlock, 0.0f), outRight(kBlock, 0.0f), sums(4 * kBins), workRe(kFft),
+	  workIm(kFft), time(kFft), cosTable(kFft / 2), sinTable(kFft / 2), bitReverse(kFft) {
+	for (int k = 0; k < kFft / 2; k++) {
+		cosTable[k] = std::cos(2.0f * kPi * k / kFft);
+		sinTable[k] = std::sin(2.0f * kPi * k / kFft);
+	}
+	int bits = 0;
+	while ((1 << bits) < kFft) bits++;
+	for (int i = 0; i < kFft; i++) {
+		int r = 0;
+		for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+		bitReverse[i] = r;
+	}
+
+	size_t length = std::max(left.size(), right.size());
+	parts = std::max(1, (int)((length + kBlock - 1) / kBlock));
+	size_t spectra = (size_t)parts * kBins;
+	leftRe.assign(spectra, 0.0f);
+	leftIm.assign(spectra, 0.0f);
+	rightRe.assign(spectra, 0.0f);
+	rightIm.assign(spectra, 0.0f);
+	historyRe.assign(spectra, 0.0f);
+	historyIm.assign(spectra, 0.0f);
+
+	// Each partition, zero-padded to kFft, in the frequency domain.
+	std::vector<float> block(kFft);
+	const std::vector<float>* channels[2] = {&left, &right};
+	std::vector<float>* re[2] = {&leftRe, &rightRe};
+	std::vector<float>* im[2] = {&leftIm, &rightIm};
+	for (int c = 0; c < 2; c++) {
+		const std::vector<float>& h = *channels[c];
+		for (int p = 0; p < parts; p++) {
+			std::fill(block.begin(), block.end(), 0.0f);
+			size_t first = (size_t)p * kBlock;
+			for (size_t i = first; i < std::min(h.size(), first + kBlock); i++) block[i - first] = h[i];
+			forward(block.data(), &(*re[c])[(size_t)p * kBins], &(*im[c])[(size_t)p * kBins]);
+		}
+	}
+}
+
+// In-place iterative radix-2 FFT of kFft points.
+void Convolver::fft(float* re, float* im, bool inverse) {
+	for (int i = 0; i < kFft; i++) {
+		int j = bitReverse[i];
+		if (j > i) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+	const float sign = inverse ? 1.0f : -1.0f;
+	for (int len = 2; len <= kFft; len <<= 1) {
+		int half = len >> 1;
+		int stride = kFft / len;
+		for (int i = 0; i < kFft; i += len) {
+			for (int j = 0; j < half; j++) {
+				float wr = cosTable[j * stride];
+				float wi = sign * sinTable[j * stride];
+				int a = i + j, b = a + half;
+				float tr = re[b] * wr - im[b] * wi;
+				float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+// Spectrum of kFft real samples: bins 0 .. kBlock, the rest of kBins zero.
+void Convolver::forward(const float* samples, float* re, float* im) {
+	std::copy(samples, samples + kFft, workRe.begin());
+	std::fill(workIm.begin(), workIm.end(), 0.0f);
+	fft(workRe.data(), workIm.data(), false);
+	std::copy(workRe.begin(), workRe.begin() + kBlock + 1, re);
+	std::copy(workIm.begin(), workIm.begin() + kBlock + 1, im);
+	std::fill(re + kBlock + 1, re + kBins, 0.0f);
+	std::fill(im + kBlock + 1, im + kBins, 0.0f);
+}
+
+// Real signal back from bins 0 .. kBlock, the others being their conjugates.
+void Convolver::inverse(const float* re, const float* im, float* samples) {
+	for (int k = 0; k <= kBlock; k++) {
+		workRe[k] = re[k];
+		workIm[k] = im[k];
+	}
+	for (int k = kBlock + 1; k < kFft; k++) {
+		workRe[k] = re[kFft - k];
+		workIm[k] = -im[kFft - k];
+	}
+	fft(workRe.data(), workIm.data(), true);
+	const float scale = 1.0f / kFft;
+	for (int i = 0; i < kFft; i++) samples[i] = workRe[i] * scale;
+}
+
+void Convolver::run_block() {
+	float* xRe = &historyRe[(size_t)head * kBins];
+	float* xIm = &historyIm[(size_t)head * kBins];
+	forward(input.data(), xRe, xIm);
+
+	std::fill(sums.begin(), sums.end(), 0.0f);
+	for (int p = 0; p < parts; p++) {
+		// Partition p meets the input from p blocks ago.
+		size_t slot = (size_t)((head - p + parts) % parts) * kBins;
+		size_t part = (size_t)p * kBins;
+		multiply_add(&historyRe[slot], &historyIm[slot], &leftRe[part], &leftIm[part], &rightRe[part],
+			&rightIm[part], sums.data(), kBins);
+	}
+	head = (head + 1) % parts;
+
+	// Overlap-save: the second half of the circular result is the output.
+	inverse(&sums[0], &sums[kBins], time.data());
+	std::copy(time.begin() + kBlock, time.end(), outLeft.begin());
+	inverse(&sums[2 * kBins], &sums[3 * kBins], time.data());
+	std::copy(time.begin() + kBlock, time.end(), outRight.begin());
+
+	std::copy(input.begin() + kBlock, input.end(), input.begin());
+}
+
+void Convolver::process(const float* in, float* out, int frames, float gain) {
+	int done = 0;
+	while (done < frames) {
+		int n = std::min(frames - done, kBlock - fill);
+		std::copy(in + done, in + done + n, input.begin() + kBlock + fill);
+		// The output of the previous block, frame for frame: kBlock frames late.
+		for (int i = 0; i < n; i++) {
+			out[2 * (done + i)] += gain * outLeft[fill + i];
+			out[2 * (done + i) + 1] += gain * outRight[fill + i];
+		}
+		fill += n;
+		done += n;
+		if (fill == kBlock) {
+			run_block();
+			fill = 0;
+		}
+	}
+}
+
+} // namespace reverb
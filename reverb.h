@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+// Room reverberation for the software mixer: an impulse response made up
+// from the shape of a box room, and the convolution that applies it.
+namespace reverb {
+
+struct Room {
+	float width = 20.0f;  // x, metres
+	float height = 9.0f;  // y
+	float depth = 20.0f;  // z
+	float absorption = 0.3f; // average absorption coefficient of the surfaces, 0..1
+};
+
+// Sabine's reverberation time, in seconds: RT60 = 0.161 V / (S a).
+float rt60(const Room& room);
+
+// Stereo impulse response of the room, without the direct sound: image-
+// source reflections up to third order for a listener near the middle of
+// the room and a source a few metres away, then an exponentially decaying
+// noise tail that is independent in each channel. It lasts RT60, up to
+// maxSeconds, and its energy summed over both channels is 1.
+void impulse_response(const Room& room, int sampleRate, float maxSeconds, std::vector<float>& left,
+	std::vector<float>& right);
+
+// Uniformly partitioned overlap-save convolution of a mono signal with a
+// stereo impulse response. The response is cut into kBlock-frame
+// partitions, transformed once; each kBlock frames of input are
+// transformed and multiplied with every partition against a delay line of
+// past input spectra, so the cost per frame is fixed whatever the length
+// of the response and the latency is kBlock frames. The complex
+// multiply-adds use AVX or SSE2 where available.
+class Convolver {
+public:
+	static const int kBlock = 256;
+	static const int kFft = 2 * kBlock;
+	static const int kBins = kBlock + 8; // kBlock + 1 used, padded to whole SIMD vectors
+
+	Convolver(const std::vector<float>& left, const std::vector<float>& right);
+
+	int partitions() const { return parts; }
+	int latency() const { return kBlock; }
+
+	// Convolve `frames` mono frames of in and add the result, times gain,
+	// to interleaved stereo out.
+	void process(const float* in, float* out, int frames, float gain);
+
+private:
+	void run_block();
+	void forward(const float* time, float* re, float* im);
+	void inverse(const float* re, const float* im, float* time);
+	void fft(float* re, float* im, bool inverse);
+
+	int parts = 0;
+	// Partition spectra of the response, [part][bin], split into real and
+	// imaginary planes per channel.
+	std::vector<float> leftRe, leftIm, rightRe, rightIm;
+	// Spectra of the last `parts` input blocks, a ring starting at head.
+	std::vector<float> historyRe, historyIm;
+	int head = 0;
+
+	std::vector<float> input;   // kFft frames: the previous block, then the one filling
+	std::vector<float> outLeft, outRight; // the last block's output, kBlock frames each
+	int fill = 0;               // frames of the current block received
+
+	std::vector<float> sums; // left re, left im, right re, right im; kBins each
+	std::vector<float> workRe, workIm, time;
+	std::vector<float> cosTable, sinTable;
+	std::vector<int> bitReverse;
+};
+
+} // namespace reverb
@@ -0,0 +1,285 @@
+#include "sdf_text.h"
+#include "profiler.h"
+
+#include <GL/glut.h>
+#include <GL/freeglut.h>
+#include "glcount.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace sdf_text {
+
+namespace {
+
+const int kFirstChar = 32;
+const int kGlyphCount = 96; // printable ASCII 32..127
+const int kColumns = 16;
+const int kCellW = 40;
+const int kCellH = 48;
+const int kAtlasWidth = 1024;
+const int kAtlasHeight = 512;
+
+// Cells cover font units [-kOriginX, ..) x [-kOriginY, ..) at kUnitsPerTexel.
+const float kUnitsPerTexel = 200.0f / kCellH;
+const float kOriginX = 30.0f;
+const float kOriginY = 50.0f;
+// GLUT_STROKE_ROMAN: cap height in font units; strokes are lines of zero
+// width, so give them a fixed thickness.
+const float kCapHeight = 119.05f;
+const float kHalfStroke = 6.0f;
+// Distance mapped to the full 0..1 alpha range, either side of the edge.
+const float kSpread = 4.0f * kUnitsPerTexel;
+
+struct Segment {
+    float x0, y0, x1, y1;
+};
+
+struct Vertex {
+    float x, y, z;
+    float u, v;
+    unsigned char rgba[4];
+};
+
+bool g_metricsReady = false;
+bool g_ready = false;
+float g_advance[kGlyphCount];
+GLuint g_atlas = 0;
+std::vector<Vertex> g_batch;
+
+void ensure_metrics() {
+    if (g_metricsReady) return;
+    for (int g = 0; g < kGlyphCount; ++g)
+        g_advance[g] = glutStrokeWidth(GLUT_STROKE_ROMAN, kFirstChar + g);
+    g_metricsReady = true;
+}
+
+// Line segments of one stroke glyph, in font units.
+void capture_glyph(int c, std::vector<GLfloat>& buffer, std::vector<Segment>& out) {
+    const float extent = 256.0f;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(-extent, extent, -extent, extent, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glFeedbackBuffer(static_cast<GLsizei>(buffer.size()), GL_2D, buffer.data());
+    glRenderMode(GL_FEEDBACK);
+    glutStrokeCharacter(GLUT_STROKE_ROMAN, c);
+    GLint used = glRenderMode(GL_RENDER);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    out.clear();
+    auto unproject = [&](const GLfloat* v, float& x, float& y) {
+        x = (2.0f * (v[0] - viewport[0]) / viewport[2] - 1.0f) * extent;
+        y = (2.0f * (v[1] - viewport[1]) / viewport[3] - 1.0f) * extent;
+    };
+    int i = 0;
+    while (i < used) {
+        GLint token = static_cast<GLint>(buffer[i++]);
+        switch (token) {
+        case GL_LINE_TOKEN:
+        case GL_LINE_RESET_TOKEN: {
+            Segment s;
+            unproject(&buffer[i], s.x0, s.y0);
+            unproject(&buffer[i + 2], s.x1, s.y1);
+            out.push_back(s);
+            i += 4;
+            break;
+        }
+        case GL_POLYGON_TOKEN:
+            i += 1 + static_cast<int>(buffer[i]) * 2;
+            break;
+        case GL_POINT_TOKEN:
+        case GL_BITMAP_TOKEN:
+        case GL_DRAW_PIXEL_TOKEN:
+        case GL_COPY_PIXEL_TOKEN:
+            i += 2;
+            break;
+        case GL_PASS_THROUGH_TOKEN:
+            i += 1;
+            break;
+        default:
+            i = used;
+            break;
+        }
+    }
+}
+
+float segment_distance(const Segment& s, float px, float py) {
+    float dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+    float len2 = dx * dx + dy * dy;
+    float t = len2 > 0.0f ? ((px - s.x0) * dx + (py - s.y0) * dy) / len2 : 0.0f;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    float ex = s.x0 + t * dx - px, ey = s.y0 + t * dy - py;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+void glyph_rect(int g, float& u0, float& v0, float& u1, float& v1) {
+    int cx = (g % kColumns) * kCellW;
+    int cy = (g / kColumns) * kCellH;
+    u0 = cx / float(kAtlasWidth);
+    v0 = cy / float(kAtlasHeight);
+    u1 = (cx + kCellW) / float(kAtlasWidth);
+    v1 = (cy + kCellH) / float(kAtlasHeight);
+}
+
+} // namespace
+
+bool init() {
+    if (g_ready) return true;
+    PROFILE_ZONE("sdf_text::init");
+    ensure_metrics();
+
+    std::vector<unsigned char> atlas(kAtlasWidth * kAtlasHeight, 0);
+    std::vector<GLfloat> buffer(1 << 14);
+    std::vector<Segment> segments;
+    for (int g = 0; g < kGlyphCount; ++g) {
+        capture_glyph(kFirstChar + g, buffer, segments);
+        if (segments.empty()) continue;
+
+        int cellX = (g % kColumns) * kCellW;
+        int cellY = (g / kColumns) * kCellH;
+        for (int ty = 0; ty < kCellH; ++ty) {
+            for (int tx = 0; tx < kCellW; ++tx) {
+                float fx = (tx + 0.5f) * kUnitsPerTexel - kOriginX;
+                float fy = (ty + 0.5f) * kUnitsPerTexel - kOriginY;
+                float d = 1e9f;
+                for (const Segment& s : segments) d = std::fmin(d, segment_distance(s, fx, fy));
+                float value = 0.5f - (d - kHalfStroke) / kSpread * 0.5f;
+                value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+                atlas[(cellY + ty) * kAtlasWidth + cellX + tx] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    glGenTextures(1, &g_atlas);
+    glBindTexture(GL_TEXTURE_2D, g_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, kAtlasWidth, kAtlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    g_batch.reserve(8192);
+    g_ready = true;
+    return true;
+}
+
+void Label::set(const char* s) {
+    if (text_ == s) return;
+    text_.assign(s);
+    quads_.reserve(text_.size());
+    dirty_ = true;
+}
+
+void Label::layout() const {
+    if (!dirty_) return;
+    ensure_metrics();
+    quads_.clear();
+    float pen = 0.0f;
+    for (char c : text_) {
+        int g = static_cast<unsigned char>(c) - kFirstChar;
+        if (g < 0 || g >= kGlyphCount) continue;
+        if (c != ' ') {
+            Quad q;
+            q.x0 = pen - kOriginX;
+            q.y0 = -kOriginY;
+            q.x1 = q.x0 + kCellW * kUnitsPerTexel;
+            q.y1 = q.y0 + kCellH * kUnitsPerTexel;
+            glyph_rect(g, q.u0, q.v0, q.u1, q.v1);
+            quads_.push_back(q);
+        }
+        pen += g_advance[g];
+    }
+    width_ = pen / kCapHeight;
+    dirty_ = false;
+}
+
+float Label::width() const {
+    layout();
+    return width_;
+}
+
+void draw(const Label& label, const Frame& frame, float x, float y, float z, float height, text::Color color) {
+    if (!g_ready) return;
+    label.layout();
+
+    unsigned char rgba[4];
+    const float in[4] = {color.r, color.g, color.b, color.a};
+    for (int i = 0; i < 4; ++i) {
+        float v = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+        rgba[i] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+
+    float scale = height / kCapHeight;
+    float base[3];
+    for (int a = 0; a < 3; ++a)
+        base[a] = frame.origin[a] + frame.right[a] * x + frame.up[a] * y + frame.forward[a] * z;
+
+    for (const Label::Quad& q : label.quads_) {
+        const float corners[4][4] = {{q.x0, q.y0, q.u0, q.v0},
+                                     {q.x1, q.y0, q.u1, q.v0},
+                                     {q.x1, q.y1, q.u1, q.v1},
+                                     {q.x0, q.y1, q.u0, q.v1}};
+        for (const float* c : corners) {
+            Vertex v;
+            float lx = c[0] * scale, ly = c[1] * scale;
+            v.x = base[0] + frame.right[0] * lx + frame.up[0] * ly;
+            v.y = base[1] + frame.right[1] * lx + frame.up[1] * ly;
+            v.z = base[2] + frame.right[2] * lx + frame.up[2] * ly;
+            v.u = c[2];
+            v.v = c[3];
+            std::memcpy(v.rgba, rgba, 4);
+            g_batch.push_back(v);
+        }
+    }
+}
+
+void reserve(std::size_t glyphs) {
+    g_batch.reserve(glyphs * 4);
+}
+
+void flush() {
+    if (g_batch.empty()) return;
+    PROFILE_ZONE("sdf_text::flush");
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5f);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, g_atlas);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &g_batch[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &g_batch[0].u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), g_batch[0].rgba);
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(g_batch.size()));
+    glPopClientAttrib();
+
+    glPopAttrib();
+    g_batch.clear();
+}
+
+} // namespace sdf_text
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "text.h"
+
+// Signed-distance-field text for labels that live in the world (tooltip
+// panels).
+//
+// The glyphs come from the GLUT stroke font: init() records each
+// character's line segments with GL_FEEDBACK and computes the distance to
+// the nearest stroke for every atlas texel, so edges stay sharp at any
+// size. Labels are drawn as alpha-tested quads placed in a caller-supplied
+// frame (e.g. a billboard), and everything queued in a frame is drawn by
+// one flush(). Depth testing stays on so labels sort against each other
+// and against panels that write depth.
+namespace sdf_text {
+
+// Placement of a label: a point plus the frame's right / up / forward axes
+// (forward points towards the viewer), all in world space.
+struct Frame {
+    float origin[3];
+    float right[3];
+    float up[3];
+    float forward[3];
+};
+
+// A string laid out once in font units; set() only invalidates the layout
+// when the text changes, and reserves room so drawing never allocates.
+class Label {
+public:
+    Label() = default;
+    explicit Label(const std::string& s) { set(s.c_str()); }
+
+    void set(const char* s);
+    const std::string& str() const { return text_; }
+    // Advance width for a cap height of 1.
+    float width() const;
+
+private:
+    struct Quad {
+        float x0, y0, x1, y1; // font units from the pen position
+        float u0, v0, u1, v1;
+    };
+
+    void layout() const;
+
+    std::string text_;
+    mutable std::vector<Quad> quads_;
+    mutable float width_ = 0.0f;
+    mutable bool dirty_ = true;
+
+    friend void draw(const Label& label, const Frame& frame, float x, float y, float z, float height,
+                     text::Color color);
+};
+
+// Build the atlas; needs a current GL context. Call once at startup.
+bool init();
+
+// Queue label with its baseline starting at (x, y, z) in frame coordinates;
+// height is the cap height in world units.
+void draw(const Label& label, const Frame& frame, float x, float y, float z, float height, text::Color color);
+
+// Room for this many glyphs queued between flushes, so draw() does not
+// allocate.
+void reserve(std::size_t glyphs);
+
+// Draw everything queued since the last flush.
+void flush();
+
+} // namespace sdf_text
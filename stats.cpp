@@ -1,9 +1,28 @@
 #include "stats.h"
+#include "audio.h"
+#include "flight.h"
+#include "framelog.h"
+#include "profiler.h"
+#include "text.h"
 
 #include <GL/glut.h>
+#include <GL/freeglut.h>
+#include "glcount.h"
 #include <chrono>
+#include <cmath>
 #include <cstdio>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
 
 namespace stats {
 
@@ -16,17 +35,279 @@ clock_t::time_point g_frameStart;
 
 bool g_inited = false;
 
-// Simple CSV logging of per-frame metrics for offline analysis.
-std::ofstream g_csv;
-bool g_csvReady = false;
+// Per-frame context recorded in the frame log for offline analysis.
 int g_ctxPage = 0;
 bool g_ctxMotion = false;
 
-void drawText(float x, float y, const char* text) {
-    glRasterPos2f(x, y);
-    for (const char* c = text; *c != '\0'; ++c) {
-        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+// GPU timer queries (GL 3.3 / ARB_timer_query), loaded at runtime since the
+// Windows GL headers only expose 1.1. Each frame owns one slot of begin/end
+// timestamps per pass; a slot is only read back kGpuLatency frames later.
+typedef void (GLAPIENTRY* GenQueriesFn)(GLsizei n, GLuint* ids);
+typedef void (GLAPIENTRY* DeleteQueriesFn)(GLsizei n, const GLuint* ids);
+typedef void (GLAPIENTRY* QueryCounterFn)(GLuint id, GLenum target);
+typedef void (GLAPIENTRY* GetQueryObjectivFn)(GLuint id, GLenum pname, GLint* params);
+typedef void (GLAPIENTRY* GetQueryObjectui64vFn)(GLuint id, GLenum pname, unsigned long long* params);
+
+GenQueriesFn g_glGenQueries = nullptr;
+DeleteQueriesFn g_glDeleteQueries = nullptr;
+QueryCounterFn g_glQueryCounter = nullptr;
+GetQueryObjectivFn g_glGetQueryObjectiv = nullptr;
+GetQueryObjectui64vFn g_glGetQueryObjectui64v = nullptr;
+
+const int kPassCount = static_cast<int>(Pass::Count);
+static_assert(kPassCount == framelog::kGpuPasses, "frame log GPU columns must match stats::Pass");
+const int kGpuLatency = 4;
+
+struct GpuSlot {
+    GLuint queries[kPassCount][2];
+    bool issued[kPassCount];
+    unsigned long long frame = 0;
+};
+
+// Log-bucketed (HDR-style) histogram of frame times in microseconds: values
+// below 16 us get exact buckets, above that each power of two is split into
+// 16 linear sub-buckets (~6% resolution) up to ~16 s.
+const int kSubBits = 4;
+const int kSubBuckets = 1 << kSubBits;
+const int kMaxExponent = 24;
+const int kBucketCount = (kMaxExponent - kSubBits + 2) * kSubBuckets;
+
+unsigned int g_histogram[kBucketCount];
+int g_histogramCount = 0;
+
+// Rolling window of the most recent frames (and deltas between them).
+double g_windowMs[kWindowFrames];
+int g_windowHead = 0;
+int g_windowSize = 0;
+double g_deltaSum = 0.0;
+double g_deltaSumSq = 0.0;
+
+// Recent frame times for the sparkline.
+const int kSparkFrames = 120;
+float g_spark[kSparkFrames];
+int g_sparkHead = 0;
+
+int bucket_index(double ms) {
+    double us = ms * 1000.0;
+    unsigned int v = us <= 0.0 ? 0u : (us >= double(1u << kMaxExponent) ? (1u << kMaxExponent) - 1u : static_cast<unsigned int>(us));
+    if (v < static_cast<unsigned int>(kSubBuckets)) return static_cast<int>(v);
+    int exponent = 0;
+    for (unsigned int t = v; t > 1u; t >>= 1) ++exponent;
+    int sub = static_cast<int>((v >> (exponent - kSubBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBits + 1) * kSubBuckets + sub;
+}
+
+// Midpoint of a bucket, in milliseconds.
+double bucket_value(int index) {
+    if (index < kSubBuckets) return index / 1000.0;
+    int exponent = index / kSubBuckets + kSubBits - 1;
+    int sub = index % kSubBuckets;
+    double width = double(1u << (exponent - kSubBits));
+    double low = double(1u << exponent) + sub * width;
+    return (low + width * 0.5) / 1000.0;
+}
+
+bool frame_over_budget(double ms) {
+    return ms > g_metrics.frameBudgetMs;
+}
+
+void window_add(double frameMs) {
+    if (g_windowSize == kWindowFrames) {
+        // Evict the oldest frame and its delta to the next one.
+        int oldest = g_windowHead;
+        double delta = g_windowMs[(oldest + 1) % kWindowFrames] - g_windowMs[oldest];
+        g_deltaSum -= delta;
+        g_deltaSumSq -= delta * delta;
+        g_histogram[bucket_index(g_windowMs[oldest])]--;
+        g_histogramCount--;
+        if (frame_over_budget(g_windowMs[oldest])) g_metrics.overBudgetWindow--;
+        g_windowHead = (oldest + 1) % kWindowFrames;
+        g_windowSize--;
+    }
+    if (g_windowSize > 0) {
+        double delta = frameMs - g_windowMs[(g_windowHead + g_windowSize - 1) % kWindowFrames];
+        g_deltaSum += delta;
+        g_deltaSumSq += delta * delta;
+    }
+    g_windowMs[(g_windowHead + g_windowSize) % kWindowFrames] = frameMs;
+    g_windowSize++;
+    g_histogram[bucket_index(frameMs)]++;
+    g_histogramCount++;
+    if (frame_over_budget(frameMs)) {
+        g_metrics.overBudgetWindow++;
+        g_metrics.overBudgetTotal++;
+    }
+}
+
+void update_distribution() {
+    const double targets[4] = {0.50, 0.95, 0.99, 0.999};
+    double* outputs[4] = {&g_metrics.p50Ms, &g_metrics.p95Ms, &g_metrics.p99Ms, &g_metrics.p999Ms};
+    int next = 0;
+    unsigned int seen = 0;
+    int highest = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        if (!g_histogram[i]) continue;
+        seen += g_histogram[i];
+        highest = i;
+        while (next < 4 && seen >= targets[next] * g_histogramCount) *outputs[next++] = bucket_value(i);
+    }
+    g_metrics.windowMaxMs = bucket_value(highest);
+
+    int deltas = g_windowSize - 1;
+    if (deltas > 0) {
+        double mean = g_deltaSum / deltas;
+        double variance = g_deltaSumSq / deltas - mean * mean;
+        g_metrics.jitterMs = variance > 0.0 ? std::sqrt(variance) : 0.0;
+    }
+}
+
+void draw_sparkline(float left, float top, float width, float height) {
+    // Scale to twice the budget so the budget line sits halfway up.
+    float scale = static_cast<float>(height / (2.0 * g_metrics.frameBudgetMs));
+    float step = width / (kSparkFrames - 1);
+
+    glColor4f(0.0f, 0.0f, 0.0f, 0.5f);
+    glRectf(left, top - height, left + width, top);
+
+    glColor3f(0.6f, 0.6f, 0.6f);
+    glBegin(GL_LINES);
+    glVertex2f(left, top - height * 0.5f);
+    glVertex2f(left + width, top - height * 0.5f);
+    glEnd();
+
+    glBegin(GL_LINE_STRIP);
+    for (int i = 0; i < kSparkFrames; ++i) {
+        float ms = g_spark[(g_sparkHead + i) % kSparkFrames];
+        float h = ms * scale;
+        if (h > height) h = height;
+        if (frame_over_budget(ms)) glColor3f(1.0f, 0.3f, 0.2f);
+        else glColor3f(0.2f, 1.0f, 0.4f);
+        glVertex2f(left + i * step, top - height + h);
+    }
+    glEnd();
+}
+
+GpuSlot g_gpuSlots[kGpuLatency];
+int g_gpuSlot = 0;
+bool g_gpuReady = false;
+
+bool has_extension(const char* name) {
+    const char* ext = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (!ext) return false;
+    size_t len = std::strlen(name);
+    for (const char* p = std::strstr(ext, name); p; p = std::strstr(p + len, name)) {
+        if ((p == ext || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return true;
+    }
+    return false;
+}
+
+void gpu_init() {
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    int major = 0, minor = 0;
+    if (version) std::sscanf(version, "%d.%d", &major, &minor);
+    bool core = major > 3 || (major == 3 && minor >= 3);
+    if (!core && !has_extension("GL_ARB_timer_query")) return;
+
+    g_glGenQueries = reinterpret_cast<GenQueriesFn>(glutGetProcAddress("glGenQueries"));
+    g_glDeleteQueries = reinterpret_cast<DeleteQueriesFn>(glutGetProcAddress("glDeleteQueries"));
+    g_glQueryCounter = reinterpret_cast<QueryCounterFn>(glutGetProcAddress("glQueryCounter"));
+    g_glGetQueryObjectiv = reinterpret_cast<GetQueryObjectivFn>(glutGetProcAddress("glGetQueryObjectiv"));
+    g_glGetQueryObjectui64v = reinterpret_cast<GetQueryObjectui64vFn>(glutGetProcAddress("glGetQueryObjectui64v"));
+    if (!g_glGenQueries || !g_glDeleteQueries || !g_glQueryCounter || !g_glGetQueryObjectiv || !g_glGetQueryObjectui64v)
+        return;
+
+    for (GpuSlot& slot : g_gpuSlots) {
+        g_glGenQueries(kPassCount * 2, &slot.queries[0][0]);
+        for (bool& issued : slot.issued) issued = false;
+    }
+    g_gpuReady = true;
+    g_metrics.gpuTimersAvailable = true;
+}
+
+// Read back the slot about to be reused. Results that are still in flight are
+// skipped rather than waited on.
+void gpu_collect(GpuSlot& slot) {
+    bool any = false;
+    double passMs[kPassCount] = {};
+    double total = 0.0;
+    for (int p = 0; p < kPassCount; ++p) {
+        if (!slot.issued[p]) continue;
+        GLint available = 0;
+        g_glGetQueryObjectiv(slot.queries[p][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        unsigned long long t0 = 0, t1 = 0;
+        g_glGetQueryObjectui64v(slot.queries[p][0], GL_QUERY_RESULT, &t0);
+        g_glGetQueryObjectui64v(slot.queries[p][1], GL_QUERY_RESULT, &t1);
+        passMs[p] = t1 > t0 ? static_cast<double>(t1 - t0) / 1.0e6 : 0.0;
+        total += passMs[p];
+        any = true;
+    }
+    if (!any) return;
+    for (int p = 0; p < kPassCount; ++p) g_metrics.gpuPassMs[p] = passMs[p];
+    g_metrics.gpuFrameMs = total;
+    g_metrics.gpuFrame = slot.frame;
+}
+
+// One cached label per overlay line; only lines whose text changed are laid out again.
+const int kOverlayLines = 7;
+text::Label g_lines[kOverlayLines];
+
+// The overlay text is a cached layer, reformatted at g_overlayInterval or
+// when the window is resized.
+text::Layer g_overlayLayer;
+double g_overlayInterval = 0.25;
+clock_t::time_point g_overlayRefreshed;
+int g_overlayHeight = -1;
+
+void drawText(int line, float x, float y, const char* s) {
+    g_lines[line].set(s, text::Font::Fixed8x13);
+    g_overlayLayer.label(g_lines[line], x, y, {1.0f, 1.0f, 0.0f, 1.0f});
+}
+
+void build_overlay_text(float top) {
+    PROFILE_ZONE("stats::build_overlay_text");
+    g_overlayLayer.clear();
+
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer), "FPS: %.1f (avg %.1f)", g_metrics.currentFps, g_metrics.avgFps);
+    drawText(0, 10.0f, top - 20.0f, buffer);
+
+    std::snprintf(buffer, sizeof(buffer), "Frame ms: %.2f (min %.2f / max %.2f)",
+                  g_metrics.lastFrameMs, g_metrics.minFrameMs, g_metrics.maxFrameMs);
+    drawText(1, 10.0f, top - 40.0f, buffer);
+
+    double pixelsPerFrame = static_cast<double>(g_metrics.width) * static_cast<double>(g_metrics.height);
+    double pixelsPerSecond = pixelsPerFrame * g_metrics.currentFps;
+    std::snprintf(buffer, sizeof(buffer), "Resolution: %dx%d, Throughput: %.0f px/s",
+                  g_metrics.width, g_metrics.height, pixelsPerSecond);
+    drawText(2, 10.0f, top - 60.0f, buffer);
+
+    if (g_metrics.gpuTimersAvailable) {
+        const double* gpu = g_metrics.gpuPassMs;
+        std::snprintf(buffer, sizeof(buffer), "GPU ms: %.2f (room %.2f, cpu %.2f, glass %.2f, tips %.2f, hud %.2f)",
+                      g_metrics.gpuFrameMs, gpu[0], gpu[1], gpu[2], gpu[3], gpu[4]);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "GPU ms: timer queries unavailable");
     }
+    drawText(3, 10.0f, top - 80.0f, buffer);
+
+    std::snprintf(buffer, sizeof(buffer), "p50 %.2f p95 %.2f p99 %.2f p99.9 %.2f | jitter %.2f | over budget %d/%d",
+                  g_metrics.p50Ms, g_metrics.p95Ms, g_metrics.p99Ms, g_metrics.p999Ms, g_metrics.jitterMs,
+                  g_metrics.overBudgetWindow, g_windowSize);
+    drawText(4, 10.0f, top - 100.0f, buffer);
+
+    audio::MemoryStats sound = audio::memory_stats();
+    std::snprintf(buffer, sizeof(buffer), "Audio: %.2f MB resident (%.2f MB as PCM), %d sounds",
+                  sound.residentBytes / 1048576.0, sound.pcmBytes / 1048576.0, sound.sounds);
+    drawText(5, 10.0f, top - 120.0f, buffer);
+
+    const TextureUploads& bc1 = g_metrics.textures[static_cast<int>(TextureFormat::Bc1)];
+    const TextureUploads& bgr8 = g_metrics.textures[static_cast<int>(TextureFormat::Bgr8)];
+    std::snprintf(buffer, sizeof(buffer),
+                  "Textures: BC1 %d (%.1f MB, upload %.1f ms) | BGR8 %d (%.1f MB, upload %.1f ms, BC1 decode %.1f ms)",
+                  bc1.textures, bc1.megabytes, bc1.uploadMs, bgr8.textures, bgr8.megabytes, bgr8.uploadMs,
+                  bgr8.decompressMs);
+    drawText(6, 10.0f, top - 140.0f, buffer);
 }
 
 } // namespace
@@ -34,6 +315,8 @@ void drawText(float x, float y, const char* text) {
 void init() {
     if (g_inited) return;
     g_startTime = clock_t::now();
+    gpu_init();
+    if (framelog::start()) std::atexit(framelog::stop);
     g_inited = true;
 }
 
@@ -42,6 +325,19 @@ void set_resolution(int w, int h) {
     g_metrics.height = h;
 }
 
+void set_frame_budget(double ms) {
+    if (ms <= 0.0) return;
+    g_metrics.frameBudgetMs = ms;
+    // Recount so evictions stay consistent with the new budget.
+    g_metrics.overBudgetWindow = 0;
+    for (int i = 0; i < g_windowSize; ++i)
+        if (frame_over_budget(g_windowMs[(g_windowHead + i) % kWindowFrames])) g_metrics.overBudgetWindow++;
+}
+
+void set_overlay_rate(double hz) {
+    g_overlayInterval = hz > 0.0 ? 1.0 / hz : 0.0;
+}
+
 void set_frame_context(int page, bool motion_present) {
     g_ctxPage = page;
     g_ctxMotion = motion_present;
@@ -50,6 +346,28 @@ void set_frame_context(int page, bool motion_present) {
 void frame_start() {
     if (!g_inited) init();
     g_frameStart = clock_t::now();
+    flight::frame_mark();
+
+    if (g_gpuReady) {
+        g_gpuSlot = (g_gpuSlot + 1) % kGpuLatency;
+        GpuSlot& slot = g_gpuSlots[g_gpuSlot];
+        gpu_collect(slot);
+        for (bool& issued : slot.issued) issued = false;
+        slot.frame = g_metrics.frameCount + 1;
+    }
+}
+
+void gpu_pass_begin(Pass pass) {
+    if (!g_gpuReady) return;
+    GpuSlot& slot = g_gpuSlots[g_gpuSlot];
+    g_glQueryCounter(slot.queries[static_cast<int>(pass)][0], GL_TIMESTAMP);
+}
+
+void gpu_pass_end(Pass pass) {
+    if (!g_gpuReady) return;
+    GpuSlot& slot = g_gpuSlots[g_gpuSlot];
+    g_glQueryCounter(slot.queries[static_cast<int>(pass)][1], GL_TIMESTAMP);
+    slot.issued[static_cast<int>(pass)] = true;
 }
 
 void frame_end() {
@@ -72,34 +390,36 @@ void frame_end() {
         g_metrics.avgFps = static_cast<double>(g_metrics.frameCount) / secondsSinceStart;
     }
 
-    // Lazy-open CSV on first frame and write header.
-    if (!g_csvReady) {
-        g_csv.open("performance_log.csv", std::ios::out | std::ios::trunc);
-        if (g_csv.is_open()) {
-            g_csv << "frame,time_s,frame_ms,fps,avg_fps,min_ms,max_ms,width,height,pixels_per_frame,pixels_per_second,page,motion_present" << '\n';
-            g_csvReady = true;
-        }
-    }
+    window_add(frameMs);
+    update_distribution();
+    g_spark[g_sparkHead] = static_cast<float>(frameMs);
+    g_sparkHead = (g_sparkHead + 1) % kSparkFrames;
 
-    if (g_csvReady) {
-        double pixelsPerFrame = static_cast<double>(g_metrics.width) * static_cast<double>(g_metrics.height);
-        double pixelsPerSecond = pixelsPerFrame * g_metrics.currentFps;
-        g_csv
-            << g_metrics.frameCount << ','
-            << secondsSinceStart << ','
-            << g_metrics.lastFrameMs << ','
-            << g_metrics.currentFps << ','
-            << g_metrics.avgFps << ','
-            << g_metrics.minFrameMs << ','
-            << g_metrics.maxFrameMs << ','
-            << g_metrics.width << ','
-            << g_metrics.height << ','
-            << pixelsPerFrame << ','
-            << pixelsPerSecond << ','
-            << g_ctxPage << ','
-            << (g_ctxMotion ? 1 : 0)
-            << '\n';
-    }
+    // Hand the record to the background writer; no formatting or I/O here.
+    framelog::FrameRecord record = {};
+    record.frame = g_metrics.frameCount;
+    record.gpuFrame = g_metrics.gpuFrame;
+    record.timeS = secondsSinceStart;
+    record.frameMs = static_cast<float>(g_metrics.lastFrameMs);
+    record.fps = static_cast<float>(g_metrics.currentFps);
+    record.avgFps = static_cast<float>(g_metrics.avgFps);
+    record.minMs = static_cast<float>(g_metrics.minFrameMs);
+    record.maxMs = static_cast<float>(g_metrics.maxFrameMs);
+    for (int p = 0; p < kPassCount; ++p) record.gpuPassMs[p] = static_cast<float>(g_metrics.gpuPassMs[p]);
+    record.gpuTotalMs = static_cast<float>(g_metrics.gpuFrameMs);
+    record.width = static_cast<std::uint16_t>(g_metrics.width);
+    record.height = static_cast<std::uint16_t>(g_metrics.height);
+    record.page = static_cast<std::uint8_t>(g_ctxPage);
+    record.motionPresent = g_ctxMotion ? 1 : 0;
+    framelog::push(record);
+}
+
+void record_texture(TextureFormat format, double bytes, double uploadMs, double decompressMs) {
+    TextureUploads& uploads = g_metrics.textures[static_cast<int>(format)];
+    uploads.textures++;
+    uploads.megabytes += bytes / 1048576.0;
+    uploads.uploadMs += uploadMs;
+    uploads.decompressMs += decompressMs;
 }
 
 const Metrics& get() {
@@ -121,21 +441,21 @@ void draw_overlay() {
     glPushMatrix();
     glLoadIdentity();
 
-    glColor3f(1.0f, 1.0f, 0.0f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    draw_sparkline(460.0f, (g_metrics.height ? g_metrics.height : 600.0f) - 8.0f, 240.0f, 56.0f);
 
-    char buffer[256];
-    std::snprintf(buffer, sizeof(buffer), "FPS: %.1f (avg %.1f)", g_metrics.currentFps, g_metrics.avgFps);
-    drawText(10.0f, (g_metrics.height ? g_metrics.height : 600.0f) - 20.0f, buffer);
-
-    std::snprintf(buffer, sizeof(buffer), "Frame ms: %.2f (min %.2f / max %.2f)",
-                  g_metrics.lastFrameMs, g_metrics.minFrameMs, g_metrics.maxFrameMs);
-    drawText(10.0f, (g_metrics.height ? g_metrics.height : 600.0f) - 40.0f, buffer);
-
-    double pixelsPerFrame = static_cast<double>(g_metrics.width) * static_cast<double>(g_metrics.height);
-    double pixelsPerSecond = pixelsPerFrame * g_metrics.currentFps;
-    std::snprintf(buffer, sizeof(buffer), "Resolution: %dx%d, Throughput: %.0f px/s",
-                  g_metrics.width, g_metrics.height, pixelsPerSecond);
-    drawText(10.0f, (g_metrics.height ? g_metrics.height : 600.0f) - 60.0f, buffer);
+    // The text only changes every g_overlayInterval; in between the cached
+    // layer is drawn as is.
+    clock_t::time_point now = clock_t::now();
+    std::chrono::duration<double> sinceRefresh = now - g_overlayRefreshed;
+    if (g_overlayLayer.empty() || g_overlayHeight != g_metrics.height ||
+        sinceRefresh.count() >= g_overlayInterval) {
+        build_overlay_text(g_metrics.height ? g_metrics.height : 600.0f);
+        g_overlayRefreshed = now;
+        g_overlayHeight = g_metrics.height;
+    }
+    g_overlayLayer.draw();
 
     // Restore matrices
     glPopMatrix(); // modelview
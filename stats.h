@@ -4,6 +4,31 @@
 
 namespace stats {
 
+// Render passes timed on the GPU with timer queries (when the driver supports them).
+enum class Pass {
+    Room,
+    Components,
+    Glass,
+    Tooltips,
+    Hud,
+    Count
+};
+
+// Formats textures are stored in on the GPU.
+enum class TextureFormat {
+    Bgr8,
+    Bc1,
+    Count
+};
+
+// Textures uploaded in one format at startup.
+struct TextureUploads {
+    int textures = 0;
+    double megabytes = 0.0;    // texture memory; drivers pad BGR8 to 4 bytes a texel
+    double uploadMs = 0.0;     // GL calls until the upload completes (glFinish)
+    double decompressMs = 0.0; // BC1 decoded on the CPU because the driver lacks S3TC
+};
+
 struct Metrics {
     double currentFps = 0.0;
     double avgFps = 0.0;
@@ -11,16 +36,56 @@ struct Metrics {
     double maxFrameMs = 0.0;
     double lastFrameMs = 0.0;
     unsigned long long frameCount = 0;
+    // Rolling-window distribution over the last kWindowFrames frames.
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double p999Ms = 0.0;
+    double windowMaxMs = 0.0;
+    double jitterMs = 0.0; // standard deviation of frame-to-frame deltas
+    double frameBudgetMs = 1000.0 / 60.0;
+    int overBudgetWindow = 0;
+    unsigned long long overBudgetTotal = 0;
     int width = 0;
     int height = 0;
+    // GPU time per pass, resolved a few frames after submission (see gpuFrame).
+    bool gpuTimersAvailable = false;
+    double gpuPassMs[static_cast<int>(Pass::Count)] = {};
+    double gpuFrameMs = 0.0;
+    unsigned long long gpuFrame = 0;
+    TextureUploads textures[static_cast<int>(TextureFormat::Count)];
 };
 
+// Frames covered by the rolling percentile / jitter window.
+const int kWindowFrames = 600;
+
 void init();
 void set_resolution(int w, int h);
+// Frames slower than this count as over budget (default 60 Hz).
+void set_frame_budget(double ms);
+// How often the overlay text is reformatted (default 4 Hz; <= 0 means every frame).
+void set_overlay_rate(double hz);
 // Optional per-frame context for logs (e.g., page, motion flag).
 void set_frame_context(int page, bool motion_present);
 void frame_start();
 void frame_end();
+// Bracket a render pass with GPU timestamps. Results are read back with a
+// multi-frame latency so the pipeline never stalls; no-ops without timer queries.
+void gpu_pass_begin(Pass pass);
+void gpu_pass_end(Pass pass);
+// Times a pass for the rest of the scope, so begin and end always pair up.
+class GpuPassScope {
+public:
+    explicit GpuPassScope(Pass pass) : pass_(pass) { gpu_pass_begin(pass_); }
+    ~GpuPassScope() { gpu_pass_end(pass_); }
+    GpuPassScope(const GpuPassScope&) = delete;
+    GpuPassScope& operator=(const GpuPassScope&) = delete;
+
+private:
+    Pass pass_;
+};
+// Account for a texture upload (decompressMs is worker-thread time, summed).
+void record_texture(TextureFormat format, double bytes, double uploadMs, double decompressMs);
 const Metrics& get();
 
 // Draw small overlay with key metrics in the top-left corner.
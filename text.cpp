@@ -0,0 +1,415 @@
+#include "text.h"
+#include "camera.h"
+#include "profiler.h"
+
+#include <GL/glut.h>
+#include <GL/freeglut.h>
+#include "glcount.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace text {
+
+namespace {
+
+const int kFirstChar = 32;
+const int kGlyphCount = 96; // printable ASCII 32..127
+const int kAtlasColumns = 32;
+const int kAtlasRows = kGlyphCount / kAtlasColumns;
+const int kAtlasWidth = 1024;
+const int kAtlasHeight = 512;
+const int kPadX = 2;
+const int kFontCount = static_cast<int>(Font::Count);
+// Solid white block in the atlas' top-right corner, for Layer rectangles.
+const int kWhiteSize = 4;
+const float kWhiteU = (kAtlasWidth - kWhiteSize / 2) / float(kAtlasWidth);
+const float kWhiteV = (kAtlasHeight - kWhiteSize / 2) / float(kAtlasHeight);
+
+struct FontInfo {
+    void* glutFont;
+    int cellW;
+    int cellH;
+    int baseline; // pixels from the cell bottom to the pen
+    int atlasY;   // first atlas row of this font
+    int advance[kGlyphCount];
+};
+
+FontInfo g_fonts[kFontCount];
+bool g_metricsReady = false;
+bool g_baked = false;
+GLuint g_atlas = 0;
+
+// Screen mapping for world strings, refreshed by begin_frame().
+float g_viewProj[16];
+int g_viewport[4] = {0, 0, 1, 1};
+
+// Screen strings, drawn on top of the frame.
+std::vector<Vertex> g_batch;
+// World strings, depth-tested at their anchor's depth like glRasterPos3f text.
+std::vector<Vertex> g_worldBatch;
+
+void ensure_metrics() {
+    if (g_metricsReady) return;
+    void* glutFonts[kFontCount] = {GLUT_BITMAP_HELVETICA_18, GLUT_BITMAP_HELVETICA_12,
+                                   GLUT_BITMAP_TIMES_ROMAN_10, GLUT_BITMAP_8_BY_13};
+    int atlasY = 0;
+    for (int f = 0; f < kFontCount; ++f) {
+        FontInfo& font = g_fonts[f];
+        font.glutFont = glutFonts[f];
+        int maxAdvance = 0;
+        for (int g = 0; g < kGlyphCount; ++g) {
+            font.advance[g] = glutBitmapWidth(font.glutFont, kFirstChar + g);
+            if (font.advance[g] > maxAdvance) maxAdvance = font.advance[g];
+        }
+        int height = glutBitmapHeight(font.glutFont);
+        // Generous cells: the GLUT API does not expose ascent / descent.
+        font.cellW = maxAdvance + 2 * kPadX;
+        font.cellH = height + 6;
+        font.baseline = height / 4 + 2;
+        font.atlasY = atlasY;
+        atlasY += font.cellH * kAtlasRows;
+    }
+    g_batch.reserve(16384);
+    g_worldBatch.reserve(4096);
+    g_metricsReady = true;
+}
+
+// Draw each font's glyphs into the back buffer and copy them into the atlas.
+// Runs before the frame's glClear, so the scratch pixels are never shown.
+// A font strip wider or taller than the window is baked in several passes,
+// one block of cells that fits at a time; only a window smaller than a
+// single cell (e.g. minimized) fails, and the bake is retried next frame.
+bool bake() {
+    PROFILE_ZONE("text::bake");
+    ensure_metrics();
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    for (const FontInfo& font : g_fonts) {
+        if (font.cellW > viewport[2] || font.cellH > viewport[3]) return false;
+    }
+
+    std::vector<unsigned char> atlas(kAtlasWidth * kAtlasHeight, 0);
+    std::vector<unsigned char> pixels;
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_DITHER);
+    glDisable(GL_FOG);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0.0, viewport[2], 0.0, viewport[3]);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_BACK);
+    glDrawBuffer(GL_BACK);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    for (const FontInfo& font : g_fonts) {
+        int passCols = std::min(kAtlasColumns, int(viewport[2]) / font.cellW);
+        int passRows = std::min(kAtlasRows, int(viewport[3]) / font.cellH);
+        for (int row0 = 0; row0 < kAtlasRows; row0 += passRows) {
+            for (int col0 = 0; col0 < kAtlasColumns; col0 += passCols) {
+                int cols = std::min(passCols, kAtlasColumns - col0);
+                int rows = std::min(passRows, kAtlasRows - row0);
+                glClear(GL_COLOR_BUFFER_BIT);
+                for (int r = 0; r < rows; ++r) {
+                    for (int c = 0; c < cols; ++c) {
+                        int g = (row0 + r) * kAtlasColumns + col0 + c;
+                        // A quarter-pixel offset keeps the bitmap origin from rounding down.
+                        glRasterPos2f(c * font.cellW + kPadX + 0.25f, r * font.cellH + font.baseline + 0.25f);
+                        glutBitmapCharacter(font.glutFont, kFirstChar + g);
+                    }
+                }
+
+                int w = cols * font.cellW;
+                int h = rows * font.cellH;
+                pixels.resize(w * h);
+                glReadPixels(viewport[0], viewport[1], w, h, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+                int atlasX = col0 * font.cellW;
+                int atlasY = font.atlasY + row0 * font.cellH;
+                for (int row = 0; row < h; ++row)
+                    std::memcpy(&atlas[(atlasY + row) * kAtlasWidth + atlasX], &pixels[row * w], w);
+            }
+        }
+    }
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+
+    for (int row = kAtlasHeight - kWhiteSize; row < kAtlasHeight; ++row)
+        std::memset(&atlas[row * kAtlasWidth + kAtlasWidth - kWhiteSize], 255, kWhiteSize);
+
+    if (!g_atlas) glGenTextures(1, &g_atlas);
+    glBindTexture(GL_TEXTURE_2D, g_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, kAtlasWidth, kAtlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void glyph_rect(const FontInfo& font, int g, float& u0, float& v0, float& u1, float& v1) {
+    int cx = (g % kAtlasColumns) * font.cellW;
+    int cy = font.atlasY + (g / kAtlasColumns) * font.cellH;
+    u0 = cx / float(kAtlasWidth);
+    v0 = cy / float(kAtlasHeight);
+    u1 = (cx + font.cellW) / float(kAtlasWidth);
+    v1 = (cy + font.cellH) / float(kAtlasHeight);
+}
+
+void push_quad(std::vector<Vertex>& out, float x0, float y0, float x1, float y1, float z, float u0, float v0,
+               float u1, float v1, const unsigned char* rgba) {
+    Vertex v[4] = {{x0, y0, z, u0, v0, {}}, {x1, y0, z, u1, v0, {}}, {x1, y1, z, u1, v1, {}}, {x0, y1, z, u0, v1, {}}};
+    for (Vertex& vert : v) {
+        std::memcpy(vert.rgba, rgba, 4);
+        out.push_back(vert);
+    }
+}
+
+// Draw window-space vertices with the atlas bound. Without depthTest they go
+// on top of the frame; with it, each vertex z is its window depth and glyphs
+// behind the scene's geometry are hidden (without writing depth themselves).
+void draw_vertices(const std::vector<Vertex>& vertices, bool depthTest) {
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+    glDisable(GL_LIGHTING);
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, g_atlas);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    // z in [0, 1] maps straight to window depth.
+    glOrtho(0.0, g_viewport[2], 0.0, g_viewport[3], 0.0, -1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vertices[0].u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), vertices[0].rgba);
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(vertices.size()));
+    glPopClientAttrib();
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+void to_bytes(Color c, unsigned char* rgba) {
+    const float in[4] = {c.r, c.g, c.b, c.a};
+    for (int i = 0; i < 4; ++i) {
+        float v = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+        rgba[i] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+}
+
+// Window pixel and depth for a world point, like glRasterPos3f. False when
+// the point is clipped, in which case GL would mark the raster position
+// invalid.
+bool project(float x, float y, float z, float& px, float& py, float& pz) {
+    const float* m = g_viewProj;
+    float cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+    float cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+    float cz = m[2] * x + m[6] * y + m[10] * z + m[14];
+    float cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+    if (cw <= 0.0f || std::fabs(cx) > cw || std::fabs(cy) > cw || std::fabs(cz) > cw) return false;
+    px = g_viewport[0] + (cx / cw + 1.0f) * 0.5f * g_viewport[2];
+    py = g_viewport[1] + (cy / cw + 1.0f) * 0.5f * g_viewport[3];
+    pz = (cz / cw + 1.0f) * 0.5f;
+    return true;
+}
+
+void emit(std::vector<Vertex>& out, Font f, const char* s, float x, float y, float z, Color color) {
+    if (!g_baked) return;
+    const FontInfo& font = g_fonts[static_cast<int>(f)];
+    unsigned char rgba[4];
+    to_bytes(color, rgba);
+    float pen = std::floor(x);
+    float base = std::floor(y);
+    for (const char* c = s; *c; ++c) {
+        int g = static_cast<unsigned char>(*c) - kFirstChar;
+        if (g < 0 || g >= kGlyphCount) continue;
+        if (*c != ' ') {
+            float u0, v0, u1, v1;
+            glyph_rect(font, g, u0, v0, u1, v1);
+            float x0 = pen - kPadX, y0 = base - font.baseline;
+            push_quad(out, x0, y0, x0 + font.cellW, y0 + font.cellH, z, u0, v0, u1, v1, rgba);
+        }
+        pen += font.advance[g];
+    }
+}
+
+} // namespace
+
+void Label::set(const char* s, Font f) {
+    if (f == font_ && text_ == s) return;
+    text_.assign(s);
+    font_ = f;
+    quads_.reserve(text_.size());
+    dirty_ = true;
+}
+
+void Label::layout() const {
+    if (!dirty_) return;
+    ensure_metrics();
+    const FontInfo& font = g_fonts[static_cast<int>(font_)];
+    quads_.clear();
+    int pen = 0;
+    for (char c : text_) {
+        int g = static_cast<unsigned char>(c) - kFirstChar;
+        if (g < 0 || g >= kGlyphCount) continue;
+        if (c != ' ') {
+            Quad q;
+            q.x0 = float(pen - kPadX);
+            q.y0 = float(-font.baseline);
+            q.x1 = q.x0 + font.cellW;
+            q.y1 = q.y0 + font.cellH;
+            glyph_rect(font, g, q.u0, q.v0, q.u1, q.v1);
+            quads_.push_back(q);
+        }
+        pen += font.advance[g];
+    }
+    width_ = pen;
+    dirty_ = false;
+}
+
+int Label::width() const {
+    layout();
+    return width_;
+}
+
+void begin_frame(const Camera& camera) {
+    if (!g_baked) g_baked = bake();
+
+    // viewProj = projection * view (column-major).
+    const float* p = camera.projection();
+    const float* v = camera.view();
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) sum += p[k * 4 + r] * v[c * 4 + k];
+            g_viewProj[c * 4 + r] = sum;
+        }
+    g_viewport[2] = camera.viewportWidth();
+    g_viewport[3] = camera.viewportHeight();
+}
+
+void draw_screen(const Label& label, float x, float y, Color color) {
+    if (!g_baked) return;
+    label.layout();
+    unsigned char rgba[4];
+    to_bytes(color, rgba);
+    float px = std::floor(x), py = std::floor(y);
+    for (const Label::Quad& q : label.quads_)
+        push_quad(g_batch, px + q.x0, py + q.y0, px + q.x1, py + q.y1, 0.0f, q.u0, q.v0, q.u1, q.v1, rgba);
+}
+
+void draw_world(const Label& label, float x, float y, float z, Color color) {
+    float px, py, pz;
+    if (!g_baked || !project(x, y, z, px, py, pz)) return;
+    label.layout();
+    unsigned char rgba[4];
+    to_bytes(color, rgba);
+    px = std::floor(px);
+    py = std::floor(py);
+    for (const Label::Quad& q : label.quads_)
+        push_quad(g_worldBatch, px + q.x0, py + q.y0, px + q.x1, py + q.y1, pz, q.u0, q.v0, q.u1, q.v1, rgba);
+}
+
+void draw_screen(Font font, const char* s, float x, float y, Color color) {
+    emit(g_batch, font, s, x, y, 0.0f, color);
+}
+
+void draw_world(Font font, const char* s, float x, float y, float z, Color color) {
+    float px, py, pz;
+    if (project(x, y, z, px, py, pz)) emit(g_worldBatch, font, s, px, py, pz, color);
+}
+
+int width(Font f, const char* s) {
+    ensure_metrics();
+    const FontInfo& font = g_fonts[static_cast<int>(f)];
+    int w = 0;
+    for (const char* c = s; *c; ++c) {
+        int g = static_cast<unsigned char>(*c) - kFirstChar;
+        if (g >= 0 && g < kGlyphCount) w += font.advance[g];
+    }
+    return w;
+}
+
+void flush() {
+    PROFILE_ZONE("text::flush");
+    if (g_baked) {
+        // World strings first, so screen text stays on top of them.
+        if (!g_worldBatch.empty()) draw_vertices(g_worldBatch, true);
+        if (!g_batch.empty()) draw_vertices(g_batch, false);
+    }
+    g_worldBatch.clear();
+    g_batch.clear();
+}
+
+void Layer::rect(float x0, float y0, float x1, float y1, Color color) {
+    unsigned char rgba[4];
+    to_bytes(color, rgba);
+    push_quad(vertices_, x0, y0, x1, y1, 0.0f, kWhiteU, kWhiteV, kWhiteU, kWhiteV, rgba);
+}
+
+void Layer::outline(float x0, float y0, float x1, float y1, float thickness, Color color) {
+    if (x0 > x1) std::swap(x0, x1);
+    if (y0 > y1) std::swap(y0, y1);
+    float h = thickness * 0.5f;
+    rect(x0 - h, y0 - h, x1 + h, y0 + h, color); // bottom
+    rect(x0 - h, y1 - h, x1 + h, y1 + h, color); // top
+    rect(x0 - h, y0 + h, x0 + h, y1 - h, color); // left
+    rect(x1 - h, y0 + h, x1 + h, y1 - h, color); // right
+}
+
+void Layer::label(const Label& label, float x, float y, Color color) {
+    label.layout();
+    unsigned char rgba[4];
+    to_bytes(color, rgba);
+    float px = std::floor(x), py = std::floor(y);
+    for (const Label::Quad& q : label.quads_)
+        push_quad(vertices_, px + q.x0, py + q.y0, px + q.x1, py + q.y1, 0.0f, q.u0, q.v0, q.u1, q.v1, rgba);
+}
+
+void Layer::draw() const {
+    if (vertices_.empty() || !g_baked) return;
+    PROFILE_ZONE("text::Layer::draw");
+    draw_vertices(vertices_, false);
+}
+
+} // namespace text
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Camera;
+
+// Glyph-atlas text renderer.
+//
+// The GLUT bitmap fonts are baked once into an alpha texture (drawn into the
+// back buffer on the first frame and read back), so glyphs look exactly like
+// glutBitmapCharacter. Every string queued during a frame goes into one
+// client-side vertex array that flush() draws with a single glDrawArrays.
+//
+// Screen strings take window pixels with the origin bottom-left, like
+// glRasterPos2f under gluOrtho2D(0, w, 0, h). World strings behave like
+// glRasterPos3f: the anchor is projected through the camera and the text is
+// drawn screen-aligned at that pixel, or dropped when the anchor is outside
+// the view volume. World strings are depth-tested at the anchor's depth, so
+// geometry in front hides them; screen strings are drawn on top of the frame.
+// Each group is drawn in queue order, world strings first.
+namespace text {
+
+enum class Font {
+    Helvetica18,
+    Helvetica12,
+    TimesRoman10,
+    Fixed8x13,
+    Count
+};
+
+struct Color {
+    float r, g, b, a;
+};
+
+// Vertex layout shared by the frame batch and Layer: window pixels and depth
+// (0 for screen text), atlas texture coordinates and a byte color.
+struct Vertex {
+    float x, y, z;
+    float u, v;
+    unsigned char rgba[4];
+};
+
+class Layer;
+
+// A string whose glyph quads are laid out once and reused every frame.
+// set() only invalidates the layout when the text or font changes, and
+// reserves room for it up front so drawing never allocates.
+class Label {
+public:
+    Label() = default;
+    Label(const std::string& s, Font f) { set(s.c_str(), f); }
+
+    void set(const char* s, Font f);
+    void set(const std::string& s, Font f) { set(s.c_str(), f); }
+
+    const std::string& str() const { return text_; }
+    Font font() const { return font_; }
+    // Advance width in pixels.
+    int width() const;
+
+private:
+    struct Quad {
+        float x0, y0, x1, y1; // pixels relative to the pen position
+        float u0, v0, u1, v1;
+    };
+
+    void layout() const;
+
+    std::string text_;
+    Font font_ = Font::Helvetica18;
+    mutable std::vector<Quad> quads_;
+    mutable int width_ = 0;
+    mutable bool dirty_ = true;
+
+    friend void draw_screen(const Label& label, float x, float y, Color color);
+    friend void draw_world(const Label& label, float x, float y, float z, Color color);
+    friend class Layer;
+};
+
+// A screen-space HUD panel kept as a ready-made vertex array: solid
+// rectangles (drawn with a white texel of the atlas) and labels. The owner
+// rebuilds it only when the content changes; draw() is one glDrawArrays,
+// issued immediately rather than through the frame batch.
+class Layer {
+public:
+    Layer() { vertices_.reserve(1024); }
+
+    void clear() { vertices_.clear(); }
+    bool empty() const { return vertices_.empty(); }
+
+    void rect(float x0, float y0, float x1, float y1, Color color);
+    // Rectangle outline, thickness pixels wide and centered on the edges.
+    void outline(float x0, float y0, float x1, float y1, float thickness, Color color);
+    void label(const Label& label, float x, float y, Color color);
+
+    void draw() const;
+
+private:
+    std::vector<Vertex> vertices_;
+};
+
+// Call at the start of the frame, before glClear: bakes the atlas on first
+// use and records the camera used to place world strings.
+void begin_frame(const Camera& camera);
+
+void draw_screen(const Label& label, float x, float y, Color color);
+void draw_world(const Label& label, float x, float y, float z, Color color);
+
+// Uncached variants for one-off strings.
+void draw_screen(Font font, const char* s, float x, float y, Color color);
+void draw_world(Font font, const char* s, float x, float y, float z, Color color);
+
+// Advance width of s in pixels.
+int width(Font font, const char* s);
+
+// Draw everything queued this frame in one call and reset the batch.
+void flush();
+
+} // namespace text
@@ -0,0 +1,501 @@
+#include "texture.h"
+
+#include "asset_pack.h"
+#include "jpeg.h"
+#include "png.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_SSE2 1
+#endif
+
+namespace texture {
+
+namespace {
+
+std::uint32_t u32_at(const std::uint8_t* p) {
+    return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) | ((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24);
+}
+
+// Area resampling of one axis: each output texel averages the source
+// texels it covers, in proportion to the overlap. Reduces like
+// gluScaleImage's box filter and enlarges by replicating with blended
+// edges. Weights are normalized to sum to 1.
+struct Taps {
+    std::vector<int> first;  // first source texel of each output texel
+    std::vector<int> count;
+    std::vector<int> offset; // into weights
+    std::vector<float> weights;
+};
+
+void area_taps(int from, int to, Taps& taps) {
+    const double scale = (double)from / to;
+    taps.first.resize(to);
+    taps.count.resize(to);
+    taps.offset.resize(to);
+    taps.weights.clear();
+    for (int x = 0; x < to; x++) {
+        double start = x * scale, end = start + scale;
+        int first = (int)start;
+        int last = std::min(from - 1, (int)std::ceil(end) - 1);
+        taps.first[x] = first;
+        taps.count[x] = last - first + 1;
+        taps.offset[x] = (int)taps.weights.size();
+        for (int s = first; s <= last; s++)
+            taps.weights.push_back((float)((std::min<double>(end, s + 1) - std::max<double>(start, s)) / scale));
+    }
+}
+
+// Resample one BGR row horizontally into floats. out has room for one
+// float past the row.
+void resample_row(const std::uint8_t* src, const Taps& taps, int from, int to, float* out) {
+    int x = 0;
+#if defined(TEXTURE_SSE2)
+    // A pixel at a time as 4 lanes: each tap loads its BGR and the next
+    // pixel's B, whose lane is overwritten by the next output pixel. Stops
+    // where that would read past the row.
+    const __m128i zero = _mm_setzero_si128();
+    for (; x < to && taps.first[x] + taps.count[x] < from; x++) {
+        const float* w = taps.weights.data() + taps.offset[x];
+        const std::uint8_t* p = src + (std::size_t)taps.first[x] * 3;
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < taps.count[x]; k++, p += 3) {
+            std::uint32_t bytes;
+            std::memcpy(&bytes, p, 4);
+            __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)bytes), zero), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_cvtepi32_ps(v)));
+        }
+        _mm_storeu_ps(out + x * 3, sum);
+    }
+#else
+    (void)from;
+#endif
+    for (; x < to; x++) {
+        const float* w = taps.weights.data() + taps.offset[x];
+        const std::uint8_t* p = src + (std::size_t)taps.first[x] * 3;
+        float b = 0.0f, g = 0.0f, r = 0.0f;
+        for (int k = 0; k < taps.count[x]; k++, p += 3) {
+            b += w[k] * p[0];
+            g += w[k] * p[1];
+            r += w[k] * p[2];
+        }
+        out[x * 3] = b;
+        out[x * 3 + 1] = g;
+        out[x * 3 + 2] = r;
+    }
+}
+
+std::uint8_t to_byte(float v) {
+    return (std::uint8_t)std::min(255.0f, std::max(0.0f, v + 0.5f));
+}
+
+// out[i] = the sum of weights[k] * rows[k][i], to bytes.
+void blend_rows(const float* const* rows, const float* weights, int count, std::size_t n, std::uint8_t* out) {
+    std::size_t i = 0;
+#if defined(TEXTURE_SSE2)
+    const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        __m128i words[4];
+        for (int q = 0; q < 4; q++) {
+            __m128 sum = zero;
+            for (int k = 0; k < count; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i + 4 * q)));
+            words[q] = _mm_cvttps_epi32(_mm_max_ps(zero, _mm_add_ps(sum, half))); // as to_byte
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(words[0], words[1]), _mm_packs_epi32(words[2], words[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+#endif
+    for (; i < n; i++) {
+        float sum = 0.0f;
+        for (int k = 0; k < count; k++) sum += weights[k] * rows[k][i];
+        out[i] = to_byte(sum);
+    }
+}
+
+// Scale to w0 x h0 into dst (tightly packed rows), one output row at a
+// time: the source rows it covers are resampled horizontally (the last
+// few are kept, as neighbouring output rows share them) and blended.
+void resample(const std::uint8_t* bgr, int width, int height, std::size_t stride, int w0, int h0, std::uint8_t* dst) {
+    if (width == w0 && height == h0) {
+        for (int y = 0; y < h0; y++) std::memcpy(dst + (std::size_t)y * w0 * 3, bgr + y * stride, (std::size_t)w0 * 3);
+        return;
+    }
+    Taps across, down;
+    area_taps(width, w0, across);
+    area_taps(height, h0, down);
+    const std::size_t rowSize = (std::size_t)w0 * 3;
+    int most = 1;
+    for (int y = 0; y < h0; y++) most = std::max(most, down.count[y]);
+    // A ring of resampled source rows, enough for one output row; rows are
+    // needed in increasing order.
+    const int slots = most + 1;
+    std::vector<float> ring(rowSize * slots + 1);
+    std::vector<int> cached(slots, -1);
+    std::vector<const float*> rows(most);
+    for (int y = 0; y < h0; y++) {
+        for (int k = 0; k < down.count[y]; k++) {
+            const int s = down.first[y] + k;
+            float* row = ring.data() + rowSize * (s % slots);
+            if (cached[s % slots] != s) {
+                resample_row(bgr + s * stride, across, width, w0, row);
+                cached[s % slots] = s;
+            }
+            rows[k] = row;
+        }
+        blend_rows(rows.data(), down.weights.data() + down.offset[y], down.count[y], rowSize, dst + (std::size_t)y * rowSize);
+    }
+}
+
+// ---- BC1 ----
+
+std::uint16_t pack_565(const float* rgb) {
+    int r = (int)(std::min(255.0f, std::max(0.0f, rgb[0])) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(std::min(255.0f, std::max(0.0f, rgb[1])) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(std::min(255.0f, std::max(0.0f, rgb[2])) * 31.0f / 255.0f + 0.5f);
+    return (std::uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpack_565(unsigned v, int* rgb) {
+    unsigned r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+    rgb[0] = (int)((r << 3) | (r >> 2));
+    rgb[1] = (int)((g << 2) | (g >> 4));
+    rgb[2] = (int)((b << 3) | (b >> 2));
+}
+
+// The four RGB colors a block's indices select. Blocks with color0 <=
+// color1 are in the 3-color mode, where index 3 is black.
+void bc1_palette(const std::uint8_t* block, int colors[4][3]) {
+    unsigned c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+    unpack_565(c0, colors[0]);
+    unpack_565(c1, colors[1]);
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+        } else {
+            colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+            colors[3][c] = 0;
+        }
+    }
+}
+
+// Indices of the nearest 4-color palette entry for each texel, and the
+// total squared error.
+int bc1_fit(const std::uint8_t block[16][3], std::uint16_t c0, std::uint16_t c1, std::uint32_t& indices) {
+    int colors[4][3];
+    unpack_565(c0, colors[0]);
+    unpack_565(c1, colors[1]);
+    for (int c = 0; c < 3; c++) {
+        colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+        colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+    }
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = INT_MAX;
+        for (int k = 0; k < 4; k++) {
+            int dr = block[i][0] - colors[k][0], dg = block[i][1] - colors[k][1], db = block[i][2] - colors[k][2];
+            int e = dr * dr + dg * dg + db * db;
+            if (e < bestError) {
+                bestError = e;
+                best = k;
+            }
+        }
+        error += bestError;
+        indices |= (std::uint32_t)best << (2 * i);
+    }
+    return error;
+}
+
+// Encode 16 RGB texels (row by row) as one BC1 block, always in the
+// 4-color mode.
+void encode_bc1(const std::uint8_t block[16][3], std::uint8_t* out) {
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++) mean[c] += block[i][c] / 16.0f;
+
+    // Principal axis of the colors: power iteration on their covariance.
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++) {
+        float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+        cov[0] += r * r, cov[1] += r * g, cov[2] += r * b, cov[3] += g * g, cov[4] += g * b, cov[5] += b * b;
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (length < 1e-6f) break; // flat block
+        axis[0] = x / length, axis[1] = y / length, axis[2] = z / length;
+    }
+    float lo = 0.0f, hi = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    const float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        e0[c] = norm > 0.0f ? mean[c] + axis[c] * hi / norm : mean[c];
+        e1[c] = norm > 0.0f ? mean[c] + axis[c] * lo / norm : mean[c];
+    }
+    std::uint16_t c0 = pack_565(e0), c1 = pack_565(e1);
+    std::uint32_t indices;
+    int error = bc1_fit(block, c0, c1, indices);
+
+    // Least-squares endpoints for the chosen indices, while that helps.
+    static const float kWeight[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f}; // of color0
+    for (int iteration = 0; iteration < 2 && error > 0; iteration++) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 16; i++) {
+            float w = kWeight[(indices >> (2 * i)) & 3], v = 1.0f - w;
+            aa += w * w, ab += w * v, bb += v * v;
+            for (int c = 0; c < 3; c++) ax[c] += w * block[i][c], bx[c] += v * block[i][c];
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) break;
+        for (int c = 0; c < 3; c++) {
+            e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+            e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+        }
+        std::uint16_t n0 = pack_565(e0), n1 = pack_565(e1);
+        std::uint32_t nIndices;
+        int nError = bc1_fit(block, n0, n1, nIndices);
+        if (nError >= error) break;
+        c0 = n0, c1 = n1, indices = nIndices, error = nError;
+    }
+
+    // The 4-color mode needs color0 > color1: swap, which swaps the roles of
+    // indices 0/1 and 2/3. Equal endpoints select the 3-color mode, where
+    // index 0 is the one color.
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        indices ^= 0x55555555u;
+    } else if (c0 == c1) {
+        indices = 0;
+    }
+    out[0] = (std::uint8_t)c0;
+    out[1] = (std::uint8_t)(c0 >> 8);
+    out[2] = (std::uint8_t)c1;
+    out[3] = (std::uint8_t)(c1 >> 8);
+    for (int i = 0; i < 4; i++) out[4 + i] = (std::uint8_t)(indices >> (8 * i));
+}
+
+bool read_file(const std::string& path, std::vector<std::uint8_t>& bytes) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? std::ftell(file) : -1;
+    ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        bytes.resize((std::size_t)size);
+        ok = size == 0 || std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace
+
+bool parse_bmp(const std::uint8_t* file, std::size_t size, int& width, int& height, const std::uint8_t*& pixels) {
+    if (size < 54 || file[0] != 'B' || file[1] != 'M') return false;
+    std::uint32_t offBits = u32_at(file + 10);
+    std::int32_t w = (std::int32_t)u32_at(file + 18);
+    std::int32_t h = (std::int32_t)u32_at(file + 22);
+    std::uint16_t bits = (std::uint16_t)(file[28] | (file[29] << 8));
+    std::uint32_t compression = u32_at(file + 30);
+    // Bottom-up 24-bit BI_RGB only, as the textures are.
+    if (bits != 24 || compression != 0 || w <= 0 || h <= 0 || w > 65535 || h > 65535) return false;
+    if (offBits > size || bmp_stride(w) * (std::size_t)h > size - offBits) return false;
+    width = w;
+    height = h;
+    pixels = file + offBits;
+    return true;
+}
+
+int nearest_power(int size) {
+    int power = 1;
+    for (unsigned value = (unsigned)std::max(size, 1); value > 1; value >>= 1) {
+        if (value == 3) return power * 4;
+        power *= 2;
+    }
+    return power;
+}
+
+bool decode_image(const std::uint8_t* file, std::size_t size, Image& image) {
+    if (size >= 2 && file[0] == 'B' && file[1] == 'M') {
+        image.storage.clear();
+        if (parse_bmp(file, size, image.width, image.height, image.pixels)) return true;
+        std::cerr << "[texture] unsupported BMP (only uncompressed 24-bit)\n";
+        return false;
+    }
+    if (size >= 3 && file[0] == 0xFF && file[1] == 0xD8 && file[2] == 0xFF) return jpeg::decode(file, size, image);
+    if (size >= 8 && std::memcmp(file, "\x89PNG\r\n\x1a\n", 8) == 0) return png::decode(file, size, image);
+    std::cerr << "[texture] not a BMP, JPEG or PNG image\n";
+    return false;
+}
+
+void build(const std::uint8_t* bgr, int width, int height, std::size_t stride, std::vector<std::uint8_t>& out) {
+    const int w0 = nearest_power(width), h0 = nearest_power(height);
+    int levels = 1;
+    while ((w0 >> (levels - 1)) > 1 || (h0 >> (levels - 1)) > 1) levels++;
+
+    std::size_t bytes = sizeof(Header);
+    for (int l = 0; l < levels; l++) bytes += (std::size_t)std::max(1, w0 >> l) * std::max(1, h0 >> l) * 3;
+    out.resize(bytes);
+    Header header{kMagic, kVersion, (std::uint32_t)w0, (std::uint32_t)h0, (std::uint32_t)levels,
+                  (std::uint32_t)Pixels::Bgr8, {0, 0}};
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::uint8_t* level = out.data() + sizeof(Header);
+    resample(bgr, width, height, stride, w0, h0, level);
+
+    // Further levels: average 2x2 blocks (2x1 or 1x2 once a side is 1),
+    // rounding to nearest.
+    int w = w0, h = h0;
+    for (int l = 1; l < levels; l++) {
+        const int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+        const std::size_t dx = w > 1 ? 3 : 0;
+        std::uint8_t* next = level + (std::size_t)w * h * 3;
+        for (int y = 0; y < nh; y++) {
+            const std::uint8_t* r0 = level + (std::size_t)(h > 1 ? 2 * y : y) * w * 3;
+            const std::uint8_t* r1 = h > 1 ? r0 + (std::size_t)w * 3 : r0;
+            std::uint8_t* dst = next + (std::size_t)y * nw * 3;
+            for (int x = 0; x < nw; x++) {
+                const std::size_t a = (std::size_t)(w > 1 ? 2 * x : x) * 3;
+                for (int c = 0; c < 3; c++)
+                    dst[x * 3 + c] = (std::uint8_t)((r0[a + c] + r0[a + dx + c] + r1[a + c] + r1[a + dx + c] + 2) >> 2);
+            }
+        }
+        level = next;
+        w = nw;
+        h = nh;
+    }
+}
+
+bool load(const std::string& path, std::vector<std::uint8_t>& storage, const std::uint8_t*& data, std::size_t& size) {
+    const assets::Asset* asset = assets::find(path);
+    if (asset && asset->format == assets::Format::Texture) {
+        data = asset->data;
+        size = asset->size;
+        return true;
+    }
+    std::vector<std::uint8_t> file;
+    if (!asset && !read_file(path, file)) {
+        std::cerr << "[texture] cannot read " << path << "\n";
+        return false;
+    }
+    Image image;
+    if (!decode_image(asset ? asset->data : file.data(), asset ? asset->size : file.size(), image)) {
+        std::cerr << "[texture] cannot load " << path << "\n";
+        return false;
+    }
+    build(image.pixels, image.width, image.height, image.stride(), storage);
+    data = storage.data();
+    size = storage.size();
+    return true;
+}
+
+bool parse(const std::uint8_t* data, std::size_t size, Header& header, std::vector<Level>& levels) {
+    if (size < sizeof(Header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) return false;
+    if (header.pixels != (std::uint32_t)Pixels::Bgr8 && header.pixels != (std::uint32_t)Pixels::Bc1) return false;
+    if (header.width == 0 || header.height == 0 || header.width > 65536 || header.height > 65536) return false;
+    if (header.levels == 0 || header.levels > 17) return false;
+
+    levels.clear();
+    std::size_t offset = sizeof(Header);
+    for (std::uint32_t l = 0; l < header.levels; l++) {
+        Level level;
+        level.width = std::max(1, (int)(header.width >> l));
+        level.height = std::max(1, (int)(header.height >> l));
+        level.size = level_size((Pixels)header.pixels, level.width, level.height);
+        if (level.size > size - offset) return false;
+        level.data = data + offset;
+        offset += level.size;
+        levels.push_back(level);
+    }
+    return true;
+}
+
+std::size_t level_size(Pixels pixels, int width, int height) {
+    if (pixels == Pixels::Bc1) return (std::size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+    return (std::size_t)width * height * 3;
+}
+
+bool compress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) {
+    Header header;
+    std::vector<Level> levels;
+    if (!parse(data, size, header, levels) || header.pixels != (std::uint32_t)Pixels::Bgr8) return false;
+    header.pixels = (std::uint32_t)Pixels::Bc1;
+    std::size_t bytes = sizeof(Header);
+    for (const Level& level : levels) bytes += level_size(Pixels::Bc1, level.width, level.height);
+    out.resize(bytes);
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::uint8_t* dst = out.data() + sizeof(Header);
+    std::uint8_t block[16][3];
+    for (const Level& level : levels) {
+        for (int by = 0; by < level.height; by += 4) {
+            for (int bx = 0; bx < level.width; bx += 4, dst += 8) {
+                // Levels under 4 texels a side repeat their edge texels.
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx + (i & 3), level.width - 1), y = std::min(by + (i >> 2), level.height - 1);
+                    const std::uint8_t* p = level.data + ((std::size_t)y * level.width + x) * 3;
+                    block[i][0] = p[2];
+                    block[i][1] = p[1];
+                    block[i][2] = p[0];
+                }
+                encode_bc1(block, dst);
+            }
+        }
+    }
+    return true;
+}
+
+bool decompress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) {
+    Header header;
+    std::vector<Level> levels;
+    if (!parse(data, size, header, levels) || header.pixels != (std::uint32_t)Pixels::Bc1) return false;
+    header.pixels = (std::uint32_t)Pixels::Bgr8;
+    std::size_t bytes = sizeof(Header);
+    for (const Level& level : levels) bytes += level_size(Pixels::Bgr8, level.width, level.height);
+    out.resize(bytes);
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::uint8_t* dst = out.data() + sizeof(Header);
+    for (const Level& level : levels) {
+        const std::uint8_t* src = level.data;
+        for (int by = 0; by < level.height; by += 4) {
+            for (int bx = 0; bx < level.width; bx += 4, src += 8) {
+                int colors[4][3];
+                bc1_palette(src, colors);
+                std::uint32_t indices = u32_at(src + 4);
+                for (int i = 0; i < 16; i++, indices >>= 2) {
+                    int x = bx + (i & 3), y = by + (i >> 2);
+                    if (x >= level.width || y >= level.height) continue;
+                    std::uint8_t* p = dst + ((std::size_t)y * level.width + x) * 3;
+                    const int* c = colors[indices & 3];
+                    p[0] = (std::uint8_t)c[2];
+                    p[1] = (std::uint8_t)c[1];
+                    p[2] = (std::uint8_t)c[0];
+                }
+            }
+        }
+        dst += level_size(Pixels::Bgr8, level.width, level.height);
+    }
+    return true;
+}
+
+} // namespace texture
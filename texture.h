@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runtime texture format of the asset pack: a whole mip chain, ready to
+// upload level by level with glTexImage2D.
+//
+// tools/compile_assets builds it from the source images once, the way
+// gluBuild2DMipmaps would at every launch: scaled to power-of-two sides,
+// then halved with a 2x2 box filter down to 1x1. Loading a compiled
+// texture is then only the upload.
+//
+// Source images may be BMP, JPEG or PNG; they are decoded (jpeg.h, png.h)
+// to the BMP layout before the chain is built.
+//
+// Layout: Header, then `levels` levels, largest first. Level l is
+// max(1, width >> l) x max(1, height >> l) pixels, bottom row first like
+// the BMPs, in one of two encodings:
+// - Bgr8: tightly packed rows (upload with GL_UNPACK_ALIGNMENT 1).
+// - Bc1 (S3TC DXT1): 4x4 blocks of 8 bytes, 6 times smaller in memory and
+//   on the GPU, uploaded with glCompressedTexImage2D. Where the driver has
+//   no S3TC, decompress() turns the chain back into Bgr8.
+
+namespace texture {
+
+const std::uint32_t kMagic = 0x58545344; // "DSTX"
+const std::uint32_t kVersion = 1;
+
+enum class Pixels : std::uint32_t {
+    Bgr8 = 0, // 3 bytes per pixel, GL_BGR_EXT
+    Bc1 = 1,  // 8 bytes per 4x4 block, GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+};
+
+#pragma pack(push, 1)
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t width;  // of level 0
+    std::uint32_t height;
+    std::uint32_t levels;
+    std::uint32_t pixels; // Pixels
+    std::uint32_t reserved[2];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Header) == 32, "Header layout is part of the file format");
+
+struct Level {
+    int width = 0;
+    int height = 0;
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+};
+
+// The 24-bit pixels of a BMP file in memory, where they are: BGR, bottom
+// row first, rows padded to 4 bytes (GL's default unpack alignment). False
+// for anything else, or a file too short for its pixels.
+bool parse_bmp(const std::uint8_t* file, std::size_t size, int& width, int& height, const std::uint8_t*& pixels);
+
+// Row stride of a BMP, in bytes.
+inline std::size_t bmp_stride(int width) {
+    return ((std::size_t)width * 3 + 3) & ~(std::size_t)3;
+}
+
+// Largest JPEG or PNG decoded, in pixels (8192 x 8192). Larger headers are
+// rejected before anything is allocated, so a corrupt size cannot exhaust
+// memory.
+const std::size_t kMaxImagePixels = (std::size_t)8192 * 8192;
+
+// A source image in the BMP layout: BGR, bottom row first, rows padded to
+// bmp_stride. For a BMP, pixels point into the file; a decoded JPEG or PNG
+// keeps them in storage.
+struct Image {
+    int width = 0;
+    int height = 0;
+    const std::uint8_t* pixels = nullptr;
+    std::vector<std::uint8_t> storage;
+
+    std::size_t stride() const { return bmp_stride(width); }
+};
+
+// Decode a BMP, JPEG or PNG file, told apart by signature. False, with a
+// message on stderr, for anything else or a file that fails to decode.
+bool decode_image(const std::uint8_t* file, std::size_t size, Image& image);
+
+// The power of two gluBuild2DMipmaps scales a side to, with GLU's rounding
+// (by the two leading bits: 300 -> 256, 384 -> 512).
+int nearest_power(int size);
+
+// Compile BGR pixels (rows `stride` bytes apart) into a mip chain. Level 0
+// is resampled a row at a time and each further level is made from the
+// bytes of the one before, so the only memory used is out.
+void build(const std::uint8_t* bgr, int width, int height, std::size_t stride, std::vector<std::uint8_t>& out);
+
+// The mip chain for the texture at `path`: the compiled one in the asset
+// pack, where it is mapped, or one built from the image in the pack or its
+// loose file, kept in storage. Safe to call from several threads at once.
+bool load(const std::string& path, std::vector<std::uint8_t>& storage, const std::uint8_t*& data, std::size_t& size);
+
+// Check a compiled texture and find its levels; false if it is malformed
+// or truncated.
+bool parse(const std::uint8_t* data, std::size_t size, Header& header, std::vector<Level>& levels);
+
+// Bytes of a width x height level.
+std::size_t level_size(Pixels pixels, int width, int height);
+
+// Re-encode a Bgr8 chain as Bc1. Each block's endpoints are fitted along
+// the principal axis of its colors and refined by least squares.
+bool compress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out);
+
+// Decode a Bc1 chain into a Bgr8 one, as the GPU would sample it.
+bool decompress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out);
+
+} // namespace texture
@@ -0,0 +1,266 @@
+// Benchmark for texture image decoding (jpeg.h, png.h) against reading the
+// same pixels as an uncompressed BMP.
+//
+// Usage: bench_images [--threads=N] [--read-mbps=N] data/ceiling.jpg [more images ...]
+// Decodes each image on one thread, then all of them across --threads
+// threads (default: one per core), as textureInit does. The mip chain of
+// each is then compressed to BC1 and decompressed again, on one thread and
+// across all of them, which is what textureInit does where the driver has
+// no S3TC; PSNR is over all levels against the BGR8 chain. Each image is also
+// written to /tmp as a 24-bit BMP, and both files are read back cold
+// (dropped from the page cache with posix_fadvise, where there is one;
+// elsewhere the reads are warm and say so): a compressed file wins when
+// reading it and decoding takes less time than reading the BMP. The disk
+// bandwidth at which the two break even is printed; --read-mbps=N caps the
+// reads at N MB/s, to measure a slower disk or a network mount directly.
+
+#include "../texture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define BENCH_COLD_READS 1
+#endif
+
+namespace {
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Drop a file from the page cache, so the next read comes from the disk.
+bool evict(const std::string& path) {
+#if defined(BENCH_COLD_READS)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    fdatasync(fd);
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Read a whole file. With mbps > 0, reads go in 256 KB chunks and sleep as
+// needed to stay under that many MB/s.
+bool read_file(const std::string& path, std::vector<std::uint8_t>& bytes, double mbps = 0.0) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    bytes.resize(size > 0 ? (std::size_t)size : 0);
+    const std::size_t chunk = mbps > 0.0 ? 256 * 1024 : bytes.size();
+    auto start = std::chrono::steady_clock::now();
+    bool ok = size >= 0;
+    for (std::size_t done = 0; ok && done < bytes.size();) {
+        std::size_t n = std::min(chunk, bytes.size() - done);
+        ok = std::fread(bytes.data() + done, 1, n, file) == n;
+        done += n;
+        if (mbps > 0.0)
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(done / (mbps * 1048576.0)));
+    }
+    std::fclose(file);
+    return ok;
+}
+
+bool write_bmp(const std::string& path, const texture::Image& image) {
+    const std::uint32_t pixels = (std::uint32_t)(image.stride() * image.height);
+    std::uint8_t header[54] = {'B', 'M'};
+    auto put = [&](int at, std::uint32_t v) {
+        for (int i = 0; i < 4; i++) header[at + i] = (std::uint8_t)(v >> (8 * i));
+    };
+    put(2, 54 + pixels);
+    put(10, 54);
+    put(14, 40);
+    put(18, (std::uint32_t)image.width);
+    put(22, (std::uint32_t)image.height);
+    header[26] = 1;
+    header[28] = 24;
+    put(34, pixels);
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              std::fwrite(image.pixels, 1, pixels, file) == pixels;
+    return std::fclose(file) == 0 && ok;
+}
+
+struct Source {
+    std::string path;
+    std::vector<std::uint8_t> file;
+    double megapixels = 0.0;
+    double decodeMs = 0.0;
+    std::vector<std::uint8_t> bc1;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    double readMbps = 0.0;
+    std::vector<Source> sources;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = std::max(1, std::atoi(argv[i] + 10));
+            continue;
+        }
+        if (std::strncmp(argv[i], "--read-mbps=", 12) == 0) {
+            readMbps = std::max(0.0, std::atof(argv[i] + 12));
+            continue;
+        }
+        Source source;
+        source.path = argv[i];
+        if (!read_file(source.path, source.file)) {
+            std::fprintf(stderr, "bench_images: cannot read %s\n", argv[i]);
+            return 1;
+        }
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty()) {
+        std::fprintf(stderr, "usage: bench_images [--threads=N] [--read-mbps=N] <image> [more images ...]\n");
+        return 2;
+    }
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    std::printf("decoder path: SSE2\n");
+#else
+    std::printf("decoder path: scalar\n");
+#endif
+
+    // One thread, best of three.
+    std::printf("%-36s %11s %9s %10s %9s\n", "image", "size", "MB", "decode ms", "MP/s");
+    double serialMs = 0.0, totalMp = 0.0;
+    for (Source& source : sources) {
+        texture::Image image;
+        source.decodeMs = 1e30;
+        for (int run = 0; run < 3; run++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!texture::decode_image(source.file.data(), source.file.size(), image)) {
+                std::fprintf(stderr, "bench_images: cannot decode %s\n", source.path.c_str());
+                return 1;
+            }
+            source.decodeMs = std::min(source.decodeMs, ms_since(start));
+        }
+        source.megapixels = image.width * (double)image.height / 1e6;
+        serialMs += source.decodeMs;
+        totalMp += source.megapixels;
+        char size[32];
+        std::snprintf(size, sizeof(size), "%dx%d", image.width, image.height);
+        std::printf("%-36s %11s %9.2f %10.1f %9.1f\n", source.path.c_str(), size, source.file.size() / 1048576.0,
+                    source.decodeMs, source.megapixels / (source.decodeMs / 1000.0));
+    }
+
+    // Every image at once, a thread per image at most.
+    std::atomic<std::size_t> next{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::min<int>(threads, (int)sources.size()); t++) {
+        pool.emplace_back([&] {
+            for (std::size_t i = next++; i < sources.size(); i = next++) {
+                texture::Image image;
+                texture::decode_image(sources[i].file.data(), sources[i].file.size(), image);
+            }
+        });
+    }
+    for (std::thread& thread : pool) thread.join();
+    double parallelMs = ms_since(start);
+    std::printf("all %zu images: %.1f MP, %.1f ms on 1 thread, %.1f ms on %d threads (%.1fx)\n", sources.size(),
+                totalMp, serialMs, parallelMs, threads, serialMs / parallelMs);
+
+    // BC1 chains: size, quality and the CPU decompression fallback.
+    std::printf("\n%-36s %9s %9s %11s %12s %9s\n", "image", "BGR8 MB", "BC1 MB", "PSNR dB", "compress ms",
+                "decomp ms");
+    double decompressMs = 0.0;
+    for (Source& source : sources) {
+        texture::Image image;
+        texture::decode_image(source.file.data(), source.file.size(), image);
+        std::vector<std::uint8_t> chain, back;
+        texture::build(image.pixels, image.width, image.height, image.stride(), chain);
+        auto compressStart = std::chrono::steady_clock::now();
+        texture::compress(chain.data(), chain.size(), source.bc1);
+        double compressMs = ms_since(compressStart);
+        double ms = 1e30;
+        for (int run = 0; run < 3; run++) {
+            auto runStart = std::chrono::steady_clock::now();
+            texture::decompress(source.bc1.data(), source.bc1.size(), back);
+            ms = std::min(ms, ms_since(runStart));
+        }
+        decompressMs += ms;
+        double squares = 0.0;
+        for (std::size_t i = sizeof(texture::Header); i < chain.size(); i++) {
+            double d = (double)chain[i] - back[i];
+            squares += d * d;
+        }
+        double mse = squares / (double)(chain.size() - sizeof(texture::Header));
+        std::printf("%-36s %9.2f %9.2f %11.1f %12.1f %9.1f\n", source.path.c_str(), chain.size() / 1048576.0,
+                    source.bc1.size() / 1048576.0, mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0,
+                    compressMs, ms);
+    }
+    next = 0;
+    start = std::chrono::steady_clock::now();
+    pool.clear();
+    for (int t = 0; t < std::min<int>(threads, (int)sources.size()); t++) {
+        pool.emplace_back([&] {
+            for (std::size_t i = next++; i < sources.size(); i = next++) {
+                std::vector<std::uint8_t> back;
+                texture::decompress(sources[i].bc1.data(), sources[i].bc1.size(), back);
+            }
+        });
+    }
+    for (std::thread& thread : pool) thread.join();
+    parallelMs = ms_since(start);
+    std::printf("BC1 decompression of all %zu chains: %.1f ms on 1 thread, %.1f ms on %d threads (%.1fx)\n",
+                sources.size(), decompressMs, parallelMs, threads, decompressMs / parallelMs);
+
+    // Cold reads: compressed file plus decode against the BMP alone.
+    std::printf("\n%-36s %12s %12s %12s\n", "image", "read+decode", "BMP read", "BMP MB");
+    bool cold = true;
+    double compressedMs = 0.0, bmpMs = 0.0, compressedMb = 0.0, bmpMb = 0.0;
+    for (Source& source : sources) {
+        texture::Image image;
+        texture::decode_image(source.file.data(), source.file.size(), image);
+        const std::string bmp = "/tmp/bench_images.bmp";
+        if (!write_bmp(bmp, image)) {
+            std::fprintf(stderr, "bench_images: cannot write %s\n", bmp.c_str());
+            return 1;
+        }
+        std::vector<std::uint8_t> bytes;
+        cold = evict(source.path) && cold;
+        auto readStart = std::chrono::steady_clock::now();
+        read_file(source.path, bytes, readMbps);
+        texture::decode_image(bytes.data(), bytes.size(), image);
+        double a = ms_since(readStart);
+        compressedMb += bytes.size() / 1048576.0;
+        cold = evict(bmp) && cold;
+        readStart = std::chrono::steady_clock::now();
+        read_file(bmp, bytes, readMbps);
+        double b = ms_since(readStart);
+        bmpMb += bytes.size() / 1048576.0;
+        std::remove(bmp.c_str());
+        compressedMs += a;
+        bmpMs += b;
+        std::printf("%-36s %9.1f ms %9.1f ms %12.1f\n", source.path.c_str(), a, b, bytes.size() / 1048576.0);
+    }
+    char reads[64];
+    if (readMbps > 0.0) std::snprintf(reads, sizeof(reads), "%s, capped at %g MB/s", cold ? "cold" : "warm", readMbps);
+    else std::snprintf(reads, sizeof(reads), "%s", cold ? "cold" : "warm");
+    std::printf("total: %.1f ms from compressed files, %.1f ms from BMPs (%s reads)\n", compressedMs, bmpMs, reads);
+    // Both read at B MB/s: compressed wins while (bmpMb - compressedMb) / B
+    // outweighs the decoding time.
+    std::printf("break-even: compressed files win on disks slower than %.0f MB/s (%.1f MB less to read, %.1f ms "
+                "decoding on 1 thread)\n",
+                (bmpMb - compressedMb) / (serialMs / 1000.0), bmpMb - compressedMb, serialMs);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Microbenchmark for LabelLayout::solve.
+//
+// Usage: bench_labels [repeats]
+// Scatters 10 .. 5000 tooltip-sized labels over a 1920x1080 window (the same
+// label density per screen area for every size, so the work per label is
+// comparable) and reports the solve time and how many overlaps are left.
+// Exits with 1 unless 500 labels settle with no overlaps in under 1 ms.
+
+#include "../label_layout.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Rect {
+    float x0, y0, x1, y1, priority;
+};
+
+int main(int argc, char** argv) {
+    int repeats = argc > 1 ? std::atoi(argv[1]) : 200;
+    if (repeats <= 0) repeats = 200;
+    const int kGateLabels = 500;
+    const double kGateUs = 1000.0;
+    bool pass = true;
+
+    std::printf("%8s %12s %12s %10s %10s\n", "labels", "us/solve", "ns/label", "overlaps", "left");
+
+    std::mt19937 rng(1234);
+    const int sizes[] = {10, 100, 500, 1000, 5000};
+    for (int n : sizes) {
+        // Grow the area with n so density stays constant: ~40 labels per 1080p screen.
+        float scale = std::sqrt(n / 40.0f);
+        if (scale < 1.0f) scale = 1.0f;
+        std::uniform_real_distribution<float> px(0.0f, 1920.0f * scale);
+        std::uniform_real_distribution<float> py(0.0f, 1080.0f * scale);
+        std::uniform_real_distribution<float> size(0.6f, 1.4f);
+        std::uniform_real_distribution<float> prio(0.0f, 1.0f);
+
+        std::vector<Rect> rects(n);
+        for (Rect& r : rects) {
+            float s = size(rng);
+            r.x0 = px(rng);
+            r.y0 = py(rng);
+            r.x1 = r.x0 + 220.0f * s;
+            r.y1 = r.y0 + 90.0f * s;
+            r.priority = prio(rng);
+        }
+
+        LabelLayout layout;
+        layout.reserve(n);
+        int before = 0, left = 0;
+        double totalUs = 0.0;
+        for (int rep = 0; rep < repeats; rep++) {
+            layout.clear();
+            for (const Rect& r : rects) layout.add(r.x0, r.y0, r.x1, r.y1, r.priority);
+            if (rep == 0) before = layout.countOverlaps();
+            auto start = std::chrono::steady_clock::now();
+            layout.solve(4.0f);
+            totalUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        left = layout.countOverlaps();
+        double us = totalUs / repeats;
+        std::printf("%8d %12.2f %12.1f %10d %10d%s\n", n, us, us * 1000.0 / n, before, left,
+                    left > 0 ? "  (not settled)" : "");
+        if (n == kGateLabels && (left > 0 || us >= kGateUs)) pass = false;
+    }
+    if (!pass) std::printf("FAIL: %d labels must settle with no overlaps in under %.0f us\n", kGateLabels, kGateUs);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Throughput benchmark for the software audio mixer (mixer.h).
+//
+// Usage: bench_mixer [seconds] [out.wav]
+// Mixes 1 .. 256 looping voices (a mix of 44.1 kHz mono clips, which are
+// resampled and panned, and 48 kHz stereo clips, which are copied) into
+// 48 kHz stereo in 10 ms blocks, as the audio thread does. "rt voices" is
+// how many voices one core could keep mixing in real time: milliseconds of
+// voice audio produced per millisecond of CPU. Each count is run with the
+// clips as 16-bit PCM and again as IMA-ADPCM, which the mixer decodes a
+// block at a time. With a path, the last PCM run's mix is also written to
+// a WAV file through mixer::WavWriter; otherwise it goes to the null sink.
+
+#include "../adpcm.h"
+#include "../mixer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static mixer::Clip make_clip(int channels, int sampleRate, float hz, float seconds) {
+    mixer::Clip clip;
+    clip.channels = channels;
+    clip.sampleRate = sampleRate;
+    int frames = (int)(seconds * sampleRate);
+    clip.samples.resize((size_t)frames * channels);
+    for (int i = 0; i < frames; i++) {
+        float s = std::sin(6.2831853f * hz * i / sampleRate);
+        for (int c = 0; c < channels; c++) clip.samples[(size_t)i * channels + c] = (std::int16_t)(s * (c ? 6000 : 8000));
+    }
+    return clip;
+}
+
+static mixer::Clip compressed(const mixer::Clip& pcm) {
+    mixer::Clip clip;
+    clip.channels = pcm.channels;
+    clip.sampleRate = pcm.sampleRate;
+    clip.adpcmFrames = pcm.frames();
+    adpcm::encode(pcm.samples.data(), (size_t)pcm.frames(), pcm.channels, clip.adpcm);
+    return clip;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    if (seconds <= 0.0) seconds = 10.0;
+    std::string outPath = argc > 2 ? argv[2] : "";
+
+    const int rate = 48000;
+    const int block = 480;
+    const mixer::Clip mono = make_clip(1, 44100, 220.0f, 1.3f);
+    const mixer::Clip stereo = make_clip(2, 48000, 330.0f, 0.9f);
+    const mixer::Clip monoAdpcm = compressed(mono);
+    const mixer::Clip stereoAdpcm = compressed(stereo);
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    std::printf("mixer path: SSE2\n");
+#else
+    std::printf("mixer path: scalar\n");
+#endif
+    std::printf("%8s %8s %12s %14s %12s\n", "clips", "voices", "us/block", "ns/voice-frame", "rt voices");
+
+    const int counts[] = {1, 8, 32, 64, 128, 256};
+    for (int packed = 0; packed < 2; packed++) {
+        for (int n : counts) {
+            std::mt19937 rng(99);
+            std::uniform_real_distribution<float> coord(-30.0f, 30.0f);
+            mixer::Mixer mix(rate, n);
+            const float origin[3] = {0.0f, 0.0f, 0.0f};
+            const float forward[3] = {0.0f, 0.0f, -1.0f};
+            const float up[3] = {0.0f, 1.0f, 0.0f};
+            mix.set_listener(origin, forward, up);
+            for (int v = 0; v < n; v++) {
+                // Three in four voices are mono, spread around the listener.
+                const mixer::Clip* clip = v % 4 == 3 ? (packed ? &stereoAdpcm : &stereo) : (packed ? &monoAdpcm : &mono);
+                int voice = mix.play(clip, v * 37.0, true);
+                const float p[3] = {coord(rng), 0.0f, coord(rng)};
+                mix.set_position(voice, p, false);
+                mix.set_gain(voice, 1.0f / n);
+            }
+
+            mixer::WavWriter sink;
+            if (!outPath.empty() && !packed && n == counts[sizeof(counts) / sizeof(counts[0]) - 1]) sink.open(outPath, rate);
+            std::vector<float> out(block * 2);
+            int blocks = (int)(seconds * rate / block);
+            auto start = std::chrono::steady_clock::now();
+            for (int b = 0; b < blocks; b++) {
+                mix.mix(out.data(), block);
+                sink.write(out.data(), block);
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            double perBlock = us / blocks;
+            double nsPerVoiceFrame = us * 1000.0 / ((double)blocks * block * n);
+            double audioMs = seconds * 1000.0 * n;
+            std::printf("%8s %8d %12.2f %14.2f %12.0f\n", packed ? "adpcm" : "pcm", n, perBlock, nsPerVoiceFrame, audioMs / (us / 1000.0));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,206 @@
+// Microbenchmark for HotspotSet::pick against the scalar reference loop,
+// and for MeshBVH::intersect, which picks the components by their triangles.
+//
+// Usage: bench_picking [rays]
+// Scatters 10 .. 100000 hotspots through a room-sized volume, fires random
+// rays from the camera area and reports ns per ray for both paths. Then
+// picks tessellated spheres of 2k .. 200k triangles (the captured component
+// meshes are a few thousand), with most rays aimed at the mesh, and reports
+// build time and us per ray. Every result is cross-checked (against every
+// triangle, for the BVH) so a broken path fails loudly.
+
+#include "../hotspots.h"
+#include "../mesh_bvh.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Ray {
+    float o[3];
+    float d[3];
+};
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Unit sphere of 2 * rings * segments triangles at (0, 5, 0).
+static std::vector<float> sphere(int rings, int segments) {
+    const float pi = 3.14159265f;
+    std::vector<float> tris;
+    auto vertex = [&](int ring, int segment) {
+        float theta = pi * ring / rings, phi = 2.0f * pi * segment / segments;
+        tris.push_back(std::sin(theta) * std::cos(phi));
+        tris.push_back(5.0f + std::cos(theta));
+        tris.push_back(std::sin(theta) * std::sin(phi));
+    };
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            vertex(r, s), vertex(r + 1, s), vertex(r + 1, s + 1);
+            vertex(r, s), vertex(r + 1, s + 1), vertex(r, s + 1);
+        }
+    }
+    return tris;
+}
+
+// Nearest hit over every triangle (Moller-Trumbore, double sided), or 1e9.
+static float brute_force(const std::vector<float>& tris, const float* o, const float* d) {
+    float best = 1e9f;
+    for (size_t i = 0; i + 9 <= tris.size(); i += 9) {
+        const float* tri = &tris[i];
+        float e1[3] = {tri[3] - tri[0], tri[4] - tri[1], tri[5] - tri[2]};
+        float e2[3] = {tri[6] - tri[0], tri[7] - tri[1], tri[8] - tri[2]};
+        float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (det > -1e-12f && det < 1e-12f) continue;
+        float inv = 1.0f / det;
+        float s[3] = {o[0] - tri[0], o[1] - tri[1], o[2] - tri[2]};
+        float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+        if (u < 0.0f || u > 1.0f) continue;
+        float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+        float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+        if (t >= 0.0f && t < best) best = t;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int rayCount = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (rayCount <= 0) rayCount = 20000;
+
+#if defined(__AVX2__)
+    const char* path = "AVX2";
+#elif defined(HOTSPOTS_SSE2)
+    const char* path = "SSE2";
+#else
+    const char* path = "scalar";
+#endif
+    std::printf("pick path: %s, %d rays per size\n", path, rayCount);
+    std::printf("%10s %14s %14s %9s %8s\n", "hotspots", "simd ns/ray", "scalar ns/ray", "speedup", "hits");
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> pos(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> rad(0.1f, 0.6f);
+
+    std::vector<Ray> rays(rayCount);
+    for (Ray& r : rays) {
+        r.o[0] = unit(rng) * 2.0f;
+        r.o[1] = 5.0f + unit(rng);
+        r.o[2] = 25.0f + unit(rng) * 2.0f;
+        float d[3] = {unit(rng) * 0.6f, unit(rng) * 0.4f, -1.0f};
+        float len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        for (int i = 0; i < 3; i++) r.d[i] = d[i] / len;
+    }
+
+    const int sizes[] = {10, 100, 1000, 10000, 100000};
+    int failures = 0;
+    for (int n : sizes) {
+        HotspotSet set;
+        for (int i = 0; i < n; i++) {
+            int index = set.add(pos(rng), pos(rng) * 0.5f, pos(rng), rad(rng));
+            // Roughly matches the app: a few hidden or blocked parts.
+            if (i % 7 == 0) set.setVisible(index, false);
+            if (i % 11 == 0) set.setBlocked(index, true);
+        }
+
+        // Fewer rays for the big sets so each size takes similar time.
+        int rays_n = n >= 10000 ? rayCount / 20 : rayCount;
+        if (rays_n < 1) rays_n = 1;
+
+        long long simdSum = 0, scalarSum = 0;
+        int hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rays_n; i++) {
+            const Ray& r = rays[i];
+            simdSum += set.pick(r.o[0], r.o[1], r.o[2], r.d[0], r.d[1], r.d[2]);
+        }
+        double simdNs = elapsed_ns(start) / rays_n;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rays_n; i++) {
+            const Ray& r = rays[i];
+            scalarSum += set.pickScalar(r.o[0], r.o[1], r.o[2], r.d[0], r.d[1], r.d[2]);
+        }
+        double scalarNs = elapsed_ns(start) / rays_n;
+
+        for (int i = 0; i < rays_n; i++) {
+            const Ray& r = rays[i];
+            float simdT, scalarT;
+            int a = set.pick(r.o[0], r.o[1], r.o[2], r.d[0], r.d[1], r.d[2], &simdT);
+            int b = set.pickScalar(r.o[0], r.o[1], r.o[2], r.d[0], r.d[1], r.d[2], &scalarT);
+            if (a >= 0) hits++;
+            // Equal t on different hotspots is a tie either path may win.
+            if (a != b && simdT != scalarT) {
+                if (failures++ < 10)
+                    std::fprintf(stderr, "mismatch: n=%d ray=%d simd=%d (t=%g) scalar=%d (t=%g)\n",
+                                 n, i, a, simdT, b, scalarT);
+            }
+        }
+
+        std::printf("%10d %14.1f %14.1f %8.2fx %8d\n", n, simdNs, scalarNs, scalarNs / simdNs, hits);
+        // Keep the timed loops from being optimised away.
+        if (simdSum == -12345 || scalarSum == -12345) std::printf(" ");
+    }
+
+    // Triangle picks through the BVH, from the camera area toward the mesh.
+    std::printf("\n%10s %10s %6s %10s %12s %8s\n", "triangles", "nodes", "depth", "build ms", "us/ray", "hits");
+    const int meshes[][2] = {{25, 40}, {100, 100}, {250, 400}};
+    std::uniform_real_distribution<float> aim(-1.3f, 1.3f);
+    for (const auto& m : meshes) {
+        std::vector<float> tris = sphere(m[0], m[1]);
+        auto start = std::chrono::steady_clock::now();
+        MeshBVH bvh;
+        bvh.build(tris);
+        double buildMs = elapsed_ns(start) / 1e6;
+
+        std::vector<Ray> aimed(rayCount);
+        for (Ray& r : aimed) {
+            r.o[0] = unit(rng) * 2.0f;
+            r.o[1] = 5.0f + unit(rng);
+            r.o[2] = 25.0f + unit(rng) * 2.0f;
+            float d[3] = {aim(rng) - r.o[0], 5.0f + aim(rng) - r.o[1], aim(rng) - r.o[2]};
+            float len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            for (int i = 0; i < 3; i++) r.d[i] = d[i] / len;
+        }
+
+        float tSum = 0.0f;
+        int hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (const Ray& r : aimed) {
+            MeshBVH::Hit hit = bvh.intersect(r.o, r.d);
+            if (hit.triangle >= 0) {
+                hits++;
+                tSum += hit.t;
+            }
+        }
+        double us = elapsed_ns(start) / 1e3 / rayCount;
+
+        // Brute force is slow on the big mesh; a few hundred rays suffice.
+        for (int i = 0; i < std::min(rayCount, 300); i++) {
+            const Ray& r = aimed[i];
+            MeshBVH::Hit hit = bvh.intersect(r.o, r.d);
+            float t = brute_force(tris, r.o, r.d);
+            bool same = hit.triangle < 0 ? t == 1e9f : std::fabs(hit.t - t) <= 1e-4f * t;
+            if (!same && failures++ < 10)
+                std::fprintf(stderr, "mismatch: %d triangles ray=%d bvh t=%g brute force t=%g\n",
+                             bvh.triangleCount(), i, hit.triangle < 0 ? 1e9f : hit.t, t);
+        }
+
+        std::printf("%10d %10d %6d %10.1f %12.2f %8d\n", bvh.triangleCount(), bvh.nodeCount(), bvh.depth(), buildMs, us,
+                    hits);
+        if (tSum == -12345.0f) std::printf(" ");
+    }
+
+    if (failures) {
+        std::fprintf(stderr, "bench_picking: %d mismatches against the reference\n", failures);
+        return 1;
+    }
+    return 0;
+}
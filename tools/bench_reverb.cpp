@@ -0,0 +1,87 @@
+// Benchmark for the room reverb (reverb.h) against its CPU budget.
+//
+// Usage: bench_reverb [seconds] [absorption]
+// Builds the impulse response of the room drawCube() draws (20 x 9 x 20 m)
+// at 48 kHz, checks the partitioned convolution against a direct one, then
+// convolves `seconds` of noise in 10 ms blocks, as the audio thread does.
+// The time is reported as a share of one core; the budget is 5%, and the
+// exit code is 1 when it is exceeded.
+
+#include "../reverb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    if (seconds <= 0.0) seconds = 10.0;
+    reverb::Room room;
+    if (argc > 2) room.absorption = (float)std::atof(argv[2]);
+
+    const int rate = 48000;
+    const int block = 480;
+    const double budget = 5.0; // percent of one core
+
+#if defined(__AVX__)
+    std::printf("reverb path: AVX\n");
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    std::printf("reverb path: SSE2\n");
+#else
+    std::printf("reverb path: scalar\n");
+#endif
+
+    std::vector<float> left, right;
+    auto irStart = std::chrono::steady_clock::now();
+    reverb::impulse_response(room, rate, 2.0f, left, right);
+    reverb::Convolver convolver(left, right);
+    double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - irStart).count();
+    std::printf("room %.0f x %.0f x %.0f m, absorption %.2f: RT60 %.2f s, %zu frames, %d partitions, "
+                "latency %.1f ms, setup %.1f ms\n",
+                room.width, room.height, room.depth, room.absorption, reverb::rt60(room), left.size(),
+                convolver.partitions(), convolver.latency() * 1000.0 / rate, setupMs);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+    std::vector<float> in((size_t)block * 8);
+    for (float& v : in) v = noise(rng);
+
+    // The first frames against a direct convolution (output is `latency` late).
+    {
+        reverb::Convolver check(left, right);
+        std::vector<float> out(in.size() * 2, 0.0f);
+        for (size_t i = 0; i < in.size(); i += block) check.process(&in[i], &out[2 * i], block, 1.0f);
+        double maxError = 0.0, peak = 0.0;
+        for (size_t t = check.latency(); t < in.size(); t++) {
+            size_t s = t - check.latency();
+            double l = 0.0, r = 0.0;
+            for (size_t k = 0; k <= s && k < left.size(); k++) {
+                l += (double)left[k] * in[s - k];
+                r += (double)right[k] * in[s - k];
+            }
+            maxError = std::max(maxError, std::max(std::fabs(l - out[2 * t]), std::fabs(r - out[2 * t + 1])));
+            peak = std::max(peak, std::max(std::fabs(l), std::fabs(r)));
+        }
+        std::printf("max error vs direct convolution: %.2e (peak %.3f)\n", maxError, peak);
+    }
+
+    std::vector<float> out((size_t)block * 2);
+    int blocks = (int)(seconds * rate / block);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; b++) {
+        std::fill(out.begin(), out.end(), 0.0f);
+        convolver.process(&in[(size_t)(b % 8) * block], out.data(), block, 0.3f);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    double perBlock = us / blocks;
+    double blockUs = block * 1e6 / rate;
+    double load = 100.0 * perBlock / blockUs;
+    std::printf("%12s %12s %12s\n", "us/block", "% of core", "budget");
+    std::printf("%12.2f %12.2f %11.1f%%  %s\n", perBlock, load, budget, load <= budget ? "ok" : "OVER");
+    return load <= budget ? 0 : 1;
+}
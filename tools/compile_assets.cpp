@@ -0,0 +1,270 @@
+// Asset compiler: build the asset pack (asset_pack.h) the simulator maps at
+// startup, with every asset converted to the form the runtime uses.
+//
+// Usage, from the repository root so names match the paths the code uses:
+//   compile_assets [--rate=48000] [--textures=bc1] [--jobs=N] [--force]
+//                  data/assets.pack data/*.bmp data/*.jpg data/sfx/*.wav
+//
+// - Images (BMP, JPEG, PNG) become mip chains (texture.h), so nothing is
+//   decoded or mipmapped at launch: BC1 compressed with --textures=bc1 (the
+//   default), uncompressed BGR with --textures=bgr8.
+// - WAVs become 16-bit PCM at --rate, the usual output device rate; sounds
+//   in that format are played from the pack without conversion or cache.
+// - Anything else is stored as it is.
+//
+// Sources are hashed; one that hashes as recorded in the previous pack is
+// not converted again (unless --force), and identical sources are converted
+// once. Identical payloads are stored once. Conversion runs on --jobs
+// threads (default: one per core).
+
+#include "../asset_pack.h"
+#include "../pcm_convert.h"
+#include "../texture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Job {
+    std::string path;
+    std::vector<std::uint8_t> source;
+    assets::PackItem item;
+    const char* action = "";
+    double ms = 0.0;
+    bool ok = true;
+};
+
+bool read_file(const std::string& path, std::vector<std::uint8_t>& bytes) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? std::ftell(file) : -1;
+    ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        bytes.resize((std::size_t)size);
+        ok = size == 0 || std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+void put_u32(std::uint8_t* p, std::uint32_t v) {
+    p[0] = (std::uint8_t)v;
+    p[1] = (std::uint8_t)(v >> 8);
+    p[2] = (std::uint8_t)(v >> 16);
+    p[3] = (std::uint8_t)(v >> 24);
+}
+
+void put_u16(std::uint8_t* p, std::uint16_t v) {
+    p[0] = (std::uint8_t)v;
+    p[1] = (std::uint8_t)(v >> 8);
+}
+
+// A canonical 16-bit PCM WAV: RIFF header, fmt chunk, data chunk.
+void write_wav(const std::vector<std::int16_t>& samples, int channels, int rate, std::vector<std::uint8_t>& out) {
+    const std::uint32_t dataSize = (std::uint32_t)(samples.size() * 2);
+    out.assign(44 + (std::size_t)dataSize, 0);
+    std::uint8_t* p = out.data();
+    std::memcpy(p, "RIFF", 4);
+    put_u32(p + 4, 36 + dataSize);
+    std::memcpy(p + 8, "WAVEfmt ", 8);
+    put_u32(p + 16, 16);
+    put_u16(p + 20, 1);
+    put_u16(p + 22, (std::uint16_t)channels);
+    put_u32(p + 24, (std::uint32_t)rate);
+    put_u32(p + 28, (std::uint32_t)(rate * channels * 2));
+    put_u16(p + 32, (std::uint16_t)(channels * 2));
+    put_u16(p + 34, 16);
+    std::memcpy(p + 36, "data", 4);
+    put_u32(p + 40, dataSize);
+    std::memcpy(p + 44, samples.data(), dataSize);
+}
+
+bool is_image(assets::Format format) {
+    return format == assets::Format::Bmp || format == assets::Format::Jpeg || format == assets::Format::Png;
+}
+
+// The format a source compiles to.
+assets::Format target_format(assets::Format source) {
+    return is_image(source) ? assets::Format::Texture : source;
+}
+
+void compile(Job& job, int rate, texture::Pixels pixels) {
+    assets::PackItem& item = job.item;
+    const std::uint8_t* data = job.source.data();
+    const std::size_t size = job.source.size();
+    assets::Format format = assets::format_for(job.path);
+    if (is_image(format)) {
+        texture::Image image;
+        if (texture::decode_image(data, size, image)) {
+            texture::build(image.pixels, image.width, image.height, image.stride(), item.data);
+            item.format = assets::Format::Texture;
+            job.action = "mipmapped";
+            if (pixels == texture::Pixels::Bc1) {
+                std::vector<std::uint8_t> chain;
+                chain.swap(item.data);
+                texture::compress(chain.data(), chain.size(), item.data);
+                job.action = "bc1";
+            }
+            return;
+        }
+    } else if (format == assets::Format::Wav) {
+        pcm::WavInfo info;
+        std::vector<std::int16_t> samples;
+        if (pcm::convert_wav(data, size, rate, info, samples)) {
+            write_wav(samples, info.channels, rate, item.data);
+            item.format = assets::Format::Wav;
+            job.action = "converted";
+            return;
+        }
+    } else {
+        item.data = job.source;
+        item.format = format;
+        job.action = "stored";
+        return;
+    }
+    std::fprintf(stderr, "compile_assets: %s is not a supported %s file\n", job.path.c_str(),
+                 is_image(format) ? "image" : "WAV");
+    job.ok = false;
+}
+
+// Whether a previous pack's asset is what compiling this source would give.
+bool reusable(const assets::Asset& asset, const Job& job, int rate, texture::Pixels pixels) {
+    if (asset.source.hash != job.item.source.hash) return false;
+    if (asset.format != target_format(assets::format_for(job.path))) return false;
+    if (asset.format == assets::Format::Texture) {
+        texture::Header header;
+        std::vector<texture::Level> levels;
+        return texture::parse(asset.data, asset.size, header, levels) && header.pixels == (std::uint32_t)pixels;
+    }
+    if (asset.format != assets::Format::Wav) return true;
+    pcm::WavInfo info;
+    return pcm::parse_wav(asset.data, asset.size, info) && info.sampleRate == rate;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int rate = 48000;
+    int jobsWanted = (int)std::thread::hardware_concurrency();
+    texture::Pixels pixels = texture::Pixels::Bc1;
+    bool force = false;
+    bool badOption = false;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--rate=") == 0) rate = std::atoi(arg.c_str() + 7);
+        else if (arg.compare(0, 7, "--jobs=") == 0) jobsWanted = std::atoi(arg.c_str() + 7);
+        else if (arg == "--textures=bc1") pixels = texture::Pixels::Bc1;
+        else if (arg == "--textures=bgr8") pixels = texture::Pixels::Bgr8;
+        else if (arg.compare(0, 11, "--textures=") == 0) badOption = true;
+        else if (arg == "--force") force = true;
+        else args.push_back(arg);
+    }
+    if (args.size() < 2 || rate <= 0 || badOption) {
+        std::fprintf(stderr, "usage: compile_assets [--rate=48000] [--textures=bc1|bgr8] [--jobs=N] [--force] <out.pack> "
+                             "<file> [more files ...]\n");
+        return 2;
+    }
+    const std::string out = args[0];
+    const int threads = std::max(1, jobsWanted);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Job> jobs(args.size() - 1);
+    for (std::size_t i = 0; i < jobs.size(); i++) jobs[i].path = args[i + 1];
+
+    // Read and hash every source.
+    for (Job& job : jobs) {
+        assets::Source& source = job.item.source;
+        if (!assets::stat_source(job.path, source) || !read_file(job.path, job.source)) {
+            std::fprintf(stderr, "compile_assets: cannot read %s\n", job.path.c_str());
+            return 1;
+        }
+        source.hash = assets::hash_bytes(job.source.data(), job.source.size());
+        job.item.name = job.path;
+    }
+
+    // Reuse what the previous pack holds for unchanged sources; convert one
+    // of each set of identical sources.
+    std::vector<std::size_t> work;
+    std::unordered_map<std::uint64_t, std::size_t> firstWithHash;
+    std::vector<std::size_t> copyOf(jobs.size(), (std::size_t)-1);
+    if (!force && assets::open(out, false)) {
+        for (Job& job : jobs) {
+            const assets::Asset* previous = assets::find(job.path);
+            if (previous && reusable(*previous, job, rate, pixels)) {
+                job.item.data.assign(previous->data, previous->data + previous->size);
+                job.item.format = previous->format;
+                job.action = "unchanged";
+            }
+        }
+    }
+    assets::close();
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        if (*jobs[i].action) continue;
+        auto found = firstWithHash.find(jobs[i].item.source.hash);
+        if (found != firstWithHash.end() && assets::format_for(jobs[found->second].path) == assets::format_for(jobs[i].path)) {
+            copyOf[i] = found->second;
+        } else {
+            firstWithHash[jobs[i].item.source.hash] = i;
+            work.push_back(i);
+        }
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::min<int>(threads, (int)work.size()); t++) {
+        pool.emplace_back([&] {
+            for (std::size_t w = next++; w < work.size(); w = next++) {
+                Job& job = jobs[work[w]];
+                auto jobStart = std::chrono::steady_clock::now();
+                compile(job, rate, pixels);
+                job.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - jobStart).count();
+            }
+        });
+    }
+    for (std::thread& thread : pool) thread.join();
+
+    bool ok = true;
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        if (copyOf[i] != (std::size_t)-1) {
+            const Job& original = jobs[copyOf[i]];
+            jobs[i].item.data = original.item.data;
+            jobs[i].item.format = original.item.format;
+            jobs[i].ok = original.ok;
+            jobs[i].action = "duplicate";
+        }
+        ok = ok && jobs[i].ok;
+    }
+    if (!ok) return 1;
+
+    std::vector<assets::PackItem> items;
+    items.reserve(jobs.size());
+    std::uint64_t total = 0;
+    for (Job& job : jobs) {
+        total += job.item.data.size();
+        items.push_back(std::move(job.item));
+    }
+    std::uint64_t written = 0;
+    if (!assets::write_pack(out, items, &written)) {
+        std::fprintf(stderr, "compile_assets: cannot write %s\n", out.c_str());
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-40s %-10s %12s %10s\n", "source", "action", "bytes", "ms");
+    for (std::size_t i = 0; i < jobs.size(); i++)
+        std::printf("%-40s %-10s %12zu %10.1f\n", jobs[i].path.c_str(), jobs[i].action, items[i].data.size(), jobs[i].ms);
+    std::printf("%zu assets (%zu compiled, %d threads), %.1f MB stored, %.1f MB saved by deduplication, %.0f ms\n",
+                jobs.size(), work.size(), threads, written / (1024.0 * 1024.0), (total - written) / (1024.0 * 1024.0), ms);
+    return 0;
+}
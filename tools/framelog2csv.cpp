@@ -0,0 +1,58 @@
+// Convert binary frame logs (performance_log*.bin) to CSV.
+//
+// Usage: framelog2csv <log.bin> [more.bin ...] > performance_log.csv
+// Pass rotated files oldest first (e.g. performance_log.3.bin ... performance_log.bin).
+
+#include "../framelog.h"
+
+#include <cstdio>
+
+static bool convert(const char* path) {
+    std::FILE* in = std::fopen(path, "rb");
+    if (!in) {
+        std::fprintf(stderr, "framelog2csv: cannot open %s\n", path);
+        return false;
+    }
+
+    framelog::FileHeader header{};
+    if (std::fread(&header, sizeof(header), 1, in) != 1 || header.magic != framelog::kMagic) {
+        std::fprintf(stderr, "framelog2csv: %s is not a frame log\n", path);
+        std::fclose(in);
+        return false;
+    }
+    if (header.version != framelog::kVersion || header.recordSize != sizeof(framelog::FrameRecord)) {
+        std::fprintf(stderr, "framelog2csv: %s has unsupported version %u (record size %u)\n",
+                     path, header.version, header.recordSize);
+        std::fclose(in);
+        return false;
+    }
+
+    framelog::FrameRecord r;
+    while (std::fread(&r, sizeof(r), 1, in) == 1) {
+        double pixelsPerFrame = static_cast<double>(r.width) * static_cast<double>(r.height);
+        double pixelsPerSecond = pixelsPerFrame * r.fps;
+        std::printf("%llu,%g,%g,%g,%g,%g,%g,%u,%u,%g,%g,%u,%u,%llu",
+                    static_cast<unsigned long long>(r.frame), r.timeS, r.frameMs, r.fps, r.avgFps, r.minMs, r.maxMs,
+                    r.width, r.height, pixelsPerFrame, pixelsPerSecond, r.page, r.motionPresent,
+                    static_cast<unsigned long long>(r.gpuFrame));
+        for (int p = 0; p < framelog::kGpuPasses; ++p) std::printf(",%g", r.gpuPassMs[p]);
+        std::printf(",%g\n", r.gpuTotalMs);
+    }
+
+    std::fclose(in);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <log.bin> [more.bin ...]\n", argv[0]);
+        return 1;
+    }
+    // One header for all files, whether or not the first one opens.
+    std::printf("frame,time_s,frame_ms,fps,avg_fps,min_ms,max_ms,width,height,pixels_per_frame,pixels_per_second,"
+                "page,motion_present,gpu_frame,gpu_room_ms,gpu_components_ms,gpu_glass_ms,gpu_tooltips_ms,"
+                "gpu_hud_ms,gpu_total_ms\n");
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) ok = convert(argv[i]) && ok;
+    return ok ? 0 : 1;
+}
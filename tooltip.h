@@ -7,301 +7,336 @@
 #include <string>
 #include <vector>
 #include <algorithm> // for min, max
+#include <cassert>
+#include <cstdint>
+
+#include "camera.h"
+#include "decoration_batch.h"
+#include "flight.h"
+#include "glcount.h"
+#include "hotspots.h"
+#include "label_layout.h"
+#include "mesh_bvh.h"
+#include "profiler.h"
+#include "sdf_text.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Structure to hold component data
+// Debug builds assert that the per-frame tooltip calls never touch the heap
+// (counted per thread by the flight recorder's operator new).
+#ifndef NDEBUG
+struct TooltipNoAllocCheck {
+  std::uint64_t start = flight::thread_allocation_count();
+  ~TooltipNoAllocCheck() {
+    assert(flight::thread_allocation_count() == start &&
+           "tooltip frame path allocated");
+  }
+};
+#define TOOLTIP_CHECK_NO_ALLOC() TooltipNoAllocCheck tooltipNoAllocCheck_
+#else
+#define TOOLTIP_CHECK_NO_ALLOC()
+#endif
+
+// Returned by TooltipSystem::registerComponent; addresses the component in
+// O(1) for updates, forced focus and blocker relations.
+class TooltipHandle {
+  int index_ = -1;
+  explicit TooltipHandle(int index) : index_(index) {}
+  friend class TooltipSystem;
+
+public:
+  TooltipHandle() = default;
+  bool valid() const { return index_ >= 0; }
+  bool operator==(TooltipHandle other) const { return index_ == other.index_; }
+  bool operator!=(TooltipHandle other) const { return index_ != other.index_; }
+};
+
+// Structure to hold component data. Positions, visibility and blocking live
+// in TooltipSystem::hotspots (same index) so picking never touches the strings.
 struct ComponentInfo {
   std::string name;
   std::string description;
-  float x, y, z;
   float radius;
   float hoverTime; // Track how long component has been hovered
-  bool isVisible;  // Whether the component is visible (not disassembled out of view)
-  std::string blockedBy; // Name of component that blocks this one's label (empty = not blocked)
-  bool blockerRemoved;   // Whether the blocking component has been removed
+  int blockedBy;   // Component that blocks this one's label (-1 = not blocked)
+  std::vector<int> blocks; // Components whose labels this one blocks
+  sdf_text::Label nameLabel;
+  sdf_text::Label descriptionLabel;
+};
+
+// Result of a hover pick: the component hit and the world-space hit point.
+struct PickHit {
+  int index = -1;
+  float t = 1e9f;
+  float point[3] = {0.0f, 0.0f, 0.0f};
 };
 
 class TooltipSystem {
 private:
+  // Triangles captured from a component's render() at its registered
+  // position. The component's current offset is applied to the ray instead.
+  struct PickMesh {
+    MeshBVH bvh;
+    float anchor[3];
+    float offsetScale;
+  };
+
   std::vector<ComponentInfo> components;
+  HotspotSet hotspots;
+  std::vector<PickMesh> meshes; // parallel to components; empty = sphere picking
+  PickHit hoverHit;
+  // Reused every frame. Both batches are reserved in registerComponent for
+  // every panel visible at once, so draw() never allocates.
+  DecorationBatch decoration;
+  std::size_t panelGlyphs = 0; // glyphs queued when every panel shows
+  // Panel declutter: lift (world units) per component, eased towards the
+  // layout result, plus scratch for the layout pass.
+  LabelLayout labelLayout;
+  std::vector<float> labelLift;
+  std::vector<int> layoutComponent;
+  std::vector<float> layoutPixelSize;
   int focusedIndex = -1;
   int prevFocusedIndex = -1;
   float globalPulse = 0.0f;
 
+  // Queue a label at (x, y, z) in the billboarded panel's frame; height is
+  // the cap height in world units.
+  static void drawPanelLabel(const sdf_text::Label &label,
+                             const sdf_text::Frame &frame, float x, float y,
+                             float z, float height, text::Color color) {
+    sdf_text::draw(label, frame, x, y, z, height, color);
+  }
+
   // Helper to render text at a specific 3D location with shadow for better
   // visibility
-  void renderTextWithShadow(std::string text, float x, float y,
-                            void *font = GLUT_BITMAP_HELVETICA_18) {
+  static void renderTextWithShadow(const sdf_text::Label &label,
+                                   const sdf_text::Frame &frame, float x,
+                                   float y, float height) {
     // Draw shadow first (offset slightly)
-    glColor4f(0.0f, 0.0f, 0.0f, 0.8f);
-    glRasterPos3f(x + 0.02f, y - 0.02f, 0.01f);
-    for (char c : text) {
-      glutBitmapCharacter(font, c);
-    }
+    drawPanelLabel(label, frame, x + 0.02f, y - 0.02f, 0.01f, height,
+                   {0.0f, 0.0f, 0.0f, 1.0f});
     // Draw main text
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos3f(x, y, 0.02f);
-    for (char c : text) {
-      glutBitmapCharacter(font, c);
+    drawPanelLabel(label, frame, x, y, 0.02f, height,
+                   {1.0f, 1.0f, 1.0f, 1.0f});
+  }
+
+  // Map a point in the billboarded panel's frame to world space.
+  static void panelPoint(const sdf_text::Frame &f, float x, float y, float z,
+                         float *out) {
+    for (int i = 0; i < 3; i++)
+      out[i] = f.origin[i] + f.right[i] * x + f.up[i] * y + f.forward[i] * z;
+  }
+
+  // Queue the corner ticks of a bracket box: from each corner (signs sx, sy,
+  // sz) one tick of length corner along each axis, towards the center.
+  static void bracketCorners(DecorationBatch &batch, const float *center,
+                             float r, float corner, const int (*signs)[3],
+                             int count, float widthPx) {
+    for (int k = 0; k < count; k++) {
+      float p[3];
+      for (int a = 0; a < 3; a++) p[a] = center[a] + signs[k][a] * r;
+      for (int a = 0; a < 3; a++) {
+        float q[3] = {p[0], p[1], p[2]};
+        q[a] -= signs[k][a] * corner;
+        batch.line(p, q, widthPx);
+      }
     }
   }
 
-  // Draw enhanced fancy bracket around the object with glow
-  void drawBracket(float radius, float hoverIntensity) {
-    float r = radius;
-    float corner = r * 0.4f; // Slightly larger corner lines
+  // Spread overlapping panels apart: project each visible panel into the
+  // window, let LabelLayout push lower-priority ones up (the focused panel
+  // stays put, fading ones yield), and ease each panel's lift towards the
+  // result so panels glide instead of jumping.
+  void layoutLabels(const Camera &camera) {
+    PROFILE_ZONE("TooltipSystem::layoutLabels");
+    const float kMarginPx = 6.0f;
+    float pixelScale =
+        2.0f * tan(camera.fieldOfViewY() * 0.5f * M_PI / 180.0f) /
+        camera.viewportHeight();
+
+    labelLayout.clear();
+    layoutComponent.clear();
+    layoutPixelSize.clear();
+    for (int i = 0; i < (int)components.size(); i++) {
+      const ComponentInfo &c = components[i];
+      if (c.hoverTime <= 0.001f) {
+        labelLift[i] = 0.0f;
+        continue;
+      }
+      float anchor[3] = {hotspots.x(i), hotspots.y(i) + c.radius + 1.05f,
+                         hotspots.z(i)};
+      float window[2], depth;
+      if (!camera.project(anchor, window, &depth)) continue;
+      // Panel extents in world units around its anchor, including the glow.
+      float ps = depth * pixelScale;
+      float priority = (i == focusedIndex ? 2.0f : 0.0f) + c.hoverTime;
+      labelLayout.add(window[0] - 1.2f / ps, window[1] - 0.05f / ps,
+                      window[0] + 1.2f / ps, window[1] + 0.9f / ps, priority);
+      layoutComponent.push_back(i);
+      layoutPixelSize.push_back(ps);
+    }
+    labelLayout.solve(kMarginPx);
+
+    for (int k = 0; k < (int)layoutComponent.size(); k++) {
+      int i = layoutComponent[k];
+      float target = labelLayout.shift(k) * layoutPixelSize[k];
+      labelLift[i] += (target - labelLift[i]) * 0.25f;
+    }
+  }
+
+  // Queue the enhanced fancy bracket around the object with glow
+  void drawBracket(const float *center, float radius, float hoverIntensity) {
+    // The eight corners; the glow only outlines the first four.
+    static const int kCorners[8][3] = {
+        {-1, -1, 1}, {1, 1, 1},  {-1, 1, -1}, {1, -1, -1},
+        {-1, 1, 1},  {1, -1, 1}, {1, 1, -1},  {-1, -1, -1}};
 
     // Pulsing effect
     float scale = 1.0f + 0.08f * sin(globalPulse) * hoverIntensity;
+    float r = radius * scale;
+    float corner = r * 0.4f; // Slightly larger corner lines
 
-    // Draw glow layers first
-    glPushMatrix();
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-
+    // Glow layers
+    decoration.pass(DecorationBatch::Glow);
     for (int glow = 2; glow >= 0; glow--) {
       float glowWidth = 2.5f + glow * 2.0f;
       float alpha = (0.4f - glow * 0.12f) * hoverIntensity;
-      glLineWidth(glowWidth);
-      glColor4f(0.0f, 0.8f, 1.0f, alpha);
-
-      glPushMatrix();
-      glScalef(scale, scale, scale);
-
-      glBegin(GL_LINES);
-      // Bottom-Left-Front
-      glVertex3f(-r, -r, r);
-      glVertex3f(-r + corner, -r, r);
-      glVertex3f(-r, -r, r);
-      glVertex3f(-r, -r + corner, r);
-      glVertex3f(-r, -r, r);
-      glVertex3f(-r, -r, r - corner);
-      // Top-Right-Front
-      glVertex3f(r, r, r);
-      glVertex3f(r - corner, r, r);
-      glVertex3f(r, r, r);
-      glVertex3f(r, r - corner, r);
-      glVertex3f(r, r, r);
-      glVertex3f(r, r, r - corner);
-      // Top-Left-Back
-      glVertex3f(-r, r, -r);
-      glVertex3f(-r + corner, r, -r);
-      glVertex3f(-r, r, -r);
-      glVertex3f(-r, r - corner, -r);
-      glVertex3f(-r, r, -r);
-      glVertex3f(-r, r, -r + corner);
-      // Bottom-Right-Back
-      glVertex3f(r, -r, -r);
-      glVertex3f(r - corner, -r, -r);
-      glVertex3f(r, -r, -r);
-      glVertex3f(r, -r + corner, -r);
-      glVertex3f(r, -r, -r);
-      glVertex3f(r, -r, -r + corner);
-      glEnd();
-
-      glPopMatrix();
+      decoration.color(0.0f, 0.8f, 1.0f, alpha);
+      bracketCorners(decoration, center, r, corner, kCorners, 4, glowWidth);
     }
 
     // Main sharp bracket
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glLineWidth(3.0f);
-    glColor4f(0.0f, 1.0f, 1.0f, 1.0f); // Brighter cyan
-
-    glPushMatrix();
-    glScalef(scale, scale, scale);
-
-    glBegin(GL_LINES);
-    // All 8 corners
-    // Bottom-Left-Front
-    glVertex3f(-r, -r, r);
-    glVertex3f(-r + corner, -r, r);
-    glVertex3f(-r, -r, r);
-    glVertex3f(-r, -r + corner, r);
-    glVertex3f(-r, -r, r);
-    glVertex3f(-r, -r, r - corner);
-    // Top-Right-Front
-    glVertex3f(r, r, r);
-    glVertex3f(r - corner, r, r);
-    glVertex3f(r, r, r);
-    glVertex3f(r, r - corner, r);
-    glVertex3f(r, r, r);
-    glVertex3f(r, r, r - corner);
-    // Top-Left-Back
-    glVertex3f(-r, r, -r);
-    glVertex3f(-r + corner, r, -r);
-    glVertex3f(-r, r, -r);
-    glVertex3f(-r, r - corner, -r);
-    glVertex3f(-r, r, -r);
-    glVertex3f(-r, r, -r + corner);
-    // Bottom-Right-Back
-    glVertex3f(r, -r, -r);
-    glVertex3f(r - corner, -r, -r);
-    glVertex3f(r, -r, -r);
-    glVertex3f(r, -r + corner, -r);
-    glVertex3f(r, -r, -r);
-    glVertex3f(r, -r, -r + corner);
-    // Additional corners for full visibility
-    // Top-Left-Front
-    glVertex3f(-r, r, r);
-    glVertex3f(-r + corner, r, r);
-    glVertex3f(-r, r, r);
-    glVertex3f(-r, r - corner, r);
-    glVertex3f(-r, r, r);
-    glVertex3f(-r, r, r - corner);
-    // Bottom-Right-Front
-    glVertex3f(r, -r, r);
-    glVertex3f(r - corner, -r, r);
-    glVertex3f(r, -r, r);
-    glVertex3f(r, -r + corner, r);
-    glVertex3f(r, -r, r);
-    glVertex3f(r, -r, r - corner);
-    // Top-Right-Back
-    glVertex3f(r, r, -r);
-    glVertex3f(r - corner, r, -r);
-    glVertex3f(r, r, -r);
-    glVertex3f(r, r - corner, -r);
-    glVertex3f(r, r, -r);
-    glVertex3f(r, r, -r + corner);
-    // Bottom-Left-Back
-    glVertex3f(-r, -r, -r);
-    glVertex3f(-r + corner, -r, -r);
-    glVertex3f(-r, -r, -r);
-    glVertex3f(-r, -r + corner, -r);
-    glVertex3f(-r, -r, -r);
-    glVertex3f(-r, -r, -r + corner);
-    glEnd();
-
-    glPopMatrix();
-    glDisable(GL_BLEND);
-    glPopMatrix();
+    decoration.pass(DecorationBatch::Alpha);
+    decoration.color(0.0f, 1.0f, 1.0f, 1.0f); // Brighter cyan
+    bracketCorners(decoration, center, r, corner, kCorners, 8, 3.0f);
   }
 
 public:
-  void registerComponent(std::string name, std::string description, float x,
-                         float y, float z, float radius = 0.5f,
-                         std::string blockedBy = "") {
-    components.push_back(
-        {name, description, x, y, z, radius, 0.0f, true, blockedBy, false});
+  TooltipHandle registerComponent(const std::string &name,
+                                  const std::string &description, float x,
+                                  float y, float z, float radius = 0.5f,
+                                  TooltipHandle blockedBy = TooltipHandle()) {
+    components.push_back({name, description, radius, 0.0f, blockedBy.index_, {},
+                          sdf_text::Label(name), sdf_text::Label(description)});
+    meshes.push_back({MeshBVH(), {x, y, z}, 1.0f});
+    labelLift.push_back(0.0f);
+    labelLayout.reserve(components.size());
+    layoutComponent.reserve(components.size());
+    layoutPixelSize.reserve(components.size());
+    // draw() queues 40 glow and 36 alpha quads per panel (bracket, leader
+    // line, panel and border), and the name twice (shadow and text).
+    decoration.reserve(DecorationBatch::Glow, components.size() * 40);
+    decoration.reserve(DecorationBatch::Alpha, components.size() * 36);
+    panelGlyphs += 2 * name.size() + description.size();
+    sdf_text::reserve(panelGlyphs);
+    // Use slightly larger detection radius for easier hovering
+    int index = hotspots.add(x, y, z, radius * 1.2f);
+    if (blockedBy.valid()) {
+      components[blockedBy.index_].blocks.push_back(index);
+      hotspots.setBlocked(index, true);
+    }
+    return TooltipHandle(index);
+  }
+
+  // Pick this component by its triangles instead of its sphere. triangles
+  // are world-space (9 floats each) at the component's current position;
+  // offsetScale is how far the geometry moves per unit of tooltip movement.
+  // Occlusion between meshes replaces the blockedBy rule for it.
+  void setPickMesh(TooltipHandle handle, const std::vector<float> &triangles,
+                   float offsetScale = 1.0f) {
+    int i = handle.index_;
+    PickMesh &m = meshes[i];
+    m.bvh.build(triangles);
+    m.anchor[0] = hotspots.x(i);
+    m.anchor[1] = hotspots.y(i);
+    m.anchor[2] = hotspots.z(i);
+    m.offsetScale = offsetScale;
+    // Keep it out of the sphere pass.
+    hotspots.setBlocked(i, !m.bvh.empty() || components[i].blockedBy >= 0);
   }
 
+  // Nearest component under the mouse. Meshes are tested exactly; the rest
+  // fall back to their detection spheres.
+  PickHit pick(const Camera &camera, int mouseX, int mouseY) const {
+    PROFILE_ZONE("TooltipSystem::pick");
+    PickHit hit;
+    float o[3], d[3];
+    camera.pickRay(mouseX, mouseY, o, d);
+
+    float sphereT;
+    int sphere = hotspots.pick(o[0], o[1], o[2], d[0], d[1], d[2], &sphereT);
+    if (sphere >= 0) {
+      hit.index = sphere;
+      hit.t = sphereT;
+    }
+
+    for (int i = 0; i < (int)meshes.size(); i++) {
+      const PickMesh &m = meshes[i];
+      if (m.bvh.empty() || !hotspots.isVisible(i))
+        continue;
+      float local[3] = {
+          o[0] - (hotspots.x(i) - m.anchor[0]) * m.offsetScale,
+          o[1] - (hotspots.y(i) - m.anchor[1]) * m.offsetScale,
+          o[2] - (hotspots.z(i) - m.anchor[2]) * m.offsetScale};
+      MeshBVH::Hit h = m.bvh.intersect(local, d, hit.t);
+      if (h.triangle >= 0) {
+        hit.index = i;
+        hit.t = h.t;
+      }
+    }
+
+    if (hit.index >= 0)
+      for (int a = 0; a < 3; a++)
+        hit.point[a] = o[a] + d[a] * hit.t;
+    return hit;
+  }
+
+  // Last hover pick (index -1 when nothing is under the mouse or a
+  // component is forced).
+  const PickHit &lastHit() const { return hoverHit; }
+
   // Dynamic update for moving parts - this keeps tooltip synced with component
   // position. Also tracks visibility based on whether component has moved
   // outside the case.
-  void updateComponent(std::string name, float x, float y, float z,
+  void updateComponent(TooltipHandle handle, float x, float y, float z,
                        float offsetX = 0.0f) {
-    bool componentRemoved = (offsetX < -3.5f); // Component fully disassembled
-
-    for (auto &c : components) {
-      if (c.name == name) {
-        c.x = x;
-        c.y = y;
-        c.z = z;
-        // Hide tooltip if component has moved significantly out of the case
-        // (disassembled) Components move in negative X direction when
-        // disassembling
-        c.isVisible = (offsetX > -1.5f);
-      }
-      // If this component was blocking others, mark them as unblocked
-      if (componentRemoved && c.blockedBy == name) {
-        c.blockerRemoved = true;
+    TOOLTIP_CHECK_NO_ALLOC();
+    int i = handle.index_;
+    hotspots.setPosition(i, x, y, z);
+    // Hide tooltip if component has moved significantly out of the case
+    // (disassembled) Components move in negative X direction when
+    // disassembling
+    hotspots.setVisible(i, offsetX > -1.5f);
+
+    // If this component was blocking others, mark them as unblocked
+    if (offsetX < -3.5f) { // Component fully disassembled
+      for (int blocked : components[i].blocks) {
+        if (meshes[blocked].bvh.empty())
+          hotspots.setBlocked(blocked, false);
       }
     }
   }
 
-  // Use mouse movement to find closest component (Simulated Raycast)
-  void update(int mouseX, int mouseY, std::string forcedName = "") {
+  // Use mouse movement to find closest component (Simulated Raycast).
+  // The pick ray comes from the camera's cached matrices, so no GL state is
+  // read back on the hot path.
+  void update(const Camera &camera, int mouseX, int mouseY,
+              TooltipHandle forced = TooltipHandle()) {
+    PROFILE_ZONE("TooltipSystem::update");
+    TOOLTIP_CHECK_NO_ALLOC();
     prevFocusedIndex = focusedIndex;
     focusedIndex = -1;
+    hoverHit = PickHit();
 
     // Check forced selection first
-    if (!forcedName.empty()) {
-        for (size_t i = 0; i < components.size(); i++) {
-            if (components[i].name == forcedName) {
-                focusedIndex = i;
-                break;
-            }
-        }
+    if (forced.valid()) {
+        focusedIndex = forced.index_;
     } else {
         // Standard Raycast Logic
-        GLint viewport[4];
-        GLdouble modelview[16];
-        GLdouble projection[16];
-        GLdouble nearX, nearY, nearZ;
-        GLdouble farX, farY, farZ;
-
-        glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
-        glGetDoublev(GL_PROJECTION_MATRIX, projection);
-        glGetIntegerv(GL_VIEWPORT, viewport);
-
-        // Flip Y for viewport coordinates
-        GLint winY = viewport[3] - mouseY;
-
-        // Unproject near plane (z=0)
-        gluUnProject(mouseX, winY, 0.0, modelview, projection, viewport, &nearX, &nearY, &nearZ);
-        // Unproject far plane (z=1)
-        gluUnProject(mouseX, winY, 1.0, modelview, projection, viewport, &farX, &farY, &farZ);
-
-        // Ray Origin and Direction
-        double ox = nearX;
-        double oy = nearY;
-        double oz = nearZ;
-
-        double dx = farX - nearX;
-        double dy = farY - nearY;
-        double dz = farZ - nearZ;
-
-        // Normalize direction
-        double len = sqrt(dx * dx + dy * dy + dz * dz);
-        dx /= len;
-        dy /= len;
-        dz /= len;
-
-        float closestT = 1e9f;
-
-        // Ray-Sphere Intersection for each component with improved detection radius
-        for (int i = 0; i < components.size(); i++) {
-        auto &c = components[i];
-
-        // Skip components that have been disassembled out of view
-        if (!c.isVisible)
-            continue;
-
-        // Skip components that are blocked by another component that hasn't been removed
-        if (!c.blockedBy.empty() && !c.blockerRemoved)
-            continue;
-
-        // Use slightly larger detection radius for easier hovering
-        float detectionRadius = c.radius * 1.2f;
-
-        // Vector from Ray Origin to Sphere Center
-        double fx = c.x - ox;
-        double fy = c.y - oy;
-        double fz = c.z - oz;
-
-        // Project f onto d (t_ca)
-        double t = fx * dx + fy * dy + fz * dz;
-
-        if (t < 0)
-            continue; // Sphere is behind the ray origin
-
-        // Closest point on ray to center
-        double px = ox + t * dx;
-        double py = oy + t * dy;
-        double pz = oz + t * dz;
-
-        // Distance squared from center to ray
-        double d2 = (c.x - px) * (c.x - px) + (c.y - py) * (c.y - py) +
-                    (c.z - pz) * (c.z - pz);
-
-        if (d2 < (detectionRadius * detectionRadius) && t < closestT) {
-            // Intersection! Take the closest one
-            closestT = t;
-            focusedIndex = i;
-        }
-        }
+        hoverHit = pick(camera, mouseX, mouseY);
+        focusedIndex = hoverHit.index;
     }
 
     // Update global pulse for animations
@@ -319,8 +354,11 @@ public:
     }
   }
 
-  // Draw now requires camera position to calculate billboard rotation
-  void draw(float camX, float camY, float camZ) {
+  // Draw now requires the camera to calculate billboard rotation and line
+  // widths. All decoration is batched into two draws and all labels into one.
+  void draw(const Camera &camera) {
+    PROFILE_ZONE("TooltipSystem::draw");
+    TOOLTIP_CHECK_NO_ALLOC();
     if (focusedIndex == -1) {
         // Just keep checking for hover states to fade out
         bool anyVisible = false;
@@ -328,137 +366,119 @@ public:
         if (!anyVisible) return;
     }
 
+    const float *cam = camera.position();
+    layoutLabels(camera);
+    decoration.begin(camera);
+
     // We iterate over all components to handle fade-out animations too
     for(int i=0; i<components.size(); i++) {
         if(components[i].hoverTime <= 0.001f) continue;
         
         auto &c = components[i];
         float hoverIntensity = c.hoverTime; // Smooth fade-in
+        float cx = hotspots.x(i), cy = hotspots.y(i), cz = hotspots.z(i);
 
-        glDisable(GL_LIGHTING);
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_DEPTH_TEST); // Draw on top of everything
-
-        // 1. Draw the enhanced "Target" Bracket at the object location
-        glPushMatrix();
-        glTranslatef(c.x, c.y, c.z);
-        drawBracket(c.radius, hoverIntensity);
-        glPopMatrix();
+        // 1. The enhanced "Target" Bracket at the object location
+        const float center[3] = {cx, cy, cz};
+        drawBracket(center, c.radius, hoverIntensity);
 
-        // 2. Draw glowing "Leader Line" floating upwards
-        float textHeightOffset = c.radius + 1.0f;
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        // 2. Glowing "Leader Line" floating upwards
+        float textHeightOffset = c.radius + 1.0f + labelLift[i];
+        const float lineBottom[3] = {cx, cy + c.radius * 0.3f, cz};
+        const float lineTop[3] = {cx, cy + textHeightOffset, cz};
 
         // Glow effect for leader line
+        decoration.pass(DecorationBatch::Glow);
         for (int glow = 2; glow >= 0; glow--) {
           float glowWidth = 1.0f + glow * 1.5f;
           float alpha = (0.5f - glow * 0.15f) * hoverIntensity;
-          glLineWidth(glowWidth);
-          glColor4f(0.0f, 0.8f, 1.0f, alpha);
-          glBegin(GL_LINES);
-          glVertex3f(c.x, c.y + c.radius * 0.3f, c.z);
-          glVertex3f(c.x, c.y + textHeightOffset, c.z);
-          glEnd();
+          decoration.color(0.0f, 0.8f, 1.0f, alpha);
+          decoration.line(lineBottom, lineTop, glowWidth);
         }
 
         // Main leader line
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glLineWidth(2.0f);
-        glColor4f(0.0f, 1.0f, 1.0f, hoverIntensity);
-        glBegin(GL_LINES);
-        glVertex3f(c.x, c.y + c.radius * 0.3f, c.z);
-        glVertex3f(c.x, c.y + textHeightOffset, c.z);
-        glEnd();
+        decoration.pass(DecorationBatch::Alpha);
+        decoration.color(0.0f, 1.0f, 1.0f, hoverIntensity);
+        decoration.line(lineBottom, lineTop, 2.0f);
 
         // Small connecting dot
-        glPointSize(6.0f);
-        glBegin(GL_POINTS);
-        glVertex3f(c.x, c.y + textHeightOffset, c.z);
-        glEnd();
+        decoration.point(lineTop[0], lineTop[1], lineTop[2], 6.0f);
 
         // 3. Billboarded Text Panel with enhanced visibility
-        float dx = camX - c.x;
-        float dz = camZ - c.z;
-        float angleY = atan2(dx, dz) * 180.0f / M_PI;
-
-        glPushMatrix();
-        glTranslatef(c.x, c.y + textHeightOffset + 0.05f, c.z);
-        glRotatef(angleY, 0.0f, 1.0f, 0.0f);
+        float dx = cam[0] - cx;
+        float dz = cam[2] - cz;
+        float angleY = atan2(dx, dz);
+        float sinY = sin(angleY);
+        float cosY = cos(angleY);
+        sdf_text::Frame panelFrame = {{cx, cy + textHeightOffset + 0.05f, cz},
+                                      {cosY, 0.0f, -sinY},
+                                      {0.0f, 1.0f, 0.0f},
+                                      {sinY, 0.0f, cosY}};
 
         // Larger panel for better visibility
         float panelWidth = 2.2f;
         float panelHeight = 0.8f;
         float panelPadding = 0.08f;
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        float quad[4][3];
 
         // Outer glow effect for panel
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        glColor4f(0.0f, 0.5f, 0.8f, 0.3f * hoverIntensity);
-        glBegin(GL_QUADS);
-        glVertex3f(-panelWidth / 2 - 0.1f, -0.05f, 0.01f);
-        glVertex3f(panelWidth / 2 + 0.1f, -0.05f, 0.01f);
-        glVertex3f(panelWidth / 2 + 0.1f, panelHeight + 0.1f, 0.01f);
-        glVertex3f(-panelWidth / 2 - 0.1f, panelHeight + 0.1f, 0.01f);
-        glEnd();
+        decoration.pass(DecorationBatch::Glow);
+        decoration.color(0.0f, 0.5f, 0.8f, 0.3f * hoverIntensity);
+        panelPoint(panelFrame, -panelWidth / 2 - 0.1f, -0.05f, 0.01f, quad[0]);
+        panelPoint(panelFrame, panelWidth / 2 + 0.1f, -0.05f, 0.01f, quad[1]);
+        panelPoint(panelFrame, panelWidth / 2 + 0.1f, panelHeight + 0.1f, 0.01f, quad[2]);
+        panelPoint(panelFrame, -panelWidth / 2 - 0.1f, panelHeight + 0.1f, 0.01f, quad[3]);
+        decoration.quad(quad);
 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        decoration.pass(DecorationBatch::Alpha);
 
         // Main dark panel background with gradient effect
-        glColor4f(0.02f, 0.08f, 0.15f, 0.92f * hoverIntensity);
-        glBegin(GL_QUADS);
-        glVertex3f(-panelWidth / 2, 0.0f, 0.0f);
-        glVertex3f(panelWidth / 2, 0.0f, 0.0f);
-        glVertex3f(panelWidth / 2, panelHeight, 0.0f);
-        glVertex3f(-panelWidth / 2, panelHeight, 0.0f);
-        glEnd();
+        decoration.color(0.02f, 0.08f, 0.15f, 0.92f * hoverIntensity);
+        panelPoint(panelFrame, -panelWidth / 2, 0.0f, 0.0f, quad[0]);
+        panelPoint(panelFrame, panelWidth / 2, 0.0f, 0.0f, quad[1]);
+        panelPoint(panelFrame, panelWidth / 2, panelHeight, 0.0f, quad[2]);
+        panelPoint(panelFrame, -panelWidth / 2, panelHeight, 0.0f, quad[3]);
+        decoration.quad(quad);
 
         // Glowing border with multiple layers
         for (int b = 0; b < 2; b++) {
           float borderOffset = b * 0.02f;
           float borderAlpha = (1.0f - b * 0.4f) * hoverIntensity;
-          glColor4f(0.0f, 0.9f, 1.0f, borderAlpha);
-          glLineWidth(2.5f - b * 0.8f);
-          glBegin(GL_LINE_LOOP);
-          glVertex3f(-panelWidth / 2 - borderOffset, -borderOffset, 0.001f);
-          glVertex3f(panelWidth / 2 + borderOffset, -borderOffset, 0.001f);
-          glVertex3f(panelWidth / 2 + borderOffset, panelHeight + borderOffset,
-                     0.001f);
-          glVertex3f(-panelWidth / 2 - borderOffset, panelHeight + borderOffset,
-                     0.001f);
-          glEnd();
+          decoration.color(0.0f, 0.9f, 1.0f, borderAlpha);
+          panelPoint(panelFrame, -panelWidth / 2 - borderOffset, -borderOffset, 0.001f, quad[0]);
+          panelPoint(panelFrame, panelWidth / 2 + borderOffset, -borderOffset, 0.001f, quad[1]);
+          panelPoint(panelFrame, panelWidth / 2 + borderOffset, panelHeight + borderOffset,
+                     0.001f, quad[2]);
+          panelPoint(panelFrame, -panelWidth / 2 - borderOffset, panelHeight + borderOffset,
+                     0.001f, quad[3]);
+          for (int e = 0; e < 4; e++)
+            decoration.line(quad[e], quad[(e + 1) % 4], 2.5f - b * 0.8f);
         }
 
         // Header bar accent
-        glColor4f(0.0f, 0.7f, 0.9f, 0.4f * hoverIntensity);
-        glBegin(GL_QUADS);
-        glVertex3f(-panelWidth / 2 + panelPadding, panelHeight - 0.02f, 0.001f);
-        glVertex3f(panelWidth / 2 - panelPadding, panelHeight - 0.02f, 0.001f);
-        glVertex3f(panelWidth / 2 - panelPadding, panelHeight - 0.04f, 0.001f);
-        glVertex3f(-panelWidth / 2 + panelPadding, panelHeight - 0.04f, 0.001f);
-        glEnd();
+        decoration.color(0.0f, 0.7f, 0.9f, 0.4f * hoverIntensity);
+        panelPoint(panelFrame, -panelWidth / 2 + panelPadding, panelHeight - 0.02f, 0.001f, quad[0]);
+        panelPoint(panelFrame, panelWidth / 2 - panelPadding, panelHeight - 0.02f, 0.001f, quad[1]);
+        panelPoint(panelFrame, panelWidth / 2 - panelPadding, panelHeight - 0.04f, 0.001f, quad[2]);
+        panelPoint(panelFrame, -panelWidth / 2 + panelPadding, panelHeight - 0.04f, 0.001f, quad[3]);
+        decoration.quad(quad);
 
         // Text with shadow effect for better readability
         if (hoverIntensity > 0.3f) {
-          renderTextWithShadow(c.name, -panelWidth / 2 + 0.12f, panelHeight - 0.30f,
-                               GLUT_BITMAP_HELVETICA_18);
-
-          glColor3f(0.7f, 0.9f, 1.0f); // Slight blue tint for description
-          glRasterPos3f(-panelWidth / 2 + 0.12f, panelHeight - 0.55f, 0.02f);
-          for (char ch : c.description) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, ch);
-          }
-        }
+          renderTextWithShadow(c.nameLabel, panelFrame, -panelWidth / 2 + 0.12f,
+                               panelHeight - 0.30f, 0.15f);
 
-        glDisable(GL_BLEND);
-        glPopMatrix();
-
-        glEnable(GL_DEPTH_TEST); // Restore depth test
-        glEnable(GL_LIGHTING);   // Restore lighting
+          // Slight blue tint for description
+          drawPanelLabel(c.descriptionLabel, panelFrame,
+                         -panelWidth / 2 + 0.12f, panelHeight - 0.55f, 0.02f,
+                         0.1f, {0.7f, 0.9f, 1.0f, 1.0f});
+        }
     }
+
+    // Additive glow, then the alpha pass, which writes depth so the label
+    // batch is hidden behind nearer panels.
+    decoration.flush();
+    sdf_text::flush();
   }
 };
 